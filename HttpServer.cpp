@@ -1,15 +1,219 @@
 #include "HttpServer.h"
 #include "utils.h"
-#include <iostream>
+#include "http_utils.h"
+#include "http_parser.h"
+#include "metrics.h"
+#include "logger.h"
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <string_view>
+#include <limits>
+#include <csignal>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#endif
 
 using boost::asio::ip::tcp;
 
+namespace {
+    constexpr size_t FILE_CHUNK_SIZE = 64 * 1024;
+
+#if defined(__linux__)
+    // TCP_CORK: 头部与文件首块合并成满MSS的报文，传输结束时取消以冲刷尾部
+    void set_tcp_cork(tcp::socket& socket, bool enable) {
+        int value = enable ? 1 : 0;
+        ::setsockopt(socket.native_handle(), IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+    }
+#endif
+
+    void pin_thread_to_core(std::thread& thread, unsigned core) {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        int result = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+        if (result != 0) {
+            LOG_ERROR("Failed to pin HTTP thread to core " << core << ": " << std::strerror(result));
+        }
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+
+    // 取查询串中某个参数的值，不存在时返回空串
+    std::string query_param(const std::string& query, const std::string& name) {
+        size_t pos = 0;
+        while (pos < query.size()) {
+            size_t end = query.find('&', pos);
+            if (end == std::string::npos) end = query.size();
+            size_t eq = query.find('=', pos);
+            if (eq != std::string::npos && eq < end && query.compare(pos, eq - pos, name) == 0) {
+                return query.substr(eq + 1, end - eq - 1);
+            }
+            pos = end + 1;
+        }
+        return "";
+    }
+
+    bool read_text_file(const std::string& path, std::string& content) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) return false;
+        std::ostringstream stream;
+        stream << in.rdbuf();
+        content = stream.str();
+        return true;
+    }
+
+    // HTTP指标在首次使用时注册，之后只做原子更新
+    struct HttpMetrics {
+        Metrics& registry = Metrics::instance();
+        Metrics::Counter& requests = registry.counter("hls_http_requests_total", "HTTP requests received");
+        Metrics::Counter& response_bytes = registry.counter("hls_http_response_bytes_total",
+            "Bytes written in completed HTTP responses");
+        Metrics::Gauge& connections = registry.gauge("hls_http_open_connections", "Open HTTP connections");
+        Metrics::Gauge& buffered_bytes = registry.gauge("hls_http_buffered_bytes",
+            "Request and file chunk buffers held by open connections");
+        Metrics::Counter& rejected = registry.counter("hls_http_rejected_connections_total",
+            "Connections refused with 503 at the connection limit");
+        Metrics::Counter& idle_evictions = registry.counter("hls_http_evicted_connections_total",
+            "Connections closed by a deadline", "reason=\"idle\"");
+        Metrics::Counter& write_evictions = registry.counter("hls_http_evicted_connections_total",
+            "Connections closed by a deadline", "reason=\"slow_write\"");
+        Metrics::Counter& pacing_waits = registry.counter("hls_http_pacing_waits_total",
+            "Sends delayed by the per-connection token bucket");
+        Metrics::Counter& send_yields = registry.counter("hls_http_send_yields_total",
+            "Zero-copy sends that yielded after a send quantum");
+        Metrics::Histogram& latency = registry.histogram("hls_http_response_seconds",
+            "Time from request parsed to response fully written", Metrics::latency_buckets());
+        std::vector<std::pair<int, Metrics::Counter*>> statuses;
+        Metrics::Counter* other_status = nullptr;
+
+        HttpMetrics() {
+            for (int code : { 200, 206, 304, 400, 404, 405, 416, 431, 500, 503 }) {
+                statuses.emplace_back(code, &registry.counter("hls_http_responses_total",
+                    "HTTP responses by status code", "code=\"" + std::to_string(code) + "\""));
+            }
+            other_status = &registry.counter("hls_http_responses_total",
+                "HTTP responses by status code", "code=\"other\"");
+        }
+
+        Metrics::Counter& by_status(int code) {
+            for (auto& status : statuses) {
+                if (status.first == code) return *status.second;
+            }
+            return *other_status;
+        }
+    };
+
+    HttpMetrics& http_metrics() {
+        static HttpMetrics metrics;
+        return metrics;
+    }
+
+    bool has_complete_header(const boost::asio::streambuf& buffer) {
+        auto data = buffer.data();
+        std::string_view view(static_cast<const char*>(data.data()), data.size());
+        return view.find("\r\n\r\n") != std::string_view::npos;
+    }
+}
+
+RequestData::RequestData(std::shared_ptr<tcp::socket> sock, size_t max_request_bytes,
+    std::shared_ptr<std::atomic<int>> slot)
+    : socket(std::move(sock))
+    , buffer(max_request_bytes)
+    , deadline_timer(socket->get_executor())
+    , connection_slot(std::move(slot))
+    , pacing_timer(socket->get_executor()) {
+}
+
+RequestData::~RequestData() {
+#if defined(__linux__)
+    if (file_fd >= 0) {
+        ::close(file_fd);
+    }
+#endif
+    if (connection_slot) {
+        (*connection_slot)--;
+    }
+    http_metrics().connections.add(-1);
+    http_metrics().buffered_bytes.add(-static_cast<double>(accounted_bytes));
+}
+
+void RequestData::reset_response() {
+    method.clear();
+    version.clear();
+    path.clear();
+    range_header.clear();
+    if_none_match.clear();
+    if_modified_since.clear();
+    if_range.clear();
+    hls_msn = -1;
+    hls_part = -1;
+    await_playlist = false;
+    await_segment = false;
+    segment_failed = false;
+    validators = FileValidators{};
+    file_path.clear();
+    header.clear();
+    file_size = 0;
+    parts.clear();
+    part_index = 0;
+    file_stream.reset();
+    cached_body.reset();
+#if defined(__linux__)
+    if (file_fd >= 0) {
+        ::close(file_fd);
+    }
+#endif
+    file_fd = -1;
+    file_offset = 0;
+}
+
 HttpServer::HttpServer(const Config& config)
     : config_(config)
-    , acceptor_(io_context_, tcp::endpoint(tcp::v4(), config_.HTTP_PORT)) {
+    , acceptor_(io_context_)
+    , blocked_timer_(io_context_) {
+#if defined(SO_REUSEPORT)
+    bool sharded = config_.HTTP_REUSEPORT_SHARDS;
+#else
+    bool sharded = false;
+    if (config_.HTTP_REUSEPORT_SHARDS) {
+        LOG_WARN("SO_REUSEPORT is not supported on this platform, using a shared acceptor");
+    }
+#endif
+    if (sharded) {
+        for (int i = 0; i < std::max(1, config_.HTTP_THREADS); ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+            open_listener(shards_.back()->acceptor, true);
+        }
+    }
+    else {
+        open_listener(acceptor_, false);
+    }
+
+    if (config_.SEGMENT_CACHE_BYTES > 0) {
+        file_reader_ = std::make_unique<FileReader>(io_context_, config_.FILE_READER_IO_URING,
+            config_.FILE_READER_THREADS, config_.IO_URING_ENTRIES);
+        segment_cache_ = std::make_unique<SegmentCache>(*file_reader_, config_.SEGMENT_CACHE_BYTES,
+            config_.SEGMENT_CACHE_MAX_ENTRY_BYTES,
+            std::chrono::milliseconds(config_.PLAYLIST_CACHE_TTL_MS));
+    }
 }
 
 HttpServer::~HttpServer() {
@@ -19,68 +223,189 @@ HttpServer::~HttpServer() {
 void HttpServer::start() {
     if (running_) return;
 
+#if defined(__linux__)
+    // sendfile写已关闭的连接会触发SIGPIPE（Asio自身的send带MSG_NOSIGNAL，sendfile没有），默认动作会终止进程
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
     running_ = true;
-    server_thread_ = std::thread([this]() {
-        std::cout << "Starting HTTP server on port " << config_.HTTP_PORT << std::endl;
 
-        try {
-            start_accept();
-            io_context_.run();
-            std::cout << "HTTP server started successfully!" << std::endl;
-        }
-        catch (const std::exception& e) {
-            std::cerr << "HTTP server runtime error: " << e.what() << std::endl;
-            running_ = false;
+    if (!shards_.empty()) {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        LOG_INFO("Starting HTTP server on port " << config_.HTTP_PORT
+            << " with " << shards_.size() << " SO_REUSEPORT shards");
+
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            Shard& shard = *shards_[i];
+            start_accept(shard.acceptor, shard.io_context);
+            server_threads_.emplace_back([this, &shard, i]() {
+                try {
+                    shard.io_context.run();
+                }
+                catch (const std::exception& e) {
+                    LOG_ERROR("HTTP shard " << i << " runtime error: " << e.what());
+                    running_ = false;
+                    shard.io_context.stop();
+                }
+                });
+            if (config_.HTTP_PIN_THREADS) {
+                pin_thread_to_core(server_threads_.back(), static_cast<unsigned>(i % cores));
+            }
         }
-        });
+
+        server_threads_.emplace_back([this]() {
+            auto work = boost::asio::make_work_guard(io_context_);
+            try {
+                io_context_.run();
+            }
+            catch (const std::exception& e) {
+                LOG_ERROR("HTTP service thread runtime error: " << e.what());
+                running_ = false;
+                io_context_.stop();
+            }
+            });
+        return;
+    }
+
+    start_accept(acceptor_, io_context_);
+
+    // 多个线程共同运行同一个io_context；每个连接的socket绑定独立的strand，
+    // 同一连接的回调串行执行，不同连接可并行
+    int thread_count = std::max(1, config_.HTTP_THREADS);
+    LOG_INFO("Starting HTTP server on port " << config_.HTTP_PORT
+        << " with " << thread_count << " threads");
+
+    for (int i = 0; i < thread_count; ++i) {
+        server_threads_.emplace_back([this, i]() {
+            try {
+                io_context_.run();
+            }
+            catch (const std::exception& e) {
+                LOG_ERROR("HTTP server thread " << i << " runtime error: " << e.what());
+                running_ = false;
+                io_context_.stop();
+            }
+            });
+    }
 }
 
 void HttpServer::stop() {
-    if (!running_) return;
+    if (!running_ && server_threads_.empty()) return;
 
     running_ = false;
     io_context_.stop();
-    if (server_thread_.joinable()) {
-        server_thread_.join();
+    for (auto& shard : shards_) {
+        shard->io_context.stop();
     }
-    std::cout << "HTTP server stopped" << std::endl;
+    for (auto& thread : server_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    server_threads_.clear();
+    LOG_INFO("HTTP server stopped");
 }
 
-void HttpServer::start_accept() {
-    auto socket = std::make_shared<tcp::socket>(io_context_);
+void HttpServer::open_listener(tcp::acceptor& acceptor, bool reuse_port) {
+    tcp::endpoint endpoint(tcp::v4(), config_.HTTP_PORT);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+#if defined(SO_REUSEPORT)
+    if (reuse_port) {
+        // 同一端口上的多个监听socket由内核按连接哈希分发
+        acceptor.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+    }
+#else
+    (void)reuse_port;
+#endif
+    acceptor.bind(endpoint);
+    acceptor.listen();
+}
 
-    acceptor_.async_accept(*socket,
-        [this, socket](const boost::system::error_code& error) {
+void HttpServer::start_accept(tcp::acceptor& acceptor, boost::asio::io_context& io_context) {
+    // 分片模式下io_context只有一个线程，strand不会产生竞争
+    auto socket = std::make_shared<tcp::socket>(boost::asio::make_strand(io_context));
+
+    acceptor.async_accept(*socket,
+        [this, socket, &acceptor, &io_context](const boost::system::error_code& error) {
             if (!error) {
-                // 使用带生命周期的请求处理
-                handle_request(socket);
+                // 先占用连接名额，超出上限时直接回503，不为其分配连接状态
+                if (open_connections_->fetch_add(1) >= config_.HTTP_MAX_CONNECTIONS) {
+                    (*open_connections_)--;
+                    reject_connection(socket);
+                }
+                else {
+                    // 使用带生命周期的请求处理，切换到该连接的strand上执行
+                    boost::asio::dispatch(socket->get_executor(), [this, socket]() {
+                        handle_request(socket);
+                        });
+                }
             }
             else {
                 if (error != boost::asio::error::operation_aborted) {
-                    std::cerr << "Accept error: " << error.message() << std::endl;
+                    LOG_ERROR("Accept error: " << error.message());
                 }
             }
 
             if (running_) {
-                start_accept();
+                start_accept(acceptor, io_context);
             }
         });
 }
 
+void HttpServer::reject_connection(std::shared_ptr<tcp::socket> socket) {
+    static const std::string response = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n"
+        "Retry-After: 1\r\nConnection: close\r\n\r\n";
+    HttpMetrics& metrics = http_metrics();
+    metrics.rejected.inc();
+    metrics.by_status(503).inc();
+
+    boost::asio::async_write(*socket, boost::asio::buffer(response),
+        [socket](const boost::system::error_code& /*error*/, std::size_t /*bytes_transferred*/) {
+            boost::system::error_code ignored;
+            socket->shutdown(tcp::socket::shutdown_both, ignored);
+            socket->close(ignored);
+        });
+}
+
 void HttpServer::handle_request(std::shared_ptr<tcp::socket> socket) {
-    auto request_data = std::make_shared<struct RequestData>();
-    request_data->socket = socket;
+    auto request_data = std::make_shared<RequestData>(socket, config_.HTTP_MAX_REQUEST_BYTES, open_connections_);
+    http_metrics().connections.add(1);
+    setup_pacing(*request_data);
+    read_request(request_data);
+}
+
+void HttpServer::read_request(std::shared_ptr<RequestData> request_data) {
+    // 流水线请求：上一个请求读取时已把后续请求一并读入缓冲区，直接处理
+    if (has_complete_header(request_data->buffer)) {
+        process_request(request_data);
+        return;
+    }
+
+    // 连接数接近上限时缩短空闲超时，优先回收空闲连接
+    int timeout = *open_connections_ >= config_.HTTP_MAX_CONNECTIONS * 3 / 4
+        ? config_.HTTP_BUSY_KEEP_ALIVE_TIMEOUT : config_.HTTP_KEEP_ALIVE_TIMEOUT;
+    arm_deadline(request_data, std::chrono::seconds(timeout), false);
 
-    // 异步读取请求
-    boost::asio::async_read_until(*socket, request_data->buffer, "\r\n\r\n",
-        [this, request_data](const boost::system::error_code& error, std::size_t bytes_transferred) {
+    // 异步读取请求；缓冲区有上限，请求头过大时以not_found结束
+    boost::asio::async_read_until(*request_data->socket, request_data->buffer, "\r\n\r\n",
+        [this, request_data](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
+            clear_deadline(*request_data);
+            update_buffer_accounting(*request_data);
+            // 在错误分支之前记下时刻，431等未解析的响应不会按默认值或上一个请求的时刻统计延迟
+            request_data->started = std::chrono::steady_clock::now();
+            if (error == boost::asio::error::not_found) {
+                request_data->keep_alive = false;
+                send_response(request_data, "431 Request Header Fields Too Large");
+                return;
+            }
             if (error) {
                 if (error == boost::asio::error::eof ||
-                    error == boost::asio::error::connection_reset) {
-                    // 正常断开连接
+                    error == boost::asio::error::connection_reset ||
+                    error == boost::asio::error::operation_aborted) {
+                    // 正常断开连接或空闲超时
                     return;
                 }
-                std::cerr << "Read error: " << error.message() << std::endl;
+                LOG_ERROR("Read error: " << error.message());
                 return;
             }
 
@@ -89,42 +414,181 @@ void HttpServer::handle_request(std::shared_ptr<tcp::socket> socket) {
         });
 }
 
+void HttpServer::arm_deadline(std::shared_ptr<RequestData> request_data, std::chrono::steady_clock::duration timeout,
+    bool writing) {
+    request_data->deadline_timer.expires_after(timeout);
+    // 只持有weak_ptr：连接因其他原因结束时，计时器不会延长连接状态的生命周期
+    std::weak_ptr<RequestData> weak = request_data;
+    request_data->deadline_timer.async_wait(
+        [weak, writing](const boost::system::error_code& error) {
+            auto request_data = weak.lock();
+            if (error == boost::asio::error::operation_aborted || !request_data ||
+                request_data->deadline_timer.expiry() > boost::asio::steady_timer::clock_type::now()) {
+                return;
+            }
+            // 空闲或发送超时，关闭连接以结束挂起的读写操作
+            (writing ? http_metrics().write_evictions : http_metrics().idle_evictions).inc();
+            boost::system::error_code ignored;
+            request_data->socket->close(ignored);
+        });
+}
+
+void HttpServer::clear_deadline(RequestData& request_data) {
+    // expiry设为max，使已排队的超时回调也能识别出操作已完成
+    request_data.deadline_timer.expires_at(boost::asio::steady_timer::time_point::max());
+}
+
+void HttpServer::arm_write_deadline(std::shared_ptr<RequestData> request_data, uint64_t response_bytes) {
+    // 基础时限加上按最低速率发送整个响应所需的时间，低于该速率的客户端被断开
+    // 服务器自身限速低于该下限时按限速计算，避免把被限速的连接当作慢客户端断开
+    size_t min_rate = config_.HTTP_MIN_SEND_RATE;
+    if (config_.HTTP_PACING_RATE > 0) {
+        min_rate = std::min(min_rate, config_.HTTP_PACING_RATE);
+    }
+    auto timeout = std::chrono::seconds(config_.HTTP_WRITE_TIMEOUT)
+        + std::chrono::seconds(response_bytes / std::max<size_t>(1, min_rate));
+    arm_deadline(request_data, timeout, true);
+}
+
+void HttpServer::setup_pacing(RequestData& request_data) {
+    if (config_.HTTP_PACING_RATE == 0) {
+        return;
+    }
+#if defined(__linux__) && defined(SO_MAX_PACING_RATE)
+    if (config_.HTTP_PACING_KERNEL) {
+        // 内核按速率把报文均匀排开，对sendfile同样生效，不占用事件循环
+        unsigned int rate = static_cast<unsigned int>(
+            std::min<size_t>(config_.HTTP_PACING_RATE, std::numeric_limits<unsigned int>::max()));
+        if (::setsockopt(request_data.socket->native_handle(), SOL_SOCKET, SO_MAX_PACING_RATE,
+            &rate, sizeof(rate)) == 0) {
+            return;
+        }
+        static std::atomic<bool> warned{ false };
+        if (!warned.exchange(true)) {
+            LOG_WARN("SO_MAX_PACING_RATE failed (" << std::strerror(errno)
+                << "), falling back to token bucket pacing");
+        }
+    }
+#endif
+    request_data.app_pacing = true;
+    request_data.pacing_tokens = static_cast<double>(std::max(config_.HTTP_PACING_BURST, FILE_CHUNK_SIZE));
+    request_data.pacing_refill = std::chrono::steady_clock::now();
+}
+
+size_t HttpServer::send_quantum() const {
+    return config_.HTTP_SEND_QUANTUM > 0 ? config_.HTTP_SEND_QUANTUM : std::numeric_limits<size_t>::max();
+}
+
+size_t HttpServer::pacing_budget(RequestData& request_data, size_t wanted) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - request_data.pacing_refill).count();
+    request_data.pacing_refill = now;
+    double capacity = static_cast<double>(std::max(config_.HTTP_PACING_BURST, FILE_CHUNK_SIZE));
+    request_data.pacing_tokens = std::min(capacity,
+        request_data.pacing_tokens + elapsed * static_cast<double>(config_.HTTP_PACING_RATE));
+    // 攒够一个发送块（或剩余内容）再发，避免刚等待完就以很小的块发送
+    request_data.pacing_needed = std::min(wanted, FILE_CHUNK_SIZE);
+    if (request_data.pacing_tokens < static_cast<double>(request_data.pacing_needed)) {
+        return 0;
+    }
+    return std::min(wanted, static_cast<size_t>(request_data.pacing_tokens));
+}
+
+void HttpServer::wait_for_pacing(std::shared_ptr<RequestData> request_data, std::function<void()> resume) {
+    double needed = static_cast<double>(request_data->pacing_needed) - request_data->pacing_tokens;
+    auto delay = std::chrono::duration<double>(std::max(needed, 1.0) / static_cast<double>(config_.HTTP_PACING_RATE));
+    http_metrics().pacing_waits.inc();
+    request_data->pacing_timer.expires_after(std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay));
+    request_data->pacing_timer.async_wait([resume = std::move(resume)](const boost::system::error_code& error) {
+        if (!error) {
+            resume();
+        }
+        });
+}
+
+void HttpServer::update_buffer_accounting(RequestData& request_data) {
+    size_t bytes = request_data.buffer.size() + request_data.chunk_buffer.capacity();
+    http_metrics().buffered_bytes.add(static_cast<double>(bytes) - static_cast<double>(request_data.accounted_bytes));
+    request_data.accounted_bytes = bytes;
+}
+
 void HttpServer::process_request(std::shared_ptr<RequestData> request_data) {
+    request_data->started = std::chrono::steady_clock::now();
     try {
-        std::istream stream(&request_data->buffer);
-        std::string request_line;
-        std::getline(stream, request_line);
+        // 直接在接收缓冲区上解析（streambuf的数据是连续的），解析结果指向缓冲区
+        auto received = request_data->buffer.data();
+        HttpRequestHead head;
+        HttpParseStatus status = parse_http_request_head(
+            std::string_view(static_cast<const char*>(received.data()), received.size()),
+            HttpParserLimits{ config_.HTTP_MAX_REQUEST_BYTES, config_.HTTP_MAX_HEADERS }, head);
+
+        request_data->requests_served++;
+        http_metrics().requests.inc();
 
-        // 解析请求行
-        std::istringstream iss(request_line);
-        std::string method, path, version;
-        iss >> method >> path >> version;
+        if (status != HttpParseStatus::Complete) {
+            // 请求边界不可信，丢弃缓冲区内容，回复后关闭连接
+            request_data->keep_alive = false;
+            request_data->buffer.consume(request_data->buffer.size());
+            send_response(request_data, status == HttpParseStatus::TooLarge ? "431 Request Header Fields Too Large"
+                : status == HttpParseStatus::UnsupportedVersion ? "505 HTTP Version Not Supported"
+                : "400 Bad Request");
+            return;
+        }
+
+        // 消费缓冲区之前复制到连接复用的字符串中；reset_response只clear不释放容量，
+        // keep-alive连接上的后续请求不再分配内存
+        request_data->method.assign(head.method);
+        request_data->path.assign(head.target);
+        request_data->version.assign(head.version);
+        request_data->range_header.assign(head.range);
+        request_data->if_none_match.assign(head.if_none_match);
+        request_data->if_modified_since.assign(head.if_modified_since);
+        request_data->if_range.assign(head.if_range);
+        if (head.version == "HTTP/1.1") {
+            request_data->keep_alive = !head.connection_close;
+        }
+        else {
+            request_data->keep_alive = head.connection_keep_alive && !head.connection_close;
+        }
+        // 本次请求的头部从缓冲区中完整取走，保留后续流水线请求
+        request_data->buffer.consume(head.head_bytes);
 
-        std::cout << "Request: " << method << " " << path << std::endl;
+        if (request_data->requests_served >= config_.HTTP_MAX_KEEP_ALIVE_REQUESTS || head.has_body) {
+            request_data->keep_alive = false;
+        }
 
-        if (method == "GET") {
-            // 确保path字符串的生命周期
-            request_data->path = path;
+        LOG_DEBUG("Request: " << request_data->method << " " << request_data->path);
+
+        if (request_data->method == "GET") {
             process_get_request(request_data);
         }
         else {
-            send_response(request_data->socket, "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n");
+            // 不解析请求体，无法安全地继续复用连接
+            request_data->keep_alive = false;
+            send_response(request_data, "405 Method Not Allowed");
         }
     }
     catch (const std::exception& e) {
-        std::cerr << "Request processing error: " << e.what() << std::endl;
+        LOG_ERROR("Request processing error: " << e.what());
     }
 }
 
 void HttpServer::process_get_request(std::shared_ptr<RequestData> request_data) {
     std::string clean_path = request_data->path;
+    std::string query;
 
     // 清理路径
     size_t query_pos = clean_path.find('?');
     if (query_pos != std::string::npos) {
+        query = clean_path.substr(query_pos + 1);
         clean_path = clean_path.substr(0, query_pos);
     }
 
+    if (clean_path == "/metrics") {
+        send_metrics(request_data);
+        return;
+    }
+
     // 默认路径
     if (clean_path == "/" || clean_path == "/index.html") {
         clean_path = "/" + config_.M3U8_FILENAME;
@@ -133,19 +597,274 @@ void HttpServer::process_get_request(std::shared_ptr<RequestData> request_data)
     // 构建文件路径 - 确保字符串生命周期
     request_data->file_path = config_.HLS_DIR + clean_path;
 
+    if (config_.LL_HLS_ENABLED) {
+        // 阻塞式播放列表刷新：_HLS_msn/_HLS_part指定的内容出现后才返回
+        std::string msn = query_param(query, "_HLS_msn");
+        if (clean_path == "/" + config_.M3U8_FILENAME && !msn.empty()) {
+            std::string part = query_param(query, "_HLS_part");
+            try {
+                request_data->hls_msn = std::stoll(msn);
+                request_data->hls_part = part.empty() ? -1 : std::stoi(part);
+            }
+            catch (const std::exception&) {
+                request_data->hls_msn = -1;
+            }
+            if (request_data->hls_msn < 0 || (!part.empty() && request_data->hls_part < 0)) {
+                send_response(request_data, "400 Bad Request");
+                return;
+            }
+            process_blocking_playlist(request_data);
+            return;
+        }
+
+        // 预加载提示指向的part还在写入，挂起到muxer写完
+        if (clean_path.starts_with("/" + config_.LL_HLS_PART_PREFIX) && clean_path.ends_with(".ts")) {
+            if (!blocking_satisfied(*request_data, read_ll_playlist_state())) {
+                park_request(request_data);
+                return;
+            }
+        }
+    }
+
+    // 后台转码还没写完第一个切片：挂起播放列表请求（含多码率各档的播放列表），避免播放器拿到404后放弃
+    if (playlist_pending_ && clean_path.ends_with(".m3u8") &&
+        !std::filesystem::exists(request_data->file_path)) {
+        request_data->await_playlist = true;
+        park_request(request_data);
+        return;
+    }
+
+    // 按需转码的切片还没生成：已安排转码，挂起到切片写完
+    if (segment_hook_ && clean_path.ends_with(".ts")) {
+        SegmentAvailability availability = segment_hook_(request_data->file_path);
+        if (availability == SegmentAvailability::Failed) {
+            send_segment_unavailable(request_data);
+            return;
+        }
+        if (availability == SegmentAvailability::Pending) {
+            request_data->await_segment = true;
+            park_request(request_data);
+            return;
+        }
+    }
+
+    // 切片与播放列表优先从内存缓存发送
+    if (segment_cache_ && (clean_path.ends_with(".ts") || clean_path.ends_with(".m3u8"))) {
+        segment_cache_->fetch(request_data->file_path,
+            [this, request_data](std::shared_ptr<const CachedFile> body, std::error_code error) {
+                // 加载可能在其他连接的线程上完成，切回本连接的strand
+                boost::asio::dispatch(request_data->socket->get_executor(),
+                    [this, request_data, body = std::move(body), error]() {
+                        if (body) {
+                            request_data->cached_body = body;
+                            send_cached(request_data);
+                        }
+                        else if (error) {
+                            LOG_DEBUG("File not found: " << request_data->file_path);
+                            send_response(request_data, "404 Not Found");
+                        }
+                        else {
+                            serve_from_disk(request_data);
+                        }
+                    });
+            });
+        return;
+    }
+
+    serve_from_disk(request_data);
+}
+
+void HttpServer::process_blocking_playlist(std::shared_ptr<RequestData> request_data) {
+    std::string body;
+    if (!read_text_file(request_data->file_path, body)) {
+        // 播放列表还没生成，同样挂起等待
+        park_request(request_data);
+        return;
+    }
+
+    LLPlaylistState state = parse_ll_playlist_state(body);
+    if (blocking_satisfied(*request_data, state)) {
+        // 直接读磁盘，绕过播放列表缓存的TTL
+        serve_from_disk(request_data);
+        return;
+    }
+
+    // 请求的切片距离当前直播点太远，规范要求返回400
+    if (state.valid && !state.ended && request_data->hls_msn > state.last_complete_msn + 2) {
+        send_response(request_data, "400 Bad Request");
+        return;
+    }
+    park_request(request_data);
+}
+
+bool HttpServer::blocking_satisfied(const RequestData& request_data, const LLPlaylistState& state) const {
+    if (!state.valid) return false;
+    if (state.ended) return true;
+
+    if (request_data.hls_msn < 0) {
+        // 等待part文件：编号在预加载提示之前的part已完整写出
+        int64_t part = part_number_from_uri(request_data.file_path);
+        return part >= 0 && (state.preload_part < 0 || part < state.preload_part);
+    }
+    if (request_data.hls_msn <= state.last_complete_msn) return true;
+    return request_data.hls_part >= 0 &&
+        request_data.hls_msn == state.last_complete_msn + 1 &&
+        request_data.hls_part < state.next_part_count;
+}
+
+void HttpServer::park_request(std::shared_ptr<RequestData> request_data) {
+    // 最多挂起3个目标时长，超时后返回当前内容
+    request_data->block_deadline = std::chrono::steady_clock::now() +
+        std::chrono::seconds(3 * config_.HLS_SEGMENT_DURATION);
+
+    {
+        std::lock_guard<std::mutex> lock(blocked_mutex_);
+        blocked_requests_.push_back(request_data);
+        // 挂起时长固定，后挂起的请求不会比已在等待的更早到期
+        if (!blocked_timer_armed_) {
+            arm_blocked_timer(request_data->block_deadline);
+        }
+    }
+
+    // 检查条件与挂起之间生成器可能已写完并发出通知，挂起后再确认一次，否则要等到超时
+    LLPlaylistState state;
+    if (!request_data->await_segment && !request_data->await_playlist) {
+        state = read_ll_playlist_state();
+    }
+    RequestData* parked = request_data.get();
+    recheck_blocked_requests([parked](const RequestData& waiting) { return &waiting == parked; }, state);
+}
+
+void HttpServer::arm_blocked_timer(std::chrono::steady_clock::time_point deadline) {
+    // 调用方需持有blocked_mutex_；定时器只负责挂起超时，条件满足由生成器的通知唤醒
+    blocked_timer_armed_ = true;
+    blocked_timer_.expires_at(deadline);
+    blocked_timer_.async_wait([this](const boost::system::error_code& error) {
+        if (error != boost::asio::error::operation_aborted) {
+            expire_blocked_requests();
+        }
+        });
+}
+
+void HttpServer::expire_blocked_requests() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<RequestData>> expired;
+    {
+        std::lock_guard<std::mutex> lock(blocked_mutex_);
+        auto it = std::stable_partition(blocked_requests_.begin(), blocked_requests_.end(),
+            [&](const std::shared_ptr<RequestData>& request_data) { return request_data->block_deadline > now; });
+        expired.assign(std::make_move_iterator(it), std::make_move_iterator(blocked_requests_.end()));
+        blocked_requests_.erase(it, blocked_requests_.end());
+        for (auto& request_data : expired) {
+            if (request_data->await_segment) {
+                segment_pending(*request_data);   // 按需转码已失败时标记segment_failed
+            }
+        }
+
+        // 保持挂起顺序，队首即最早到期的请求
+        blocked_timer_armed_ = false;
+        if (!blocked_requests_.empty() && running_) {
+            arm_blocked_timer(blocked_requests_.front()->block_deadline);
+        }
+    }
+    resume_blocked_requests(std::move(expired));
+}
+
+void HttpServer::wake_blocked_requests(const std::string& file_path) {
+    // 在io_context_上执行，不占用调用通知的转码线程
+    std::filesystem::path written = std::filesystem::path(file_path).lexically_normal();
+    bool playlist_updated = config_.LL_HLS_ENABLED &&
+        written == std::filesystem::path(config_.HLS_DIR + "/" + config_.M3U8_FILENAME).lexically_normal();
+
+    // 主播放列表更新时只读一次，所有等待它的请求共用
+    LLPlaylistState state;
+    if (playlist_updated) {
+        state = read_ll_playlist_state();
+    }
+    recheck_blocked_requests([&](const RequestData& request_data) {
+        if (!request_data.await_segment && !request_data.await_playlist) {
+            return playlist_updated;
+        }
+        return std::filesystem::path(request_data.file_path).lexically_normal() == written;
+        }, state);
+}
+
+void HttpServer::recheck_blocked_requests(const std::function<bool(const RequestData&)>& matches,
+    const LLPlaylistState& state) {
+    std::vector<std::shared_ptr<RequestData>> ready;
+    {
+        std::lock_guard<std::mutex> lock(blocked_mutex_);
+        auto it = std::stable_partition(blocked_requests_.begin(), blocked_requests_.end(),
+            [&](const std::shared_ptr<RequestData>& request_data) {
+                return !matches(*request_data) || still_blocked(*request_data, state);
+            });
+        ready.assign(std::make_move_iterator(it), std::make_move_iterator(blocked_requests_.end()));
+        blocked_requests_.erase(it, blocked_requests_.end());
+    }
+    resume_blocked_requests(std::move(ready));
+}
+
+bool HttpServer::still_blocked(RequestData& request_data, const LLPlaylistState& state) const {
+    if (request_data.await_segment) {
+        return segment_pending(request_data);
+    }
+    if (request_data.await_playlist) {
+        return playlist_pending_ && !std::filesystem::exists(request_data.file_path);
+    }
+    return !blocking_satisfied(request_data, state);
+}
+
+void HttpServer::resume_blocked_requests(std::vector<std::shared_ptr<RequestData>> ready) {
+    for (auto& request_data : ready) {
+        boost::asio::dispatch(request_data->socket->get_executor(), [this, request_data]() {
+            if (request_data->segment_failed) {
+                send_segment_unavailable(request_data);
+                return;
+            }
+            serve_from_disk(request_data);
+            });
+    }
+}
+
+LLPlaylistState HttpServer::read_ll_playlist_state() const {
+    std::string body;
+    LLPlaylistState state;
+    if (config_.LL_HLS_ENABLED && read_text_file(config_.HLS_DIR + "/" + config_.M3U8_FILENAME, body)) {
+        state = parse_ll_playlist_state(body);
+    }
+    return state;
+}
+
+bool HttpServer::segment_pending(RequestData& request_data) const {
+    // 调用方持有blocked_mutex_；JitTranscoder不会反过来获取它
+    if (segment_state_hook_ &&
+        segment_state_hook_(request_data.file_path) == SegmentAvailability::Failed) {
+        request_data.segment_failed = true;
+        return false;
+    }
+    return !std::filesystem::exists(request_data.file_path);
+}
+
+void HttpServer::send_segment_unavailable(std::shared_ptr<RequestData> request_data) {
+    // 再次请求时会重新安排转码，约一个切片时长后重试
+    send_response(request_data, "503 Service Unavailable",
+        "Retry-After: " + std::to_string(std::max(1, config_.HLS_SEGMENT_DURATION)) + "\r\n");
+}
+
+void HttpServer::serve_from_disk(std::shared_ptr<RequestData> request_data) {
     // 检查文件是否存在
     std::error_code ec;
     if (!std::filesystem::exists(request_data->file_path, ec)) {
-        std::cout << "File not found: " << request_data->file_path << std::endl;
-        send_response(request_data->socket, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        LOG_DEBUG("File not found: " << request_data->file_path);
+        send_response(request_data, "404 Not Found");
         return;
     }
 
     // 获取文件大小
     request_data->file_size = std::filesystem::file_size(request_data->file_path, ec);
     if (ec) {
-        std::cerr << "Failed to get file size: " << ec.message() << std::endl;
-        send_response(request_data->socket, "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n");
+        LOG_ERROR("Failed to get file size: " << ec.message());
+        send_response(request_data, "500 Internal Server Error");
         return;
     }
 
@@ -154,88 +873,547 @@ void HttpServer::process_get_request(std::shared_ptr<RequestData> request_data)
 }
 
 void HttpServer::send_file(std::shared_ptr<RequestData> request_data) {
-    // 打开文件
-    request_data->file_stream = std::make_shared<std::ifstream>(
-        request_data->file_path, std::ios::binary);
+    // 普通文件走sendfile零拷贝路径，其余情况（非普通文件/非Linux/HTTP_ZERO_COPY关闭）回退到分块读取
+    bool zero_copy = config_.HTTP_ZERO_COPY && open_zero_copy(request_data);
+
+    if (!zero_copy) {
+        request_data->file_stream = std::make_shared<std::ifstream>(
+            request_data->file_path, std::ios::binary);
+
+        if (!request_data->file_stream->is_open()) {
+            LOG_ERROR("Failed to open file: " << request_data->file_path);
+            send_response(request_data, "404 Not Found");
+            return;
+        }
+        request_data->validators = load_file_validators(request_data->file_path, request_data->file_size);
+    }
+
+    if (!prepare_response(request_data, request_data->file_size)) {
+        return;
+    }
+
+#if defined(__linux__)
+    if (zero_copy) {
+        set_tcp_cork(*request_data->socket, true);
+    }
+#endif
+
+    LOG_DEBUG("Sending file: " << request_data->file_path
+        << " (" << request_data->file_size << " bytes)");
+    send_parts(request_data);
+}
 
-    if (!request_data->file_stream->is_open()) {
-        std::cerr << "Failed to open file: " << request_data->file_path << std::endl;
-        send_response(request_data->socket, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+void HttpServer::send_cached(std::shared_ptr<RequestData> request_data) {
+    request_data->file_size = request_data->cached_body->body.size();
+    request_data->validators = request_data->cached_body->validators;
+    if (!prepare_response(request_data, request_data->file_size)) {
         return;
     }
+    send_parts(request_data);
+}
+
+void HttpServer::send_metrics(std::shared_ptr<RequestData> request_data) {
+    // 命中、未命中与淘汰是SegmentCache直接累加的计数器；占用量是当前值，导出时同步到仪表
+    Metrics& registry = Metrics::instance();
+    SegmentCache::Stats stats = cache_stats();
+    registry.gauge("hls_segment_cache_bytes", "Bytes held by the segment cache").set(static_cast<double>(stats.bytes));
+    registry.gauge("hls_segment_cache_entries", "Entries held by the segment cache").set(static_cast<double>(stats.entries));
+
+    // 指标文本放进CachedFile，沿用缓存命中的发送路径
+    auto body = std::make_shared<CachedFile>();
+    body->body = registry.render();
+    request_data->cached_body = body;
+    request_data->file_size = body->body.size();
+    request_data->parts.clear();
+    request_data->part_index = 0;
+    request_data->parts.push_back(ResponsePart{
+        build_response_header(*request_data, "200 OK", "text/plain; version=0.0.4; charset=utf-8",
+            request_data->file_size, ""), 0, request_data->file_size });
+    send_parts(request_data);
+}
+
+bool HttpServer::prepare_response(std::shared_ptr<RequestData> request_data, uint64_t total_size) {
+    auto& parts = request_data->parts;
+    parts.clear();
+    request_data->part_index = 0;
+
+    // 条件请求：客户端缓存仍有效时只返回304头部
+    if (is_not_modified(*request_data)) {
+        std::ostringstream header;
+        header << "HTTP/1.1 304 Not Modified\r\n";
+        if (!request_data->validators.etag.empty()) {
+            header << "ETag: " << request_data->validators.etag << "\r\n"
+                << "Last-Modified: " << request_data->validators.last_modified << "\r\n";
+        }
+        header << "Cache-Control: " << get_cache_control(request_data->file_path) << "\r\n"
+            << "Access-Control-Allow-Origin: *\r\n"
+            << connection_header(*request_data) << "\r\n";
+        parts.push_back(ResponsePart{ header.str(), 0, 0 });
+        return true;
+    }
+
+    std::vector<ByteRange> ranges;
+    RangeParseResult result = RangeParseResult::None;
+    if (!request_data->range_header.empty() && range_allowed(*request_data)) {
+        result = parse_range_header(request_data->range_header, total_size, ranges);
+    }
+
+    if (result == RangeParseResult::Unsatisfiable) {
+        send_response(request_data, "416 Range Not Satisfiable",
+            "Content-Range: bytes */" + std::to_string(total_size) + "\r\n");
+        return false;
+    }
 
-    // 构建HTTP头 - 确保字符串生命周期
     std::string content_type = get_content_type(request_data->file_path);
+
+    if (result == RangeParseResult::None) {
+        parts.push_back(ResponsePart{
+            build_response_header(*request_data, "200 OK", content_type, total_size, ""), 0, total_size });
+    }
+    else if (ranges.size() == 1) {
+        const ByteRange& range = ranges.front();
+        parts.push_back(ResponsePart{
+            build_response_header(*request_data, "206 Partial Content", content_type, range.length,
+                "Content-Range: " + content_range_value(range, total_size) + "\r\n"),
+            range.start, range.length });
+    }
+    else {
+        // 多范围：multipart/byteranges，每个范围前写入分隔行与该段的Content-Range
+        static std::atomic<uint64_t> boundary_counter{ 0 };
+        std::ostringstream boundary_stream;
+        boundary_stream << "HLS_BYTERANGES_" << std::hex
+            << std::chrono::steady_clock::now().time_since_epoch().count() << "_" << boundary_counter++;
+        std::string boundary = boundary_stream.str();
+
+        uint64_t content_length = 0;
+        std::vector<ResponsePart> body_parts;
+        for (const auto& range : ranges) {
+            std::string prefix = "\r\n--" + boundary + "\r\nContent-Type: " + content_type
+                + "\r\nContent-Range: " + content_range_value(range, total_size) + "\r\n\r\n";
+            content_length += prefix.size() + range.length;
+            body_parts.push_back(ResponsePart{ std::move(prefix), range.start, range.length });
+        }
+        std::string closing = "\r\n--" + boundary + "--\r\n";
+        content_length += closing.size();
+
+        parts.push_back(ResponsePart{
+            build_response_header(*request_data, "206 Partial Content",
+                "multipart/byteranges; boundary=" + boundary, content_length, ""), 0, 0 });
+        for (auto& part : body_parts) {
+            parts.push_back(std::move(part));
+        }
+        parts.push_back(ResponsePart{ std::move(closing), 0, 0 });
+    }
+    return true;
+}
+
+std::string HttpServer::build_response_header(const RequestData& request_data, const std::string& status,
+    const std::string& content_type, uint64_t content_length, const std::string& extra_headers) {
     std::ostringstream header;
-    header << "HTTP/1.1 200 OK\r\n"
+    header << "HTTP/1.1 " << status << "\r\n"
         << "Content-Type: " << content_type << "\r\n"
-        << "Content-Length: " << request_data->file_size << "\r\n"
-        << "Access-Control-Allow-Origin: *\r\n"
-        << "Cache-Control: no-cache\r\n"
-        << "Connection: close\r\n\r\n";
+        << "Content-Length: " << content_length << "\r\n"
+        << "Accept-Ranges: bytes\r\n"
+        << extra_headers;
+    if (!request_data.validators.etag.empty()) {
+        header << "ETag: " << request_data.validators.etag << "\r\n"
+            << "Last-Modified: " << request_data.validators.last_modified << "\r\n";
+    }
+    header << "Access-Control-Allow-Origin: *\r\n"
+        << "Cache-Control: " << get_cache_control(request_data.file_path) << "\r\n"
+        << connection_header(request_data) << "\r\n";
+    return header.str();
+}
+
+bool HttpServer::is_not_modified(const RequestData& request_data) const {
+    const FileValidators& validators = request_data.validators;
+    if (validators.etag.empty()) {
+        return false;
+    }
+    // If-None-Match优先；存在时忽略If-Modified-Since
+    if (!request_data.if_none_match.empty()) {
+        return etag_matches(request_data.if_none_match, validators.etag);
+    }
+    if (!request_data.if_modified_since.empty()) {
+        std::chrono::system_clock::time_point since;
+        return parse_http_date(request_data.if_modified_since, since) && validators.mtime <= since;
+    }
+    return false;
+}
+
+bool HttpServer::range_allowed(const RequestData& request_data) const {
+    // If-Range与当前版本不一致时忽略Range，返回完整的新内容
+    if (request_data.if_range.empty()) {
+        return true;
+    }
+    const FileValidators& validators = request_data.validators;
+    if (request_data.if_range.front() == '"') {
+        return request_data.if_range == validators.etag;
+    }
+    return request_data.if_range == validators.last_modified;
+}
+
+std::string HttpServer::get_cache_control(const std::string& path) const {
+    if (path.ends_with(".ts")) {
+        // 只有显式启用检查点或按需转码时切片才会被同名文件替换，此时下游须按ETag重新验证（未变化时只返回304）；
+        // 默认配置下切片写完不再改变，保持immutable
+        if (config_.HLS_CHECKPOINT || config_.JIT_ENABLED) {
+            return "public, no-cache";
+        }
+        return "public, max-age=" + std::to_string(config_.HLS_SEGMENT_MAX_AGE) + ", immutable";
+    }
+    else if (path.ends_with(".m3u8")) {
+        return "public, max-age=" + std::to_string(config_.HLS_PLAYLIST_MAX_AGE);
+    }
+    // 其他文件（如录制的mp4）可能被覆盖，要求每次用校验信息重新验证
+    return "no-cache";
+}
+
+void HttpServer::send_parts(std::shared_ptr<RequestData> request_data) {
+    if (request_data->part_index == 0) {
+        uint64_t response_bytes = 0;
+        for (const auto& part : request_data->parts) {
+            response_bytes += part.prefix.size() + part.length;
+        }
+        arm_write_deadline(request_data, response_bytes);
+    }
+
+    if (request_data->part_index >= request_data->parts.size()) {
+#if defined(__linux__)
+        if (request_data->file_fd >= 0) {
+            set_tcp_cork(*request_data->socket, false);
+        }
+#endif
+        LOG_DEBUG("File sent completely: " << request_data->file_path);
+        finish_response(request_data);
+        return;
+    }
+
+    const ResponsePart& part = request_data->parts[request_data->part_index];
+
+    if (request_data->cached_body) {
+        request_data->file_offset = part.offset;
+        send_cached_body(request_data, true);
+        return;
+    }
 
-    request_data->header = header.str();
+    if (part.prefix.empty()) {
+        send_part_body(request_data);
+        return;
+    }
 
-    // 发送HTTP头
-    boost::asio::async_write(*request_data->socket,
-        boost::asio::buffer(request_data->header),
+    boost::asio::async_write(*request_data->socket, boost::asio::buffer(part.prefix),
         [this, request_data](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
-            if (!error) {
-                std::cout << "Sending file: " << request_data->file_path
-                    << " (" << request_data->file_size << " bytes)" << std::endl;
-                // 发送文件内容
-                send_file_content(request_data, 0);
+            if (error) {
+                LOG_ERROR("Write header error: " << error.message());
+                return;
             }
-            else {
-                std::cerr << "Write header error: " << error.message() << std::endl;
+            send_part_body(request_data);
+        });
+}
+
+void HttpServer::send_cached_body(std::shared_ptr<RequestData> request_data, bool with_prefix) {
+    const ResponsePart& part = request_data->parts[request_data->part_index];
+    uint64_t part_end = part.offset + part.length;
+    size_t chunk = static_cast<size_t>(part_end - request_data->file_offset);
+
+    // 不限速时整段内容一次写出（async_write每次write_some后都会让出线程）；限速时按令牌分块
+    if (request_data->app_pacing && chunk > 0) {
+        chunk = pacing_budget(*request_data, std::min<size_t>(chunk, send_quantum()));
+        if (chunk == 0) {
+            wait_for_pacing(request_data, [this, request_data, with_prefix]() {
+                send_cached_body(request_data, with_prefix);
+                });
+            return;
+        }
+    }
+
+    // 分段头与内存中的内容切片一次聚集写出，内容本身不复制
+    std::array<boost::asio::const_buffer, 2> buffers = {
+        with_prefix ? boost::asio::buffer(part.prefix) : boost::asio::const_buffer(),
+        boost::asio::buffer(request_data->cached_body->body.data() + request_data->file_offset, chunk)
+    };
+    boost::asio::async_write(*request_data->socket, buffers,
+        [this, request_data, chunk, part_end](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
+            if (error) {
+                LOG_ERROR("Write cached content error: " << error.message());
+                return;
             }
+            if (request_data->app_pacing) {
+                request_data->pacing_tokens -= static_cast<double>(chunk);
+            }
+            request_data->file_offset += chunk;
+            if (request_data->file_offset < part_end) {
+                send_cached_body(request_data, false);
+                return;
+            }
+            request_data->part_index++;
+            send_parts(request_data);
         });
 }
 
+void HttpServer::send_part_body(std::shared_ptr<RequestData> request_data) {
+    const ResponsePart& part = request_data->parts[request_data->part_index];
+    if (part.length == 0) {
+        request_data->part_index++;
+        send_parts(request_data);
+        return;
+    }
+
+    request_data->file_offset = part.offset;
+    if (request_data->file_fd >= 0) {
+        send_file_zero_copy(request_data);
+    }
+    else {
+        request_data->file_stream->clear();
+        request_data->file_stream->seekg(static_cast<std::streamoff>(part.offset));
+        send_file_content(request_data, 0);
+    }
+}
+
+bool HttpServer::open_zero_copy(std::shared_ptr<RequestData> request_data) {
+#if defined(__linux__)
+    int fd = ::open(request_data->file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    request_data->file_fd = fd;
+    request_data->file_offset = 0;
+    // 以打开后的实际大小为准，避免exists/file_size与open之间文件被替换
+    request_data->file_size = static_cast<size_t>(st.st_size);
+    auto mtime = std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec);
+    request_data->validators = make_file_validators(request_data->file_size,
+        std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(mtime)));
+    return true;
+#else
+    (void)request_data;
+    return false;
+#endif
+}
+
+void HttpServer::send_file_zero_copy(std::shared_ptr<RequestData> request_data) {
+#if defined(__linux__)
+    auto& socket = *request_data->socket;
+    boost::system::error_code ec;
+    socket.native_non_blocking(true, ec);
+    if (ec) {
+        LOG_ERROR("Failed to set non-blocking socket: " << ec.message());
+        return;
+    }
+
+    const ResponsePart& part = request_data->parts[request_data->part_index];
+    const uint64_t part_end = part.offset + part.length;
+    const size_t quantum = send_quantum();
+    size_t turn_sent = 0;
+
+    while (request_data->file_offset < part_end) {
+        // 本轮发送满一个quantum后重新排队，让同一线程上其他连接的传输轮流推进
+        if (turn_sent >= quantum) {
+            http_metrics().send_yields.inc();
+            boost::asio::post(socket.get_executor(), [this, request_data]() {
+                send_file_zero_copy(request_data);
+                });
+            return;
+        }
+
+        off_t offset = static_cast<off_t>(request_data->file_offset);
+        size_t remaining = static_cast<size_t>(std::min<uint64_t>(part_end - request_data->file_offset,
+            quantum - turn_sent));
+        if (request_data->app_pacing) {
+            remaining = pacing_budget(*request_data, remaining);
+            if (remaining == 0) {
+                wait_for_pacing(request_data, [this, request_data]() {
+                    send_file_zero_copy(request_data);
+                    });
+                return;
+            }
+        }
+        ssize_t sent = ::sendfile(socket.native_handle(), request_data->file_fd, &offset, remaining);
+
+        if (sent > 0) {
+            request_data->file_offset = static_cast<uint64_t>(offset);
+            turn_sent += static_cast<size_t>(sent);
+            if (request_data->app_pacing) {
+                request_data->pacing_tokens -= static_cast<double>(sent);
+            }
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // 发送缓冲区已满，等待socket可写后继续
+            socket.async_wait(tcp::socket::wait_write,
+                [this, request_data](const boost::system::error_code& error) {
+                    if (!error) {
+                        send_file_zero_copy(request_data);
+                    }
+                    else {
+                        LOG_ERROR("Wait writable error: " << error.message());
+                    }
+                });
+            return;
+        }
+
+        if (sent == 0) {
+            LOG_ERROR("File truncated while sending: " << request_data->file_path);
+        }
+        else {
+            LOG_ERROR("sendfile error: " << std::strerror(errno));
+        }
+        return;
+    }
+
+    request_data->part_index++;
+    send_parts(request_data);
+#else
+    send_file_content(request_data, 0);
+#endif
+}
+
 void HttpServer::send_file_content(std::shared_ptr<RequestData> request_data, size_t bytes_sent) {
-    if (bytes_sent >= request_data->file_size) {
-        std::cout << "File sent completely: " << request_data->file_path << std::endl;
+    const ResponsePart& part = request_data->parts[request_data->part_index];
+    if (bytes_sent >= part.length) {
+        request_data->part_index++;
+        send_parts(request_data);
         return;
     }
 
-    // 读取文件块
-    auto buffer = std::make_shared<std::vector<char>>(8192);
-    request_data->file_stream->read(buffer->data(), buffer->size());
+    // 读取文件块（整个请求复用同一个缓冲区）
+    if (request_data->chunk_buffer.empty()) {
+        request_data->chunk_buffer.resize(FILE_CHUNK_SIZE);
+    }
+    auto& buffer = request_data->chunk_buffer;
+    size_t to_read = static_cast<size_t>(std::min<uint64_t>(buffer.size(), part.length - bytes_sent));
+    if (request_data->app_pacing) {
+        to_read = pacing_budget(*request_data, to_read);
+        if (to_read == 0) {
+            wait_for_pacing(request_data, [this, request_data, bytes_sent]() {
+                send_file_content(request_data, bytes_sent);
+                });
+            return;
+        }
+    }
+    request_data->file_stream->read(buffer.data(), static_cast<std::streamsize>(to_read));
     std::streamsize bytes_read = request_data->file_stream->gcount();
 
     if (bytes_read > 0) {
         // 发送文件块
         boost::asio::async_write(*request_data->socket,
-            boost::asio::buffer(buffer->data(), bytes_read),
-            [this, request_data, bytes_sent, bytes_read, buffer]
+            boost::asio::buffer(buffer.data(), static_cast<size_t>(bytes_read)),
+            [this, request_data, bytes_sent, bytes_read]
             (const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
                 if (!error) {
+                    if (request_data->app_pacing) {
+                        request_data->pacing_tokens -= static_cast<double>(bytes_read);
+                    }
                     // 递归发送下一块
                     send_file_content(request_data, bytes_sent + bytes_read);
                 }
                 else {
-                    std::cerr << "Write file content error: " << error.message() << std::endl;
+                    LOG_ERROR("Write file content error: " << error.message());
                 }
             });
     }
     else {
-        // 文件读取完成
-        std::cout << "File send completed: " << request_data->file_path << std::endl;
+        // 文件比声明的Content-Length短，响应已不完整，只能关闭连接
+        LOG_ERROR("File truncated while sending: " << request_data->file_path);
     }
 }
 
-void HttpServer::send_response(std::shared_ptr<tcp::socket> socket, const std::string& response) {
-    // 确保响应字符串的生命周期
-    auto response_copy = std::make_shared<std::string>(response);
+void HttpServer::send_response(std::shared_ptr<RequestData> request_data, const std::string& status,
+    const std::string& extra_headers) {
+    // 响应字符串保存在连接状态中，保证异步写期间的生命周期
+    request_data->header = "HTTP/1.1 " + status + "\r\nContent-Length: 0\r\n"
+        + extra_headers + connection_header(*request_data) + "\r\n";
+    arm_write_deadline(request_data, request_data->header.size());
 
-    boost::asio::async_write(*socket, boost::asio::buffer(*response_copy),
-        [socket, response_copy](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
+    boost::asio::async_write(*request_data->socket, boost::asio::buffer(request_data->header),
+        [this, request_data](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
             if (error) {
-                std::cerr << "Write response error: " << error.message() << std::endl;
+                LOG_ERROR("Write response error: " << error.message());
+                return;
             }
+            finish_response(request_data);
         });
 }
 
+void HttpServer::record_response(const RequestData& request_data) {
+    // 状态码取自状态行"HTTP/1.1 NNN ..."
+    const std::string& head = !request_data.header.empty() || request_data.parts.empty()
+        ? request_data.header : request_data.parts.front().prefix;
+    int code = head.size() > 12 ? std::atoi(head.c_str() + 9) : 0;
+
+    uint64_t bytes = request_data.header.size();
+    for (const auto& part : request_data.parts) {
+        bytes += part.prefix.size() + part.length;
+    }
+
+    HttpMetrics& metrics = http_metrics();
+    metrics.by_status(code).inc();
+    metrics.response_bytes.inc(bytes);
+    metrics.latency.observe(std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - request_data.started).count());
+}
+
+void HttpServer::finish_response(std::shared_ptr<RequestData> request_data) {
+    clear_deadline(*request_data);
+    record_response(*request_data);
+    update_buffer_accounting(*request_data);
+
+    if (!request_data->keep_alive || !running_) {
+        boost::system::error_code ignored;
+        request_data->socket->shutdown(tcp::socket::shutdown_both, ignored);
+        request_data->socket->close(ignored);
+        return;
+    }
+
+    // 复用连接：清理本次响应状态，继续读取（或直接处理已缓冲的）下一个请求
+    request_data->reset_response();
+    read_request(request_data);
+}
+
+void HttpServer::notify_file_written(const std::string& file_path) {
+    if (segment_cache_) {
+        segment_cache_->invalidate(file_path);
+    }
+    {
+        std::lock_guard<std::mutex> lock(blocked_mutex_);
+        if (blocked_requests_.empty()) return;
+    }
+    boost::asio::post(io_context_, [this, file_path]() { wake_blocked_requests(file_path); });
+}
+
+void HttpServer::set_playlist_pending(bool pending) {
+    playlist_pending_ = pending;
+    if (!pending) {
+        // 转码已结束（无论成败），仍在等待播放列表的请求不会再等到通知，按当前文件返回
+        boost::asio::post(io_context_, [this]() {
+            recheck_blocked_requests([](const RequestData& request_data) { return request_data.await_playlist; },
+                LLPlaylistState{});
+            });
+    }
+}
+
+SegmentCache::Stats HttpServer::cache_stats() const {
+    return segment_cache_ ? segment_cache_->stats() : SegmentCache::Stats{};
+}
+
+std::string HttpServer::connection_header(const RequestData& request_data) const {
+    if (!request_data.keep_alive) {
+        return "Connection: close\r\n";
+    }
+    return "Connection: keep-alive\r\nKeep-Alive: timeout=" + std::to_string(config_.HTTP_KEEP_ALIVE_TIMEOUT)
+        + ", max=" + std::to_string(config_.HTTP_MAX_KEEP_ALIVE_REQUESTS - request_data.requests_served) + "\r\n";
+}
+
 std::string HttpServer::get_content_type(const std::string& path) {
     if (path.ends_with(".m3u8")) {
         return "application/vnd.apple.mpegurl";
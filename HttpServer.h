@@ -3,21 +3,74 @@
 #define HTTP_SERVER_H
 
 #include "config.h"
+#include "segment_cache.h"
+#include "file_reader.h"
+#include "ll_hls_playlist.h"
 #include <string>
 #include <thread>
 #include <atomic>
 #include <memory>
 #include <fstream>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <functional>
 #include <boost/asio.hpp>
 
+// 响应的一段：先写prefix（状态行/头部或multipart分隔），再发送内容中[offset, offset+length)
+struct ResponsePart {
+    std::string prefix;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+// 单个连接的状态，keep-alive时在多个请求之间复用
 struct RequestData {
     std::shared_ptr<boost::asio::ip::tcp::socket> socket;
     boost::asio::streambuf buffer;
+    boost::asio::steady_timer deadline_timer;   // 读请求时为空闲超时，写响应时为发送时限
+    std::shared_ptr<std::atomic<int>> connection_slot;   // 析构时归还的全局连接计数
+    size_t accounted_bytes = 0;                  // 已计入缓冲区指标的字节数
+    bool keep_alive = false;
+    int requests_served = 0;
+    std::chrono::steady_clock::time_point started;   // 本次请求读完或开始解析的时刻，延迟从这里算起
+
+    std::string method;
+    std::string version;
     std::string path;
+    std::string range_header;
+    std::string if_none_match;
+    std::string if_modified_since;
+    std::string if_range;
+    int64_t hls_msn = -1;             // 阻塞式刷新：_HLS_msn，-1表示普通请求
+    int hls_part = -1;                // 阻塞式刷新：_HLS_part，-1表示等待整个切片
+    bool await_playlist = false;      // 后台转码尚未写出播放列表，等待其出现
+    bool await_segment = false;       // 按需转码正在生成该切片，等待其出现
+    bool segment_failed = false;      // 等待期间按需转码失败，回503
+    std::chrono::steady_clock::time_point block_deadline;
+    FileValidators validators;
     std::string file_path;
     std::string header;
     size_t file_size = 0;
+    std::vector<ResponsePart> parts;
+    size_t part_index = 0;
     std::shared_ptr<std::ifstream> file_stream;
+    std::shared_ptr<const CachedFile> cached_body;   // 缓存命中时发送的内容
+    std::vector<char> chunk_buffer;   // 回退路径复用的读缓冲区
+    int file_fd = -1;                 // 零拷贝路径使用的文件描述符
+    uint64_t file_offset = 0;         // 零拷贝与缓存路径的发送进度
+
+    // 用户态令牌桶限速，HTTP_PACING_RATE为0或已由内核SO_MAX_PACING_RATE限速时不启用；跨请求保留
+    bool app_pacing = false;
+    double pacing_tokens = 0;
+    size_t pacing_needed = 0;         // 令牌不足时等待攒够的字节数
+    std::chrono::steady_clock::time_point pacing_refill;
+    boost::asio::steady_timer pacing_timer;
+
+    RequestData(std::shared_ptr<boost::asio::ip::tcp::socket> sock, size_t max_request_bytes,
+        std::shared_ptr<std::atomic<int>> slot);
+    ~RequestData();
+    void reset_response();
 };
 
 class HttpServer {
@@ -25,16 +78,85 @@ private:
     const Config& config_;
     boost::asio::io_context io_context_;
     boost::asio::ip::tcp::acceptor acceptor_;
+
+    // 分片模式：每个工作线程一个io_context和监听socket，连接的整个生命周期都在该线程上；
+    // io_context_只剩文件读取完成事件与挂起请求的唤醒和超时，由一个服务线程运行
+    struct Shard {
+        boost::asio::io_context io_context{ 1 };
+        boost::asio::ip::tcp::acceptor acceptor{ io_context };
+    };
+    std::vector<std::unique_ptr<Shard>> shards_;   // 在挂起请求与缓存之前声明：后析构，连接先于其io_context释放
+
     std::atomic<bool> running_{ false };
-    std::thread server_thread_;
+    std::vector<std::thread> server_threads_;
+    std::shared_ptr<std::atomic<int>> open_connections_ = std::make_shared<std::atomic<int>>(0);
+    std::unique_ptr<SegmentCache> segment_cache_;
+    std::unique_ptr<FileReader> file_reader_;   // 在segment_cache_之后声明：先析构，排空在途读取时缓存仍有效
+
+    // 等待播放列表更新、预加载part或按需切片生成的请求，按挂起顺序排列；
+    // 生成器写完文件后经notify_file_written唤醒对应的请求，定时器只处理挂起超时
+    std::mutex blocked_mutex_;
+    std::vector<std::shared_ptr<RequestData>> blocked_requests_;
+    boost::asio::steady_timer blocked_timer_;
+    bool blocked_timer_armed_ = false;
+    std::atomic<bool> playlist_pending_{ false };   // 播放列表仍在后台生成中
+    // 按需转码：切片请求到达时调用segment_hook_（安排生成），挂起的请求被唤醒时查询segment_state_hook_
+    std::function<SegmentAvailability(const std::string&)> segment_hook_;
+    std::function<SegmentAvailability(const std::string&)> segment_state_hook_;
 
-    void start_accept();
+    void open_listener(boost::asio::ip::tcp::acceptor& acceptor, bool reuse_port);
+    void start_accept(boost::asio::ip::tcp::acceptor& acceptor, boost::asio::io_context& io_context);
     void handle_request(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
+    void read_request(std::shared_ptr<RequestData> request_data);
+    void arm_deadline(std::shared_ptr<RequestData> request_data, std::chrono::steady_clock::duration timeout, bool writing);
+    void clear_deadline(RequestData& request_data);
+    void arm_write_deadline(std::shared_ptr<RequestData> request_data, uint64_t response_bytes);
+    void reject_connection(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
+    void update_buffer_accounting(RequestData& request_data);
     void process_request(std::shared_ptr<RequestData> request_data);
     void process_get_request(std::shared_ptr<RequestData> request_data);
+    void serve_from_disk(std::shared_ptr<RequestData> request_data);
+    void process_blocking_playlist(std::shared_ptr<RequestData> request_data);
+    void park_request(std::shared_ptr<RequestData> request_data);
+    // 挂起的按需切片是否仍在生成；生成失败时标记segment_failed并返回false
+    bool segment_pending(RequestData& request_data) const;
+    void send_segment_unavailable(std::shared_ptr<RequestData> request_data);
+    void arm_blocked_timer(std::chrono::steady_clock::time_point deadline);
+    // 超时的挂起请求按当前内容返回
+    void expire_blocked_requests();
+    // file_path写完后重新检查等待它的请求；主播放列表更新时检查所有低延迟HLS的请求
+    void wake_blocked_requests(const std::string& file_path);
+    // 重新检查matches选中的挂起请求，条件已满足的恢复处理，调用方不能持有blocked_mutex_
+    void recheck_blocked_requests(const std::function<bool(const RequestData&)>& matches, const LLPlaylistState& state);
+    bool still_blocked(RequestData& request_data, const LLPlaylistState& state) const;
+    void resume_blocked_requests(std::vector<std::shared_ptr<RequestData>> ready);
+    LLPlaylistState read_ll_playlist_state() const;
+    bool blocking_satisfied(const RequestData& request_data, const LLPlaylistState& state) const;
+    void send_cached(std::shared_ptr<RequestData> request_data);
+    void send_metrics(std::shared_ptr<RequestData> request_data);
+    void record_response(const RequestData& request_data);
+    bool prepare_response(std::shared_ptr<RequestData> request_data, uint64_t total_size);
+    std::string build_response_header(const RequestData& request_data, const std::string& status,
+        const std::string& content_type, uint64_t content_length, const std::string& extra_headers);
+    void send_parts(std::shared_ptr<RequestData> request_data);
+    void send_part_body(std::shared_ptr<RequestData> request_data);
     void send_file(std::shared_ptr<RequestData> request_data);
     void send_file_content(std::shared_ptr<RequestData> request_data, size_t bytes_sent);
-    void send_response(std::shared_ptr<boost::asio::ip::tcp::socket> socket, const std::string& response);
+    void send_cached_body(std::shared_ptr<RequestData> request_data, bool with_prefix);
+    void setup_pacing(RequestData& request_data);
+    size_t pacing_budget(RequestData& request_data, size_t wanted);
+    // 每轮发送的字节上限，HTTP_SEND_QUANTUM为0表示不分轮
+    size_t send_quantum() const;
+    void wait_for_pacing(std::shared_ptr<RequestData> request_data, std::function<void()> resume);
+    bool open_zero_copy(std::shared_ptr<RequestData> request_data);
+    void send_file_zero_copy(std::shared_ptr<RequestData> request_data);
+    void send_response(std::shared_ptr<RequestData> request_data, const std::string& status,
+        const std::string& extra_headers = "");
+    void finish_response(std::shared_ptr<RequestData> request_data);
+    std::string connection_header(const RequestData& request_data) const;
+    bool is_not_modified(const RequestData& request_data) const;
+    bool range_allowed(const RequestData& request_data) const;
+    std::string get_cache_control(const std::string& path) const;
     std::string get_content_type(const std::string& path);
 
 public:
@@ -44,6 +166,20 @@ public:
     void start();
     void stop();
     bool is_running() const { return running_; }
+    // 后台转码进行中时，主播放列表尚不存在的请求会挂起等待而不是返回404；
+    // 转码结束后以false调用，仍在等待的请求立即返回
+    void set_playlist_pending(bool pending);
+    // 按需转码模式下在start()之前设置：切片还没生成时request安排转码并返回Pending，请求挂起到文件出现；
+    // 挂起期间state返回Failed时立即回503并带Retry-After
+    void set_segment_hooks(std::function<SegmentAvailability(const std::string&)> request,
+        std::function<SegmentAvailability(const std::string&)> state) {
+        segment_hook_ = std::move(request);
+        segment_state_hook_ = std::move(state);
+    }
+    // 生成器、修复或按需转码写完（或替换）一个文件后调用，丢弃缓存中该路径的旧内容并唤醒等待它的请求；
+    // 低延迟HLS的主播放列表更新时唤醒所有阻塞刷新与预加载part请求。可在任意线程调用
+    void notify_file_written(const std::string& file_path);
+    SegmentCache::Stats cache_stats() const;
 };
 
 #endif // HTTP_SERVER_H
\ No newline at end of file
@@ -1,5 +1,5 @@
 #include "audio_capture.h"
-#include <iostream>
+#include "logger.h"
 #include <avrt.h>
 #include <algorithm>
 #pragma comment(lib,"avrt.lib")
@@ -44,7 +44,7 @@ bool AudioCapture::initialize(int sample_rate, int channels){
 
     HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     if (FAILED(hr)) {
-        std::cerr << "Failed to initialize COM library: " << std::hex << hr << std::endl;
+        LOG_ERROR("Failed to initialize COM library: " << std::hex << hr);
         return false;
     }
 
@@ -64,7 +64,7 @@ bool AudioCapture::reinitialize() {
      // 重新初始化 COM
     HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     if (FAILED(hr)) {
-        std::cerr << "Failed to reinitialize COM library: " << std::hex << hr << std::endl;
+        LOG_ERROR("Failed to reinitialize COM library: " << std::hex << hr);
         return false;
     }
 
@@ -85,14 +85,14 @@ bool AudioCapture::setupAudioClient() {
     HRESULT hr = audio_device_->Activate(__uuidof(IAudioClient), CLSCTX_ALL,
                                         nullptr, (void**)&audio_client_);
     if (FAILED(hr)) {
-        std::cerr<<"Failed to activate Audio Device: "<<std::hex<<hr<<std::endl;
+        LOG_ERROR("Failed to activate Audio Device: "<<std::hex<<hr);
         return false;
     }
 
     WAVEFORMATEX* mix_format = nullptr;
     hr=audio_client_->GetMixFormat(&mix_format);
     if(FAILED(hr)){
-        std::cerr<<"Failed to get mix format: "<<std::hex<<hr<<std::endl;
+        LOG_ERROR("Failed to get mix format: "<<std::hex<<hr);
         return false;
     }
 
@@ -104,7 +104,7 @@ bool AudioCapture::setupAudioClient() {
         10000000, 0, mix_format, nullptr);
 
     if (FAILED(hr)) {
-        std::cerr << "Failed to initialize audio client with mix format: 0x" << std::hex << hr << std::dec << std::endl;
+        LOG_ERROR("Failed to initialize audio client with mix format: 0x" << std::hex << hr << std::dec);
         CoTaskMemFree(mix_format);
         return false;
     }
@@ -112,7 +112,7 @@ bool AudioCapture::setupAudioClient() {
     hr = audio_client_->GetService(__uuidof(IAudioCaptureClient),
         (void**)&capture_client_);
     if (FAILED(hr)) {
-        std::cerr << "Failed to get capture client: 0x" << std::hex << hr << std::dec << std::endl;
+        LOG_ERROR("Failed to get capture client: 0x" << std::hex << hr << std::dec);
         CoTaskMemFree(mix_format);
         return false;
     }
@@ -130,9 +130,9 @@ bool AudioCapture::start() {
     if (capturing_) return true;
 
     if (!audio_client_) {
-        std::cerr << "Audio client is null, reinitializing..." << std::endl;
+        LOG_WARN("Audio client is null, reinitializing...");
         if (!setupAudioClient()) {
-            std::cerr << "Failed to reinitialize audio client" << std::endl;
+            LOG_ERROR("Failed to reinitialize audio client");
             return false;
         }
     }
@@ -173,7 +173,7 @@ void AudioCapture::captureThread() {
     
     UINT32 buffer_size = 0;
     audio_client_->GetBufferSize(&buffer_size);
-    std::cout << "Audio capture thread started, buffer size: " << buffer_size << std::endl;
+    LOG_INFO("Audio capture thread started, buffer size: " << buffer_size);
     
     int64_t cumulative_samples = 0;
 
@@ -181,7 +181,7 @@ void AudioCapture::captureThread() {
         UINT32 next_packet_size;
         HRESULT hr = capture_client_->GetNextPacketSize(&next_packet_size);
         if (FAILED(hr)){
-            std::cerr << "Failed to get next packet size: 0x" << std::hex << hr << std::dec << std::endl;
+            LOG_ERROR("Failed to get next packet size: 0x" << std::hex << hr << std::dec);
             break;
         }
         
@@ -198,7 +198,7 @@ void AudioCapture::captureThread() {
         hr = capture_client_->GetBuffer(&data, &num_frames, &flags,
                                        &device_position, &qpc_position);
         if (FAILED(hr)) {
-            std::cerr << "Failed to get buffer: 0x" << std::hex << hr << std::dec << std::endl;
+            LOG_ERROR("Failed to get buffer: 0x" << std::hex << hr << std::dec);
             break;
         }
         
@@ -231,12 +231,12 @@ void AudioCapture::captureThread() {
                         }else if(bits_per_sample_==32){
                             convert_pcm32_to_float(data,packet.data.data(),total_samples);
                         }else{
-                            std::cerr<<"Unsupported PCM format: "<<bits_per_sample_<<std::endl;
+                            LOG_ERROR("Unsupported PCM format: "<<bits_per_sample_);
                             std::fill(packet.data.begin(),packet.data.end(),0.0f);
                         }
                         break;
                     default:
-                        std::cerr<<"Unsupported audio format:"<<std::hex<<format_tag_<<std::endl;
+                        LOG_ERROR("Unsupported audio format:"<<std::hex<<format_tag_);
                         std::fill(packet.data.begin(),packet.data.end(),0.0f);
                         break;
                 }
@@ -244,7 +244,7 @@ void AudioCapture::captureThread() {
             
             // 调试信息（包括静音标志）
             if ((flags & AUDCLNT_BUFFERFLAGS_SILENT) != 0) {
-                std::cout << "Audio captured [SILENCE]: " << num_frames << " frames" << std::endl;
+                LOG_DEBUG("Audio captured [SILENCE]: " << num_frames << " frames");
             } 
             
             // 调用回调
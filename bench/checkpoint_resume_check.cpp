@@ -0,0 +1,234 @@
+// 检查点续转的端到端检查（直接复制模式）：转换到一半时stop()，再启动一个新的生成器从检查点续转，
+// 然后确认最终播放列表中的每个切片都以视频关键帧开始、续转处与前一切片首尾相接、总时长与输入一致。
+// 输入须为H.264（YUV420P）视频，才会走直接复制路径。
+#include "config.h"
+#include "hls_generator.h"
+#include "checkpoint_journal.h"
+#include "transcode_manifest.h"
+#include "logger.h"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace {
+    struct CheckOptions {
+        std::string input;
+        std::string dir = "hls_resume_check";
+        double stop_at = 0.5;      // 进度达到该比例时停止第一次转换
+        bool keep = false;
+    };
+
+    struct SegmentProbe {
+        bool opened = false;
+        bool starts_with_keyframe = false;
+        double first_video_time = 0;     // 秒
+    };
+
+    bool parse_args(int argc, char** argv, CheckOptions& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--dir") options.dir = value();
+            else if (arg == "--stop-at") options.stop_at = std::stod(value());
+            else if (arg == "--keep") options.keep = true;
+            else if (arg == "--help") return false;
+            else if (!arg.empty() && arg[0] != '-' && options.input.empty()) options.input = arg;
+            else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+        }
+        return !options.input.empty() && options.stop_at > 0 && options.stop_at < 1;
+    }
+
+    void print_usage() {
+        std::cout << "Usage: checkpoint_resume_check <h264 input> [--dir DIR] [--stop-at 0.5] [--keep]" << std::endl;
+    }
+
+    bool is_h264(const std::string& path) {
+        AVFormatContext* input = nullptr;
+        if (avformat_open_input(&input, path.c_str(), nullptr, nullptr) < 0) {
+            return false;
+        }
+        bool h264 = false;
+        if (avformat_find_stream_info(input, nullptr) >= 0) {
+            int video = av_find_best_stream(input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+            h264 = video >= 0 && input->streams[video]->codecpar->codec_id == AV_CODEC_ID_H264;
+        }
+        avformat_close_input(&input);
+        return h264;
+    }
+
+    SegmentProbe probe_segment(const std::string& path) {
+        SegmentProbe probe;
+        AVFormatContext* input = nullptr;
+        if (avformat_open_input(&input, path.c_str(), nullptr, nullptr) < 0) {
+            return probe;
+        }
+        probe.opened = avformat_find_stream_info(input, nullptr) >= 0;
+        int video = probe.opened ? av_find_best_stream(input, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) : -1;
+        AVPacket* pkt = av_packet_alloc();
+        while (video >= 0 && av_read_frame(input, pkt) >= 0) {
+            if (pkt->stream_index == video) {
+                probe.starts_with_keyframe = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+                int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+                probe.first_video_time = ts * av_q2d(input->streams[video]->time_base);
+                av_packet_unref(pkt);
+                break;
+            }
+            av_packet_unref(pkt);
+        }
+        av_packet_free(&pkt);
+        avformat_close_input(&input);
+        return probe;
+    }
+
+    // 按顺序读出播放列表中的切片文件名与时长
+    bool read_playlist(const std::string& path, std::vector<std::pair<std::string, double>>& segments,
+        bool& ended, bool& discontinuity) {
+        std::ifstream playlist(path);
+        if (!playlist.is_open()) {
+            return false;
+        }
+        std::string line;
+        double duration = 0;
+        while (std::getline(playlist, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.rfind("#EXTINF:", 0) == 0) duration = std::atof(line.c_str() + 8);
+            else if (line == "#EXT-X-ENDLIST") ended = true;
+            else if (line == "#EXT-X-DISCONTINUITY") discontinuity = true;
+            else if (!line.empty() && line[0] != '#') segments.emplace_back(line, duration);
+        }
+        return true;
+    }
+
+    double input_duration(const std::string& path) {
+        AVFormatContext* input = nullptr;
+        if (avformat_open_input(&input, path.c_str(), nullptr, nullptr) < 0) {
+            return 0;
+        }
+        avformat_find_stream_info(input, nullptr);
+        double duration = input->duration > 0 ? input->duration / static_cast<double>(AV_TIME_BASE) : 0;
+        avformat_close_input(&input);
+        return duration;
+    }
+}
+
+int main(int argc, char** argv) {
+    CheckOptions options;
+    try {
+        if (!parse_args(argc, argv, options)) {
+            print_usage();
+            return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Invalid arguments: " << e.what() << std::endl;
+        print_usage();
+        return 1;
+    }
+    if (!is_h264(options.input)) {
+        std::cerr << "Error: input must be an H.264 video so that the generator copies packets: " << options.input << std::endl;
+        return 1;
+    }
+
+    Logger::instance().set_level(LogLevel::Warn);
+    std::error_code ec;
+    std::filesystem::remove_all(options.dir, ec);
+    std::filesystem::create_directories(options.dir);
+    Config config(options.input, options.dir, 0, true);
+    const std::string playlist_path = config.HLS_DIR + "/" + config.M3U8_FILENAME;
+    int failures = 0;
+    auto fail = [&](const std::string& message) {
+        std::cout << "FAIL: " << message << std::endl;
+        failures++;
+    };
+
+    try {
+        // 第一次转换：进度过半时停止，停止时写尾部截断的切片不应记入日志
+        {
+            HLSGenerator generator(config);
+            generator.start_async();
+            while (!generator.is_finished() && generator.progress() < options.stop_at) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            generator.stop();
+            generator.wait();
+            if (generator.progress() >= 1) {
+                std::cerr << "Error: conversion finished before it could be stopped; use a longer input" << std::endl;
+                return 1;
+            }
+        }
+
+        CheckpointJournal journal(playlist_path + ".journal",
+            compute_transcode_identity(config, config.HLS_MANIFEST_FULL_HASH).to_string());
+        if (!journal.load() || journal.segments().empty() || journal.complete()) {
+            std::cerr << "Error: no usable checkpoint after stop; use a longer input or a later --stop-at" << std::endl;
+            return 1;
+        }
+        const size_t kept = journal.segments().size();
+        const SegmentCheckpoint last = journal.segments().back();
+        std::cout << "Stopped with " << kept << " journaled segments, resuming at " << last.start + last.duration << "s" << std::endl;
+
+        // 第二次转换：从检查点续转到结束
+        {
+            HLSGenerator generator(config);
+            generator.start();
+        }
+
+        std::vector<std::pair<std::string, double>> segments;
+        bool ended = false;
+        bool discontinuity = false;
+        if (!read_playlist(playlist_path, segments, ended, discontinuity)) {
+            fail("final playlist missing: " + playlist_path);
+        }
+        if (!ended) fail("final playlist has no EXT-X-ENDLIST");
+        if (!discontinuity) fail("resumed playlist has no EXT-X-DISCONTINUITY at the resume point");
+        if (segments.size() <= kept) fail("resume produced no new segments");
+
+        double total = 0;
+        double previous_end = -1;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            SegmentProbe probe = probe_segment(config.HLS_DIR + "/" + segments[i].first);
+            if (!probe.opened) {
+                fail("cannot open segment " + segments[i].first);
+                continue;
+            }
+            if (!probe.starts_with_keyframe) {
+                fail("segment " + segments[i].first + " does not start with a video keyframe");
+            }
+            // 续转处的切片应紧接前一个切片，既不重叠也不缺帧（允许一帧左右的误差）
+            if (i == kept && previous_end >= 0 && std::abs(probe.first_video_time - previous_end) > 0.1) {
+                fail("resumed segment starts at " + std::to_string(probe.first_video_time) + "s, expected "
+                    + std::to_string(previous_end) + "s");
+            }
+            previous_end = probe.first_video_time + segments[i].second;
+            total += segments[i].second;
+        }
+        double expected = input_duration(options.input);
+        if (expected > 0 && std::abs(total - expected) > config.HLS_SEGMENT_DURATION) {
+            fail("playlist duration " + std::to_string(total) + "s differs from input " + std::to_string(expected) + "s");
+        }
+    }
+    catch (const std::exception& e) {
+        fail(std::string("exception: ") + e.what());
+    }
+    Logger::instance().flush();
+
+    if (!options.keep) {
+        std::filesystem::remove_all(options.dir, ec);
+    }
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,841 @@
+// HLS服务器基准测试：在本机启动HttpServer并生成模拟直播目录，
+// 按播放器的刷新/拉取节奏模拟观众（viewers模式），或用固定连接数压测（rps模式：单一路径，或冷热混合的大量切片）。
+// 服务器的切片缓存、io_uring与sendfile可分别关闭，对比各条发送/读取路径。
+// 全部流量走127.0.0.1，结果可用于版本间的回归对比。
+#include "config.h"
+#include "HttpServer.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    struct BenchOptions {
+        std::string mode = "viewers";      // viewers | rps
+        int viewers = 100;
+        int connections = 64;              // rps模式的并发连接数
+        int duration = 30;                 // 测试时长（秒）
+        int segment_duration = 2;          // 模拟直播的切片时长（秒）
+        size_t segment_bytes = 1024 * 1024;
+        int window = 6;                    // 播放列表中的切片数
+        std::string path;                  // rps模式请求的路径，默认第一个切片
+        int segments = 1;                  // rps模式请求的切片数，大于1时按冷热混合随机请求（忽略path）
+        int hot_segments = 0;              // 热点切片数，默认切片数的1/10
+        double hot_ratio = 0.9;            // 请求热点切片的比例
+        bool drop_page_cache = false;      // 冷切片写完后及测试期间每秒从页缓存中清除
+        size_t cache_bytes = Config().SEGMENT_CACHE_BYTES;   // 服务器切片缓存预算，0表示禁用
+        bool io_uring = true;              // 关闭时缓存未命中走线程池阻塞读
+        bool zero_copy = true;             // 关闭时未缓存的文件走用户态缓冲区分块发送
+        uint64_t port = 18080;
+        std::string dir = "hls_bench_data";
+        int client_threads = 2;
+        bool server_log = false;           // 输出服务器逐请求的Debug日志
+        bool keep = false;                 // 结束后保留生成的目录
+    };
+
+    enum RequestKind { PLAYLIST = 0, SEGMENT = 1, COLD_SEGMENT = 2, KIND_COUNT = 3 };
+
+    // 每个观众/连接独占一份，回调在各自的strand上串行执行，无需加锁；结束后统一合并
+    struct RequestStats {
+        std::vector<double> latency_ms[KIND_COUNT];
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+        uint64_t bytes = 0;
+        uint64_t slow_segments = 0;        // 下载耗时超过切片时长的切片，播放器会因此卡顿
+        std::map<int, uint64_t> status_counts;
+
+        void merge(const RequestStats& other) {
+            for (int kind = 0; kind < KIND_COUNT; ++kind) {
+                latency_ms[kind].insert(latency_ms[kind].end(),
+                    other.latency_ms[kind].begin(), other.latency_ms[kind].end());
+            }
+            requests += other.requests;
+            errors += other.errors;
+            bytes += other.bytes;
+            slow_segments += other.slow_segments;
+            for (const auto& [status, count] : other.status_counts) {
+                status_counts[status] += count;
+            }
+        }
+    };
+
+    std::string segment_name(int64_t msn) {
+        return "seg" + std::to_string(msn) + ".ts";
+    }
+
+    // 模拟直播输出：按切片时长写入新切片并滚动播放列表，写临时文件后rename保证读者看到完整内容
+    class LiveStream {
+    public:
+        explicit LiveStream(const BenchOptions& options)
+            : options_(options)
+            , dir_(options.dir) {
+        }
+
+        ~LiveStream() {
+            stop();
+        }
+
+        // rps模式写出全部待请求的切片，播放列表仍只列出前window个
+        void prepare(int segments) {
+            for (int i = 0; i < std::max(options_.window, segments); ++i) {
+                write_segment(next_msn_++);
+            }
+            write_playlist();
+        }
+
+        void start() {
+            thread_ = std::thread([this]() { run(); });
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_all();
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+        }
+
+        int64_t segments_written() const {
+            return next_msn_;
+        }
+
+    private:
+        void run() {
+            auto next_tick = Clock::now() + std::chrono::seconds(options_.segment_duration);
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!cv_.wait_until(lock, next_tick, [this]() { return stopping_; })) {
+                lock.unlock();
+                write_segment(next_msn_++);
+                write_playlist();
+                // 保留两倍窗口的旧切片，落后的观众仍能取到
+                int64_t expired = next_msn_ - 2 * options_.window - 1;
+                if (expired >= 0) {
+                    std::error_code ignored;
+                    std::filesystem::remove(dir_ / segment_name(expired), ignored);
+                }
+                next_tick += std::chrono::seconds(options_.segment_duration);
+                lock.lock();
+            }
+        }
+
+        void write_segment(int64_t msn) {
+            std::vector<char> data(options_.segment_bytes);
+            for (size_t i = 0; i < data.size(); ++i) {
+                // 每188字节一个TS同步字节，其余按序号填充，内容随切片变化
+                data[i] = (i % 188 == 0) ? static_cast<char>(0x47) : static_cast<char>(msn + i);
+            }
+            write_atomically(dir_ / segment_name(msn), data.data(), data.size());
+        }
+
+        void write_playlist() {
+            // rps模式的切片不滚动，播放列表固定列出开头的window个
+            int64_t first = options_.mode == "rps" ? 0 : std::max<int64_t>(0, next_msn_ - options_.window);
+            std::ostringstream playlist;
+            playlist << "#EXTM3U\n"
+                << "#EXT-X-VERSION:3\n"
+                << "#EXT-X-TARGETDURATION:" << options_.segment_duration << "\n"
+                << "#EXT-X-MEDIA-SEQUENCE:" << first << "\n";
+            for (int64_t msn = first; msn < first + options_.window && msn < next_msn_; ++msn) {
+                playlist << "#EXTINF:" << options_.segment_duration << ".000,\n" << segment_name(msn) << "\n";
+            }
+            std::string text = playlist.str();
+            write_atomically(dir_ / "stream.m3u8", text.data(), text.size());
+        }
+
+    public:
+        // 把切片从页缓存中清除，之后的读取必须访问磁盘（先落盘，脏页无法清除）
+        static void drop_from_page_cache(const std::filesystem::path& path) {
+#if defined(__linux__)
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            ::fdatasync(fd);
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+#else
+            (void)path;
+#endif
+        }
+
+    private:
+        static void write_atomically(const std::filesystem::path& path, const char* data, size_t size) {
+            std::filesystem::path temp = path;
+            temp += ".tmp";
+            {
+                std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+                file.write(data, static_cast<std::streamsize>(size));
+            }
+            std::filesystem::rename(temp, path);
+        }
+
+        const BenchOptions& options_;
+        std::filesystem::path dir_;
+        std::atomic<int64_t> next_msn_{ 0 };
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool stopping_ = false;
+    };
+
+    // 最小的HTTP/1.1 keep-alive客户端：一次一个请求，出错或对端要求关闭时下次请求重新连接
+    class BenchConnection : public std::enable_shared_from_this<BenchConnection> {
+    public:
+        // status为0表示传输错误
+        using Handler = std::function<void(int status, size_t body_bytes, std::string body)>;
+
+        BenchConnection(boost::asio::any_io_executor executor, tcp::endpoint endpoint)
+            : socket_(executor)
+            , endpoint_(endpoint) {
+        }
+
+        void get(const std::string& path, bool keep_body, Handler handler) {
+            request_ = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+            keep_body_ = keep_body;
+            handler_ = std::move(handler);
+
+            if (connected_) {
+                send();
+                return;
+            }
+            auto self = shared_from_this();
+            socket_.async_connect(endpoint_, [self](const boost::system::error_code& error) {
+                if (error) {
+                    self->fail();
+                    return;
+                }
+                self->connected_ = true;
+                self->send();
+                });
+        }
+
+    private:
+        void send() {
+            auto self = shared_from_this();
+            boost::asio::async_write(socket_, boost::asio::buffer(request_),
+                [self](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
+                    if (error) {
+                        self->fail();
+                        return;
+                    }
+                    self->read_header();
+                });
+        }
+
+        void read_header() {
+            auto self = shared_from_this();
+            boost::asio::async_read_until(socket_, buffer_, "\r\n\r\n",
+                [self](const boost::system::error_code& error, std::size_t header_bytes) {
+                    if (error) {
+                        self->fail();
+                        return;
+                    }
+                    auto begin = boost::asio::buffers_begin(self->buffer_.data());
+                    std::string header(begin, begin + static_cast<std::ptrdiff_t>(header_bytes));
+                    self->buffer_.consume(header_bytes);
+
+                    std::transform(header.begin(), header.end(), header.begin(),
+                        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                    self->status_ = header.size() > 12 ? std::atoi(header.c_str() + 9) : 0;
+                    self->close_after_ = header.find("\r\nconnection: close") != std::string::npos;
+
+                    size_t content_length = 0;
+                    size_t pos = header.find("\r\ncontent-length:");
+                    if (pos != std::string::npos) {
+                        content_length = std::strtoull(header.c_str() + pos + 17, nullptr, 10);
+                    }
+                    self->read_body(content_length);
+                });
+        }
+
+        void read_body(size_t content_length) {
+            if (buffer_.size() >= content_length) {
+                complete(content_length);
+                return;
+            }
+            auto self = shared_from_this();
+            boost::asio::async_read(socket_, buffer_, boost::asio::transfer_exactly(content_length - buffer_.size()),
+                [self, content_length](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
+                    if (error) {
+                        self->fail();
+                        return;
+                    }
+                    self->complete(content_length);
+                });
+        }
+
+        void complete(size_t content_length) {
+            std::string body;
+            if (keep_body_) {
+                auto begin = boost::asio::buffers_begin(buffer_.data());
+                body.assign(begin, begin + static_cast<std::ptrdiff_t>(content_length));
+            }
+            buffer_.consume(content_length);
+            if (close_after_) {
+                close();
+            }
+            // 回调里可能立即发起下一个请求并替换handler_
+            Handler handler = std::move(handler_);
+            handler(status_, content_length, std::move(body));
+        }
+
+        void fail() {
+            close();
+            Handler handler = std::move(handler_);
+            handler(0, 0, std::string());
+        }
+
+        void close() {
+            boost::system::error_code ignored;
+            socket_.close(ignored);
+            connected_ = false;
+            buffer_.consume(buffer_.size());
+        }
+
+        tcp::socket socket_;
+        tcp::endpoint endpoint_;
+        boost::asio::streambuf buffer_;
+        std::string request_;
+        Handler handler_;
+        bool connected_ = false;
+        bool keep_body_ = false;
+        bool close_after_ = false;
+        int status_ = 0;
+    };
+
+    void record(RequestStats& stats, const std::atomic<bool>& stopping, RequestKind kind,
+        Clock::time_point started, int status, size_t bytes) {
+        if (stopping) {
+            return;
+        }
+        stats.requests++;
+        if (status == 0) {
+            stats.errors++;
+            return;
+        }
+        stats.status_counts[status]++;
+        stats.bytes += bytes;
+        stats.latency_ms[kind].push_back(
+            std::chrono::duration<double, std::milli>(Clock::now() - started).count());
+    }
+
+    // 模拟一个直播观众：刷新播放列表，从直播边缘开始按顺序下载新切片，
+    // 播放列表有更新时间隔一个目标时长再刷新，无更新时间隔一半
+    class Viewer : public std::enable_shared_from_this<Viewer> {
+    public:
+        Viewer(boost::asio::io_context& io_context, tcp::endpoint endpoint, const std::atomic<bool>& stopping)
+            : strand_(boost::asio::make_strand(io_context))
+            , connection_(std::make_shared<BenchConnection>(strand_, endpoint))
+            , timer_(strand_)
+            , stopping_(stopping) {
+        }
+
+        void start(Clock::duration delay) {
+            auto self = shared_from_this();
+            timer_.expires_after(delay);
+            timer_.async_wait([self](const boost::system::error_code& error) {
+                if (!error) {
+                    self->reload();
+                }
+                });
+        }
+
+        const RequestStats& stats() const {
+            return stats_;
+        }
+
+    private:
+        void reload() {
+            if (stopping_) {
+                return;
+            }
+            auto self = shared_from_this();
+            auto started = Clock::now();
+            last_reload_ = started;
+            connection_->get("/stream.m3u8", true,
+                [self, started](int status, size_t body_bytes, std::string body) {
+                    record(self->stats_, self->stopping_, PLAYLIST, started, status, body_bytes);
+                    self->playlist_changed_ = status == 200 && self->parse_playlist(body);
+                    self->fetch_next();
+                });
+        }
+
+        // 返回是否出现了新切片
+        bool parse_playlist(const std::string& body) {
+            std::istringstream lines(body);
+            std::string line;
+            int64_t msn = 0;
+            std::vector<std::string> uris;
+            while (std::getline(lines, line)) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (line.rfind("#EXT-X-MEDIA-SEQUENCE:", 0) == 0) {
+                    msn = std::strtoll(line.c_str() + 22, nullptr, 10);
+                }
+                else if (line.rfind("#EXT-X-TARGETDURATION:", 0) == 0) {
+                    target_duration_ = std::chrono::seconds(std::max(1, std::atoi(line.c_str() + 22)));
+                }
+                else if (!line.empty() && line[0] != '#') {
+                    uris.push_back(line);
+                }
+            }
+
+            int64_t count = static_cast<int64_t>(uris.size());
+            if (next_msn_ < 0) {
+                // 首次加载从倒数第三个切片开始，与常见播放器的起播位置一致
+                next_msn_ = std::max<int64_t>(msn, msn + count - 3);
+            }
+            bool changed = false;
+            for (int64_t i = 0; i < count; ++i) {
+                if (msn + i >= next_msn_) {
+                    pending_.push_back(uris[static_cast<size_t>(i)]);
+                    next_msn_ = msn + i + 1;
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        void fetch_next() {
+            if (stopping_) {
+                return;
+            }
+            if (pending_.empty()) {
+                schedule_reload();
+                return;
+            }
+            std::string uri = "/" + pending_.front();
+            pending_.pop_front();
+
+            auto self = shared_from_this();
+            auto started = Clock::now();
+            connection_->get(uri, false,
+                [self, started](int status, size_t body_bytes, std::string /*body*/) {
+                    record(self->stats_, self->stopping_, SEGMENT, started, status, body_bytes);
+                    if (!self->stopping_ && Clock::now() - started > self->target_duration_) {
+                        self->stats_.slow_segments++;
+                    }
+                    self->fetch_next();
+                });
+        }
+
+        void schedule_reload() {
+            auto interval = playlist_changed_ ? target_duration_ : target_duration_ / 2;
+            auto self = shared_from_this();
+            timer_.expires_at(last_reload_ + interval);
+            timer_.async_wait([self](const boost::system::error_code& error) {
+                if (!error) {
+                    self->reload();
+                }
+                });
+        }
+
+        boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+        std::shared_ptr<BenchConnection> connection_;
+        boost::asio::steady_timer timer_;
+        const std::atomic<bool>& stopping_;
+        RequestStats stats_;
+        std::deque<std::string> pending_;
+        int64_t next_msn_ = -1;
+        bool playlist_changed_ = false;
+        Clock::time_point last_reload_;
+        Clock::duration target_duration_ = std::chrono::seconds(1);
+    };
+
+    // rps模式：单连接上背靠背地请求。切片数为1时总是请求同一路径；
+    // 否则按hot_ratio从热点切片中选取，其余均匀地从冷切片中选取
+    class RpsWorker : public std::enable_shared_from_this<RpsWorker> {
+    public:
+        RpsWorker(boost::asio::io_context& io_context, tcp::endpoint endpoint, const BenchOptions& options,
+            uint32_t seed, const std::atomic<bool>& stopping)
+            : connection_(std::make_shared<BenchConnection>(boost::asio::make_strand(io_context), endpoint))
+            , options_(options)
+            , random_(seed)
+            , stopping_(stopping) {
+        }
+
+        void start() {
+            if (stopping_) {
+                return;
+            }
+            RequestKind kind = SEGMENT;
+            std::string path = next_path(kind);
+            auto self = shared_from_this();
+            auto started = Clock::now();
+            connection_->get(path, false,
+                [self, started, kind](int status, size_t body_bytes, std::string /*body*/) {
+                    record(self->stats_, self->stopping_, kind, started, status, body_bytes);
+                    self->start();
+                });
+        }
+
+        const RequestStats& stats() const {
+            return stats_;
+        }
+
+    private:
+        std::string next_path(RequestKind& kind) {
+            if (options_.segments <= 1) {
+                const std::string& path = options_.path;
+                kind = path.size() >= 5 && path.compare(path.size() - 5, 5, ".m3u8") == 0 ? PLAYLIST : SEGMENT;
+                return path;
+            }
+            int hot = options_.hot_segments;
+            if (std::uniform_real_distribution<double>(0, 1)(random_) < options_.hot_ratio || hot >= options_.segments) {
+                kind = SEGMENT;
+                return "/" + segment_name(std::uniform_int_distribution<int>(0, hot - 1)(random_));
+            }
+            kind = COLD_SEGMENT;
+            return "/" + segment_name(std::uniform_int_distribution<int>(hot, options_.segments - 1)(random_));
+        }
+
+        std::shared_ptr<BenchConnection> connection_;
+        const BenchOptions& options_;
+        std::mt19937 random_;
+        const std::atomic<bool>& stopping_;
+        RequestStats stats_;
+    };
+
+    // 测试期间每秒把冷切片从页缓存中清除，使冷读取始终访问磁盘
+    class PageCacheDropper {
+    public:
+        PageCacheDropper(const BenchOptions& options)
+            : options_(options) {
+        }
+
+        ~PageCacheDropper() {
+            stop();
+        }
+
+        void drop_cold() {
+            for (int i = options_.hot_segments; i < options_.segments; ++i) {
+                LiveStream::drop_from_page_cache(std::filesystem::path(options_.dir) / segment_name(i));
+            }
+        }
+
+        void start() {
+            thread_ = std::thread([this]() {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while (!cv_.wait_for(lock, std::chrono::seconds(1), [this]() { return stopping_; })) {
+                    lock.unlock();
+                    drop_cold();
+                    lock.lock();
+                }
+                });
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_all();
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+        }
+
+    private:
+        const BenchOptions& options_;
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool stopping_ = false;
+    };
+
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t index = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return sorted[std::min(sorted.size() - 1, index == 0 ? 0 : index - 1)];
+    }
+
+    void print_latency(const char* label, std::vector<double> values) {
+        if (values.empty()) {
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        std::cout << "  " << std::left << std::setw(9) << label << std::right
+            << " n=" << values.size()
+            << "  p50=" << percentile(values, 0.50)
+            << "  p99=" << percentile(values, 0.99)
+            << "  p999=" << percentile(values, 0.999)
+            << "  max=" << values.back() << " ms" << std::endl;
+    }
+
+    void print_usage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+            << "  --mode viewers|rps       simulate live viewers (default) or saturate one path\n"
+            << "  --viewers N              viewers in viewers mode (default 100)\n"
+            << "  --connections N          concurrent connections in rps mode (default 64)\n"
+            << "  --duration S             measurement time in seconds (default 30)\n"
+            << "  --segment-duration S     simulated segment duration in seconds (default 2)\n"
+            << "  --segment-bytes N        simulated segment size, K/M suffixes allowed; presets 1M, 4M, 10M (default 1M)\n"
+            << "  --window N               segments listed in the playlist (default 6)\n"
+            << "  --path P                 request path in rps mode (default /seg0.ts)\n"
+            << "  --segments N             rps mode: request N distinct segments with a hot/cold mix instead of one path\n"
+            << "  --hot-segments N         segments in the hot set (default segments/10)\n"
+            << "  --hot-ratio R            share of requests that go to the hot set (default 0.9)\n"
+            << "  --drop-page-cache        evict cold segments from the page cache before and every second during the run\n"
+            << "  --cache-mb N             server segment cache budget in MB, 0 disables it (default 256)\n"
+            << "  --no-cache               same as --cache-mb 0: every request is served from disk\n"
+            << "  --no-io-uring            read cache misses on the thread pool instead of io_uring\n"
+            << "  --no-sendfile            send uncached files through a user-space buffer instead of sendfile\n"
+            << "  --port N                 server port (default 18080)\n"
+            << "  --dir D                  generated HLS directory, must be empty (default hls_bench_data)\n"
+            << "  --client-threads N       load generator threads (default 2)\n"
+            << "  --server-log             enable the server's per-request debug logging\n"
+            << "  --keep                   keep the generated directory afterwards" << std::endl;
+    }
+
+    // "4M"、"512K"或字节数
+    size_t parse_size(const std::string& text) {
+        size_t end = 0;
+        size_t value = std::stoull(text, &end);
+        std::string suffix = text.substr(end);
+        if (suffix == "K" || suffix == "k") return value * 1024;
+        if (suffix == "M" || suffix == "m") return value * 1024 * 1024;
+        if (!suffix.empty()) throw std::invalid_argument("bad size: " + text);
+        return value;
+    }
+
+    bool parse_options(int argc, char** argv, BenchOptions& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--mode") options.mode = value();
+            else if (arg == "--viewers") options.viewers = std::stoi(value());
+            else if (arg == "--connections") options.connections = std::stoi(value());
+            else if (arg == "--duration") options.duration = std::stoi(value());
+            else if (arg == "--segment-duration") options.segment_duration = std::stoi(value());
+            else if (arg == "--segment-bytes") options.segment_bytes = parse_size(value());
+            else if (arg == "--window") options.window = std::stoi(value());
+            else if (arg == "--path") options.path = value();
+            else if (arg == "--segments") options.segments = std::stoi(value());
+            else if (arg == "--hot-segments") options.hot_segments = std::stoi(value());
+            else if (arg == "--hot-ratio") options.hot_ratio = std::stod(value());
+            else if (arg == "--drop-page-cache") options.drop_page_cache = true;
+            else if (arg == "--cache-mb") options.cache_bytes = std::stoull(value()) * 1024 * 1024;
+            else if (arg == "--no-cache") options.cache_bytes = 0;
+            else if (arg == "--no-io-uring") options.io_uring = false;
+            else if (arg == "--no-sendfile") options.zero_copy = false;
+            else if (arg == "--port") options.port = std::stoull(value());
+            else if (arg == "--dir") options.dir = value();
+            else if (arg == "--client-threads") options.client_threads = std::stoi(value());
+            else if (arg == "--server-log") options.server_log = true;
+            else if (arg == "--keep") options.keep = true;
+            else if (arg == "--help") return false;
+            else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+        }
+
+        if (options.mode != "viewers" && options.mode != "rps") {
+            std::cerr << "Unknown mode: " << options.mode << std::endl;
+            return false;
+        }
+        if (options.viewers < 1 || options.connections < 1 || options.duration < 1 ||
+            options.segment_duration < 1 || options.window < 1 || options.client_threads < 1 ||
+            options.segments < 1 || options.segment_bytes < 1) {
+            std::cerr << "Counts and durations must be positive" << std::endl;
+            return false;
+        }
+        if (options.path.empty()) {
+            options.path = "/" + segment_name(0);
+        }
+        if (options.hot_segments <= 0) {
+            options.hot_segments = std::max(1, options.segments / 10);
+        }
+        options.hot_segments = std::min(options.hot_segments, options.segments);
+        if (options.hot_ratio < 0 || options.hot_ratio > 1) {
+            std::cerr << "--hot-ratio must be between 0 and 1" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    try {
+        if (!parse_options(argc, argv, options)) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Invalid arguments: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        if (std::filesystem::exists(options.dir) && !std::filesystem::is_empty(options.dir)) {
+            std::cerr << "Error: benchmark directory is not empty: " << options.dir << std::endl;
+            return 1;
+        }
+        std::filesystem::create_directories(options.dir);
+
+        bool viewers_mode = options.mode == "viewers";
+        bool mixed = !viewers_mode && options.segments > 1;
+        LiveStream stream(options);
+        stream.prepare(viewers_mode ? 0 : options.segments);
+        PageCacheDropper dropper(options);
+        if (options.drop_page_cache) {
+            dropper.drop_cold();
+        }
+
+        std::cout << "=== HLS Benchmark (" << options.mode << ") ===" << std::endl;
+        if (viewers_mode) {
+            std::cout << "Viewers: " << options.viewers;
+        }
+        else if (mixed) {
+            std::cout << "Connections: " << options.connections << ", segments: " << options.segments
+                << " (" << options.hot_segments << " hot, " << options.hot_ratio * 100 << "% of requests)";
+        }
+        else {
+            std::cout << "Connections: " << options.connections << ", path: " << options.path;
+        }
+        std::cout << ", duration: " << options.duration << "s, segment: "
+            << options.segment_bytes / 1024 << " KB / " << options.segment_duration << "s" << std::endl;
+        std::cout << "Server paths: cache=" << options.cache_bytes / (1024 * 1024) << " MB, io_uring="
+            << (options.io_uring ? "on" : "off") << ", sendfile=" << (options.zero_copy ? "on" : "off")
+            << ", page cache drop=" << (options.drop_page_cache ? "on" : "off") << std::endl;
+
+        Config config(options.dir, options.port, options.cache_bytes, options.io_uring, options.zero_copy);
+        // 默认只保留服务器的警告和错误；--server-log打开逐请求的Debug日志
+        Logger::instance().set_level(options.server_log ? LogLevel::Debug : LogLevel::Warn);
+        HttpServer server(config);
+        server.start();
+        if (viewers_mode) {
+            stream.start();
+        }
+        if (options.drop_page_cache && mixed) {
+            dropper.start();
+        }
+
+        std::atomic<bool> stopping{ false };
+        boost::asio::io_context client_context;
+        auto work = boost::asio::make_work_guard(client_context);
+        tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(options.port));
+
+        std::vector<std::shared_ptr<Viewer>> viewers;
+        std::vector<std::shared_ptr<RpsWorker>> workers;
+        if (viewers_mode) {
+            // 起播时间在一个切片时长内随机分散，避免所有观众同步刷新
+            std::mt19937 random(12345);
+            std::uniform_int_distribution<int> delay_ms(0, options.segment_duration * 1000);
+            for (int i = 0; i < options.viewers; ++i) {
+                viewers.push_back(std::make_shared<Viewer>(client_context, endpoint, stopping));
+                viewers.back()->start(std::chrono::milliseconds(delay_ms(random)));
+            }
+        }
+        else {
+            for (int i = 0; i < options.connections; ++i) {
+                workers.push_back(std::make_shared<RpsWorker>(client_context, endpoint, options,
+                    static_cast<uint32_t>(12345 + i), stopping));
+                workers.back()->start();
+            }
+        }
+
+        auto started = Clock::now();
+        std::vector<std::thread> client_threads;
+        for (int i = 0; i < options.client_threads; ++i) {
+            client_threads.emplace_back([&client_context]() { client_context.run(); });
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(options.duration));
+        stopping = true;
+        double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+
+        client_context.stop();
+        for (auto& thread : client_threads) {
+            thread.join();
+        }
+        stream.stop();
+        dropper.stop();
+        SegmentCache::Stats cache = server.cache_stats();
+        server.stop();
+        Logger::instance().flush();
+
+        RequestStats total;
+        for (const auto& viewer : viewers) {
+            total.merge(viewer->stats());
+        }
+        for (const auto& worker : workers) {
+            total.merge(worker->stats());
+        }
+        std::vector<double> all;
+        for (int kind = 0; kind < KIND_COUNT; ++kind) {
+            all.insert(all.end(), total.latency_ms[kind].begin(), total.latency_ms[kind].end());
+        }
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Requests: " << total.requests << " (" << total.requests / elapsed << " req/s), errors: "
+            << total.errors << std::endl;
+        std::cout << "Throughput: " << static_cast<double>(total.bytes) / elapsed / (1024 * 1024) << " MB/s" << std::endl;
+        std::cout << "Latency:" << std::endl;
+        print_latency("all", all);
+        print_latency("playlist", total.latency_ms[PLAYLIST]);
+        print_latency(mixed ? "hot seg" : "segment", total.latency_ms[SEGMENT]);
+        print_latency("cold seg", total.latency_ms[COLD_SEGMENT]);
+        if (viewers_mode) {
+            std::cout << "Segments published: " << stream.segments_written()
+                << ", slow segment downloads (> segment duration): " << total.slow_segments << std::endl;
+        }
+        std::cout << "Status:";
+        for (const auto& [status, count] : total.status_counts) {
+            std::cout << " " << status << "=" << count;
+        }
+        std::cout << std::endl;
+        std::cout << "Server cache: hits=" << cache.hits << " misses=" << cache.misses
+            << " collapsed=" << cache.collapsed << " bypassed=" << cache.bypassed
+            << " evictions=" << cache.evictions << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Benchmark error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!options.keep) {
+        std::error_code ignored;
+        std::filesystem::remove_all(options.dir, ignored);
+    }
+    return 0;
+}
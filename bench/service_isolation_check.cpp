@@ -0,0 +1,184 @@
+// 监视目录服务的故障隔离检查：向运行中的TranscodeService提交无法解码的输入（随机字节、截断的视频），
+// 确认任务以Failed结束、失败计数增加，进程与服务继续运行；给出正常输入时再确认之后的任务仍能完成。
+#include "config.h"
+#include "transcode_service.h"
+#include "metrics.h"
+#include "logger.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct CheckOptions {
+        std::string input;      // 可选，能正常转码的视频
+        std::string dir = "service_isolation_check";
+        int timeout = 120;      // 每个任务的等待时限（秒）
+        bool keep = false;
+    };
+
+    bool parse_args(int argc, char** argv, CheckOptions& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--dir") options.dir = value();
+            else if (arg == "--timeout") options.timeout = std::stoi(value());
+            else if (arg == "--keep") options.keep = true;
+            else if (arg == "--help") return false;
+            else if (!arg.empty() && arg[0] != '-' && options.input.empty()) options.input = arg;
+            else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+        }
+        return options.timeout > 0;
+    }
+
+    void print_usage() {
+        std::cout << "Usage: service_isolation_check [valid input] [--dir DIR] [--timeout 120] [--keep]" << std::endl;
+    }
+
+    void write_random_file(const std::string& path, size_t size) {
+        std::mt19937 rng(12345);
+        std::vector<char> data(size);
+        for (char& c : data) c = static_cast<char>(rng());
+        std::ofstream file(path, std::ios::binary);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    // 只保留前一半字节，mp4的moov通常在末尾，打开时即失败；其他容器在解码中途失败
+    void write_truncated_copy(const std::string& source, const std::string& path) {
+        std::ifstream in(source, std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream file(path, std::ios::binary);
+        file.write(data.data(), static_cast<std::streamsize>(data.size() / 2));
+    }
+
+    // 等待任务离开排队与转码状态，超时返回false
+    bool wait_job(TranscodeService& service, uint64_t id, int timeout, TranscodeService::JobStatus& status) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+        while (std::chrono::steady_clock::now() < deadline) {
+            for (const auto& job : service.jobs()) {
+                if (job.id == id && job.state != TranscodeService::JobState::Queued &&
+                    job.state != TranscodeService::JobState::Running) {
+                    status = job;
+                    return true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return false;
+    }
+}
+
+int main(int argc, char** argv) {
+    CheckOptions options;
+    try {
+        if (!parse_args(argc, argv, options)) {
+            print_usage();
+            return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Invalid arguments: " << e.what() << std::endl;
+        print_usage();
+        return 1;
+    }
+    if (!options.input.empty()) {
+        options.input = std::filesystem::absolute(options.input).string();
+        if (!std::filesystem::exists(options.input)) {
+            std::cerr << "Error: input not found: " << options.input << std::endl;
+            return 1;
+        }
+    }
+
+    Logger::instance().set_level(LogLevel::Warn);
+    std::error_code ec;
+    std::filesystem::remove_all(options.dir, ec);
+    std::filesystem::create_directories(options.dir + "/inputs");
+    // WATCH_DIR与HLS_DIR是相对路径，切到检查目录中运行
+    std::filesystem::path previous = std::filesystem::current_path();
+    std::filesystem::current_path(options.dir);
+
+    int failures = 0;
+    auto fail = [&](const std::string& message) {
+        std::cout << "FAIL: " << message << std::endl;
+        failures++;
+    };
+
+    try {
+        std::vector<std::string> broken = { "inputs/random.mp4" };
+        write_random_file(broken[0], 256 * 1024);
+        if (!options.input.empty()) {
+            broken.push_back("inputs/truncated" + std::filesystem::path(options.input).extension().string());
+            write_truncated_copy(options.input, broken.back());
+        }
+
+        Config config("hls", 0);
+        Metrics::Counter& failed = Metrics::instance().counter("hls_service_jobs_finished_total",
+            "Watch-folder transcode jobs that finished", "result=\"failed\"");
+        TranscodeService service(config);
+        service.start();
+
+        for (const auto& path : broken) {
+            uint64_t failed_before = failed.value();
+            uint64_t id = service.submit(path);
+            TranscodeService::JobStatus status;
+            if (id == 0) {
+                fail("service refused " + path);
+            }
+            else if (!wait_job(service, id, options.timeout, status)) {
+                fail("job for " + path + " did not finish");
+            }
+            else if (status.state != TranscodeService::JobState::Failed) {
+                fail("job for " + path + " ended as " + TranscodeService::state_name(status.state) + ", expected failed");
+            }
+            else {
+                if (status.error.empty()) fail("failed job for " + path + " has no error message");
+                if (failed.value() != failed_before + 1) fail("failed job counter did not increase for " + path);
+                std::cout << path << ": failed as expected (" << status.error << ")" << std::endl;
+            }
+        }
+
+        // 失败的任务之后服务仍然接受并完成新的任务
+        if (!options.input.empty()) {
+            uint64_t id = service.submit(options.input);
+            TranscodeService::JobStatus status;
+            if (id == 0) {
+                fail("service refused " + options.input);
+            }
+            else if (!wait_job(service, id, options.timeout, status)) {
+                fail("job for " + options.input + " did not finish");
+            }
+            else if (status.state != TranscodeService::JobState::Done) {
+                fail("job for " + options.input + " ended as " + TranscodeService::state_name(status.state)
+                    + (status.error.empty() ? "" : ": " + status.error));
+            }
+            else if (!std::filesystem::exists(status.output_dir + "/" + config.M3U8_FILENAME)) {
+                fail("no playlist in " + status.output_dir);
+            }
+            else {
+                std::cout << options.input << ": converted after the failures" << std::endl;
+            }
+        }
+        service.stop();
+    }
+    catch (const std::exception& e) {
+        fail(std::string("exception: ") + e.what());
+    }
+    Logger::instance().flush();
+
+    std::filesystem::current_path(previous);
+    if (!options.keep) {
+        std::filesystem::remove_all(options.dir, ec);
+    }
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// 有界无锁队列（Vyukov MPMC），入队出队只有CAS与原子序号；
+// 满或空时阻塞在std::atomic::wait上而不是自旋，对端每次操作后notify（没有等待者时不进内核）
+// 所有生产者close()后，pop取空即返回false；cancel()让阻塞中和之后的push/pop立即返回false
+template <typename T>
+class BoundedQueue {
+public:
+    // capacity向上取整到2的幂
+    explicit BoundedQueue(size_t capacity, int producers = 1)
+        : capacity_(round_up(capacity))
+        , slots_(new Slot[capacity_])
+        , producers_(producers) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool try_push(T& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & (capacity_ - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        pushed_.fetch_add(1, std::memory_order_release);
+        pushed_.notify_all();
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & (capacity_ - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(slot.value);
+                    slot.sequence.store(pos + capacity_, std::memory_order_release);
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        popped_.fetch_add(1, std::memory_order_release);
+        popped_.notify_all();
+        return true;
+    }
+
+    // 队列满时阻塞；被cancel时返回false，value仍归调用方所有
+    bool push(T value) {
+        while (true) {
+            // 先取序号再尝试：两者之间发生的出队会改变序号，wait立即返回，不会漏掉唤醒
+            uint32_t seen = popped_.load(std::memory_order_acquire);
+            if (cancelled_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (try_push(value)) {
+                return true;
+            }
+            popped_.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    // 队列空时阻塞；生产者全部结束且已取空，或被cancel时返回false
+    bool pop(T& value) {
+        while (true) {
+            uint32_t seen = pushed_.load(std::memory_order_acquire);
+            if (cancelled_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            if (try_pop(value)) {
+                return true;
+            }
+            if (producers_.load(std::memory_order_acquire) <= 0) {
+                // close之前入队的数据此时都已可见，再取一次
+                return try_pop(value);
+            }
+            pushed_.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    // 一个生产者不再入队
+    void close() {
+        producers_.fetch_sub(1, std::memory_order_acq_rel);
+        pushed_.fetch_add(1, std::memory_order_release);
+        pushed_.notify_all();
+    }
+
+    void cancel() {
+        cancelled_.store(true, std::memory_order_release);
+        pushed_.fetch_add(1, std::memory_order_release);
+        pushed_.notify_all();
+        popped_.fetch_add(1, std::memory_order_release);
+        popped_.notify_all();
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{ 0 };
+        T value{};
+    };
+
+    static size_t round_up(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> enqueue_pos_{ 0 };
+    alignas(64) std::atomic<size_t> dequeue_pos_{ 0 };
+    alignas(64) std::atomic<uint32_t> pushed_{ 0 };   // 入队次数，供等待数据的消费者阻塞
+    alignas(64) std::atomic<uint32_t> popped_{ 0 };   // 出队次数，供等待空位的生产者阻塞
+    std::atomic<int> producers_;
+    std::atomic<bool> cancelled_{ false };
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,244 @@
+#include "checkpoint_journal.h"
+#include "logger.h"
+#include<algorithm>
+#include<array>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<filesystem>
+#include<fstream>
+#include<sstream>
+
+namespace {
+    // CRC-32（多项式0xEDB88320，与zlib相同）
+    constexpr std::array<uint32_t, 256> make_crc_table() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }
+    constexpr std::array<uint32_t, 256> CRC_TABLE = make_crc_table();
+
+    std::string format_segment(const SegmentCheckpoint& segment) {
+        char line[512];
+        std::snprintf(line, sizeof(line), "segment %s %.6f %.6f %llu %08x", segment.filename.c_str(),
+            segment.start, segment.duration, static_cast<unsigned long long>(segment.bytes), segment.crc);
+        return line;
+    }
+}
+
+CheckpointJournal::CheckpointJournal(std::string journal_path, std::string identity)
+    : journal_path_(std::move(journal_path))
+    , identity_("input " + std::move(identity)) {
+}
+
+bool CheckpointJournal::load() {
+    segments_.clear();
+    pending_.clear();
+    complete_ = false;
+    std::ifstream journal(journal_path_);
+    if (!journal.is_open()) {
+        return false;
+    }
+    std::string line;
+    if (!std::getline(journal, line) || line != identity_) {
+        LOG_INFO("检查点日志与当前输入或转码参数不符，忽略：" << journal_path_);
+        return false;
+    }
+    while (std::getline(journal, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "end") {
+            complete_ = true;
+            continue;
+        }
+        SegmentCheckpoint segment;
+        std::string crc;
+        if (kind != "segment" || !(fields >> segment.filename >> segment.start >> segment.duration >> segment.bytes >> crc)) {
+            // 崩溃时最后一行可能只写了一半，之后的内容都不可信
+            LOG_WARN("检查点日志第" << (segments_.size() + 2) << "行不完整，只使用之前的记录");
+            break;
+        }
+        segment.crc = static_cast<uint32_t>(std::strtoul(crc.c_str(), nullptr, 16));
+        segments_.push_back(std::move(segment));
+    }
+    return true;
+}
+
+void CheckpointJournal::reset() {
+    segments_.clear();
+    pending_.clear();
+    complete_ = false;
+    save();
+}
+
+void CheckpointJournal::truncate(size_t count) {
+    if (count < segments_.size()) {
+        segments_.resize(count);
+    }
+    complete_ = false;
+    save();
+}
+
+void CheckpointJournal::refresh(size_t index, const std::string& dir) {
+    SegmentCheckpoint& segment = segments_.at(index);
+    file_crc32(dir + "/" + segment.filename, segment.bytes, segment.crc);
+    save();
+}
+
+void CheckpointJournal::mark_complete() {
+    complete_ = true;
+    append("end");
+}
+
+void CheckpointJournal::on_segment_closed(const std::string& path) {
+    Checksum checksum;
+    if (file_crc32(path, checksum.bytes, checksum.crc)) {
+        pending_[std::filesystem::path(path).filename().string()] = checksum;
+    }
+}
+
+void CheckpointJournal::on_playlist_closed(const std::string& path) {
+    std::ifstream playlist(path);
+    if (!playlist.is_open()) {
+        return;
+    }
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    std::string line;
+    double duration = 0;
+    double start = 0;
+    size_t index = 0;
+    while (std::getline(playlist, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.rfind("#EXTINF:", 0) == 0) {
+            duration = std::atof(line.c_str() + 8);
+            continue;
+        }
+        if (line.empty() || line[0] == '#') continue;
+        if (index >= segments_.size()) {
+            SegmentCheckpoint segment;
+            segment.filename = line;
+            segment.start = start;
+            segment.duration = duration;
+            auto it = pending_.find(line);
+            if (it != pending_.end()) {
+                segment.bytes = it->second.bytes;
+                segment.crc = it->second.crc;
+                pending_.erase(it);
+            }
+            else if (!file_crc32(dir + "/" + line, segment.bytes, segment.crc)) {
+                break;
+            }
+            append(format_segment(segment));
+            segments_.push_back(std::move(segment));
+        }
+        start += duration;
+        duration = 0;
+        index++;
+    }
+}
+
+bool CheckpointJournal::verify(const std::string& dir, const SegmentCheckpoint& segment) const {
+    std::string path = dir + "/" + segment.filename;
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) != segment.bytes || ec) {
+        LOG_WARN("切片缺失或大小不符：" << path);
+        return false;
+    }
+    uint64_t bytes = 0;
+    uint32_t crc = 0;
+    if (!file_crc32(path, bytes, crc) || crc != segment.crc) {
+        LOG_WARN("切片校验和不符：" << path);
+        return false;
+    }
+    return true;
+}
+
+void CheckpointJournal::write_playlist(const std::string& path, size_t count, bool ended, bool event) const {
+    count = std::min(count, segments_.size());
+    double target = 1;
+    for (size_t i = 0; i < count; ++i) {
+        target = std::max(target, std::ceil(segments_[i].duration));
+    }
+    std::ostringstream playlist;
+    playlist << "#EXTM3U\n";
+    playlist << "#EXT-X-VERSION:3\n";
+    playlist << "#EXT-X-TARGETDURATION:" << static_cast<int>(target) << "\n";
+    playlist << "#EXT-X-MEDIA-SEQUENCE:0\n";
+    if (event) {
+        playlist << "#EXT-X-PLAYLIST-TYPE:EVENT\n";
+    }
+    char extinf[64];
+    for (size_t i = 0; i < count; ++i) {
+        std::snprintf(extinf, sizeof(extinf), "#EXTINF:%.6f,\n", segments_[i].duration);
+        playlist << extinf << segments_[i].filename << "\n";
+    }
+    if (ended) {
+        playlist << "#EXT-X-ENDLIST\n";
+    }
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << playlist.str();
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        LOG_ERROR("按检查点重写播放列表失败: " << ec.message());
+    }
+}
+
+bool CheckpointJournal::file_crc32(const std::string& path, uint64_t& bytes, uint32_t& crc) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    uint32_t c = 0xFFFFFFFFu;
+    bytes = 0;
+    char buffer[64 * 1024];
+    while (file) {
+        file.read(buffer, sizeof(buffer));
+        std::streamsize n = file.gcount();
+        for (std::streamsize i = 0; i < n; ++i) {
+            c = CRC_TABLE[(c ^ static_cast<uint8_t>(buffer[i])) & 0xFF] ^ (c >> 8);
+        }
+        bytes += static_cast<uint64_t>(n);
+    }
+    crc = c ^ 0xFFFFFFFFu;
+    return true;
+}
+
+void CheckpointJournal::append(const std::string& line) {
+    // 每行单独打开、写入并关闭，进程随时被杀也最多丢掉最后半行
+    std::ofstream journal(journal_path_, std::ios::app);
+    journal << line << "\n";
+    journal.flush();
+}
+
+void CheckpointJournal::save() const {
+    std::ostringstream journal;
+    journal << identity_ << "\n";
+    for (const auto& segment : segments_) {
+        journal << format_segment(segment) << "\n";
+    }
+    if (complete_) {
+        journal << "end\n";
+    }
+    std::string temp_path = journal_path_ + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << journal.str();
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, journal_path_, ec);
+    if (ec) {
+        LOG_ERROR("写入检查点日志失败: " << ec.message());
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef CHECKPOINT_JOURNAL_H
+#define CHECKPOINT_JOURNAL_H
+#include<cstdint>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+// 一个已写完的切片：文件名（相对于播放列表目录）、对应的输入时间范围和校验信息
+struct SegmentCheckpoint {
+	std::string filename;
+	double start = 0;		// 相对输入视频第一帧的秒数
+	double duration = 0;
+	uint64_t bytes = 0;
+	uint32_t crc = 0;		// 整个文件的CRC32
+};
+
+// 转码检查点日志：每个切片写完后追加一行，进程崩溃或被杀后据此续转或修复。
+// 文件格式（文本，逐行）：
+//   input <输入内容指纹与转码参数哈希，见TranscodeIdentity>
+//   segment <文件名> <起始秒> <时长> <字节数> <crc32>
+//   end
+// 输入内容或转码参数变化后日志作废。只由muxer所在的线程调用，不加锁
+class CheckpointJournal {
+public:
+	CheckpointJournal(std::string journal_path, std::string identity);
+
+	// 读取已有日志；不存在、格式不对或身份已变化时返回false
+	bool load();
+	// 清空日志并写入当前的身份，开始一次新的转换
+	void reset();
+	// 只保留前count个切片，续转时丢弃之后的记录
+	void truncate(size_t count);
+	// 切片被重新生成后重新计算它的大小与校验和
+	void refresh(size_t index, const std::string& dir);
+	void mark_complete();
+
+	const std::vector<SegmentCheckpoint>& segments() const { return segments_; }
+	bool complete() const { return complete_; }
+
+	// 切片文件关闭时调用：趁文件还在页缓存里计算校验和，时长等播放列表写出后再一起记录
+	void on_segment_closed(const std::string& path);
+	// muxer写完播放列表时调用：把其中新出现的切片追加到日志
+	void on_playlist_closed(const std::string& path);
+
+	// 切片文件存在且大小、校验和与记录一致
+	bool verify(const std::string& dir, const SegmentCheckpoint& segment) const;
+	// 按日志中的前count个切片重写媒体播放列表，event为true时标记为EVENT类型
+	void write_playlist(const std::string& path, size_t count, bool ended, bool event) const;
+
+	static bool file_crc32(const std::string& path, uint64_t& bytes, uint32_t& crc);
+
+private:
+	void append(const std::string& line);
+	// 整体重写日志（先写临时文件再替换）
+	void save() const;
+
+	std::string journal_path_;
+	std::string identity_;
+	std::vector<SegmentCheckpoint> segments_;
+	bool complete_ = false;
+	struct Checksum {
+		uint64_t bytes = 0;
+		uint32_t crc = 0;
+	};
+	std::unordered_map<std::string, Checksum> pending_;	// 已关闭、尚未出现在播放列表中的切片
+};
+
+#endif // !CHECKPOINT_JOURNAL_H
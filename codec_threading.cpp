@@ -0,0 +1,61 @@
+#include "codec_threading.h"
+#include"logger.h"
+#include<algorithm>
+#include<thread>
+
+namespace {
+	// 每路转码至少分到这么多像素才值得多开一个线程（640x360），720p约4个线程，1080p约9个，4K约36个
+	constexpr long long PIXELS_PER_THREAD = 640LL * 360;
+	// 编码与缩放按水平条带切分，每个条带至少这么多行
+	constexpr int MIN_ROWS_PER_SLICE = 64;
+
+	int pick(int configured, int automatic) {
+		return configured > 0 ? configured : std::max(1, automatic);
+	}
+}
+
+int available_threads(const Config& config) {
+	if (config.HLS_THREAD_BUDGET > 0) {
+		return config.HLS_THREAD_BUDGET;
+	}
+	return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+CodecThreading tune_codec_threading(const Config& config, int width, int height, int concurrent_transcodes) {
+	int cores = available_threads(config);
+	int share = std::max(1, cores / std::max(1, concurrent_transcodes));
+	long long pixels = static_cast<long long>(std::max(width, 1)) * std::max(height, 1);
+	int budget = static_cast<int>(std::clamp<long long>(pixels / PIXELS_PER_THREAD, 1, share));
+	int max_slices = std::max(1, height / MIN_ROWS_PER_SLICE);
+
+	// 串行循环里解码、缩放、编码轮流执行，各自都可以用满这一路的份额；
+	// 流水线模式下三者同时运行，按大致的开销分配：编码一半，解码和缩放各四分之一
+	bool overlapped = concurrent_transcodes <= 1 && config.HLS_PIPELINE_QUEUE > 0;
+	int decoder_auto = overlapped ? budget / 4 : budget;
+	int encoder_auto = overlapped ? budget / 2 : budget;
+	int scale_auto = overlapped ? budget - budget / 2 - budget / 4 : budget;
+
+	CodecThreading threading;
+	threading.decoder_threads = pick(config.HLS_DECODER_THREADS, decoder_auto);
+	threading.encoder_threads = pick(config.HLS_ENCODER_THREADS, std::min(encoder_auto, max_slices));
+	threading.scale_threads = pick(config.HLS_SCALE_THREADS, std::min(scale_auto, max_slices));
+	// 帧级并行每多一个线程就多缓存一帧；低延迟HLS只用slice级并行
+	threading.decoder_thread_type = config.LL_HLS_ENABLED ? FF_THREAD_SLICE : (FF_THREAD_FRAME | FF_THREAD_SLICE);
+
+	LOG_INFO("转码线程配置(" << width << "x" << height << ", " << concurrent_transcodes << "路/" << cores << "核)：解码"
+		<< threading.decoder_threads << " 编码" << threading.encoder_threads << " 缩放" << threading.scale_threads);
+	return threading;
+}
+
+void apply_decoder_threading(AVCodecContext* ctx, const CodecThreading& threading) {
+	ctx->thread_count = threading.decoder_threads;
+	ctx->thread_type = threading.decoder_thread_type;
+}
+
+void apply_encoder_threading(AVCodecContext* ctx, const CodecThreading& threading) {
+	ctx->thread_count = threading.encoder_threads;
+	if (threading.encoder_threads > 1) {
+		// libopenh264按slice分配编码线程，slice数与线程数一致
+		ctx->slices = threading.encoder_threads;
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#ifndef CODEC_THREADING_H
+#define CODEC_THREADING_H
+#include"config.h"
+
+// 一路视频转码的线程配置：解码器线程数与线程类型、编码器线程数（openh264按slice并行）、缩放的slice线程数
+struct CodecThreading {
+	int decoder_threads = 1;
+	int decoder_thread_type = 0;    // FF_THREAD_FRAME / FF_THREAD_SLICE 的组合
+	int encoder_threads = 1;
+	int scale_threads = 1;
+};
+
+// 本实例可用的线程数：HLS_THREAD_BUDGET，未设置时为CPU核心数
+int available_threads(const Config& config);
+
+// 根据CPU核心数、分辨率和同时进行的视频转码路数挑选线程配置；
+// 配置项不为0时以配置为准，0表示由这里自动决定
+CodecThreading tune_codec_threading(const Config& config, int width, int height, int concurrent_transcodes);
+
+// 在avcodec_open2之前调用
+void apply_decoder_threading(AVCodecContext* ctx, const CodecThreading& threading);
+void apply_encoder_threading(AVCodecContext* ctx, const CodecThreading& threading);
+
+#endif // !CODEC_THREADING_H
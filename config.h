@@ -3,6 +3,7 @@
 #define	CONFIG_H
 #include<string>
 #include<unordered_set>
+#include<vector>
 extern"C" {
 	#include<libavcodec/avcodec.h>
 	#include<libavutil/opt.h>
@@ -14,6 +15,12 @@ extern"C" {
 extern const std::unordered_set<int> TRANSCODE_VIDEO_CODECS;
 extern const std::unordered_set<int> TRANSCODE_AUDIO_CODECS;
 
+// 多码率阶梯中的一档
+struct AbrRendition {
+	std::string name;	// 输出子目录名
+	int height;			// 宽度按源画面比例计算；高于源分辨率的档位会被跳过
+	int video_bitrate;
+};
 
 struct Config {
 	const std::unordered_set<int>& TRANSCODE_VIDEO_CODECS;
@@ -27,10 +34,61 @@ struct Config {
 	const int VIDEO_BITRATE = 1000000;
 	const int AUDIO_BITRATE = 128000;
 	const int HTTP_THREADS = 4;
+	const bool HTTP_REUSEPORT_SHARDS = false;//每个工作线程独占io_context和SO_REUSEPORT监听socket，由内核分发新连接（仅Linux）
+	const bool HTTP_PIN_THREADS = false;//分片模式下把工作线程依次绑定到CPU核心
+	const int HTTP_KEEP_ALIVE_TIMEOUT = 15;//空闲连接超时（秒）
+	const int HTTP_MAX_KEEP_ALIVE_REQUESTS = 1000;//单连接最多处理的请求数
+	const int HTTP_MAX_CONNECTIONS = 10000;//并发连接上限，超出时返回503并关闭
+	const int HTTP_BUSY_KEEP_ALIVE_TIMEOUT = 2;//连接数超过上限的3/4时改用的空闲超时（秒）
+	const size_t HTTP_MAX_REQUEST_BYTES = 16 * 1024;//单连接请求缓冲区上限，请求头超出时返回431
+	const size_t HTTP_MAX_HEADERS = 64;//单个请求的请求头字段数上限，超出时返回431
+	const int HTTP_WRITE_TIMEOUT = 30;//单个响应的基础发送时限（秒）
+	const size_t HTTP_MIN_SEND_RATE = 32 * 1024;//慢客户端下限（字节/秒），按响应大小延长发送时限
+	const size_t HTTP_PACING_RATE = 0;//单连接发送速率上限（字节/秒），0表示不限速
+	const bool HTTP_PACING_KERNEL = true;//Linux上优先用SO_MAX_PACING_RATE由内核限速，不可用时用令牌桶
+	const size_t HTTP_PACING_BURST = 512 * 1024;//令牌桶容量，播放列表和切片开头可以突发发送（至少64KB）
+	const size_t HTTP_SEND_QUANTUM = 256 * 1024;//零拷贝发送每轮最多写出的字节数，之后让出线程给其他连接；0表示不分轮
+	const size_t SEGMENT_CACHE_BYTES = 256 * 1024 * 1024;//切片内存缓存总预算，0表示禁用
+	const size_t SEGMENT_CACHE_MAX_ENTRY_BYTES = 16 * 1024 * 1024;//超过该大小的文件不进缓存
+	const int PLAYLIST_CACHE_TTL_MS = 500;//播放列表缓存有效期（毫秒）
+	const bool FILE_READER_IO_URING = true;//Linux上用io_uring异步读取切片，不可用时自动回退线程池
+	const bool HTTP_ZERO_COPY = true;//Linux上用sendfile发送未缓存的文件，false时经用户态缓冲区分块读写
+	const int FILE_READER_THREADS = 4;//读文件线程池大小
+	const unsigned IO_URING_ENTRIES = 256;//io_uring提交队列深度
+	const int HLS_SEGMENT_MAX_AGE = 31536000;//切片写完后不再改变，允许下游长期缓存（秒）；启用HLS_CHECKPOINT或JIT_ENABLED时切片可能被原地替换，改为每次重新验证
+	const int HLS_PLAYLIST_MAX_AGE = 1;//直播播放列表的缓存时间（秒）
 	const bool CLEAN_OLD_SEGMENTS = true;
+	const int HLS_PARALLEL_WORKERS = 0;//视频需要转码时按关键帧分段并行转码的线程数，0表示CPU核心数，1表示串行
+	const int HLS_CHUNK_SEGMENTS = 3;//并行转码每段的最短时长（切片数），分段在关键帧处衔接
+	const int HLS_DECODER_THREADS = 0;//视频解码器线程数，0表示按核心数和分辨率自动选择
+	const int HLS_ENCODER_THREADS = 0;//视频编码器线程数（按slice并行），0表示自动
+	const int HLS_SCALE_THREADS = 0;//像素格式转换的slice线程数，0表示自动
+	const int HLS_THREAD_BUDGET = 0;//本实例转码可用的线程总数（自动选择线程数与并行分段时的上限），0表示CPU核心数
+	const size_t HLS_PIPELINE_QUEUE = 32;//串行转码时拆成解复用/解码/缩放/编码/封装流水线，阶段间队列的长度；0表示单线程
+	// 多码率阶梯，例如 {{"1080p",1080,5000000},{"720p",720,2800000},{"480p",480,1400000},{"360p",360,800000}}；
+	// 为空时只输出源分辨率一路。启用后HLS_DIR/M3U8_FILENAME为主播放列表，各档输出到HLS_DIR/<name>/
+	const std::vector<AbrRendition> HLS_ABR_LADDER = {};
+	const bool HLS_CHECKPOINT = false;//每个写完的切片记入检查点日志，中断后从最后一个完好的切片续转，已完成的转换只重转损坏的切片；修复会原地替换切片，启用后切片不再按immutable长期缓存
+	const bool HLS_SERVE_WHILE_GENERATING = true;//后台转码并立即启动HTTP服务器，播放列表为EVENT类型，随切片写完逐步增长
+
+	const bool WATCH_ENABLED = false;//服务模式：监视WATCH_DIR，新到的视频排队转码到HLS_DIR/<文件名>/，不再使用VIDEO_PATH
+	const std::string WATCH_DIR = "incoming";
+	const int WATCH_WORKERS = 2;//同时转码的任务数
+	const int WATCH_MAX_THREADS = 0;//所有任务合计的编解码线程上限，按任务数均分；0表示CPU核心数
+	const int WATCH_POLL_MS = 1000;//不支持inotify时轮询目录的间隔（毫秒），文件大小两次不变才入队
+
+	const bool JIT_ENABLED = false;//按需转码：启动时只建立关键帧索引并写出完整播放列表，切片在第一次被请求时才转码
+	const int JIT_WORKERS = 2;//同时转码的切片数
+	const int JIT_PREFETCH_SEGMENTS = 2;//请求某个切片时预先转码其后的切片数
+
+	const bool LL_HLS_ENABLED = false;//低延迟HLS：输出EXT-X-PART与预加载提示
+	const double LL_HLS_PART_DURATION = 1.0;//partial segment时长（秒）
+	const std::string LL_HLS_PART_PLAYLIST = "parts.m3u8";//muxer内部维护的partial segment列表
+	const std::string LL_HLS_PART_PREFIX = "part";
 
 	const bool FORCE_RECONVERT = false;
-	const bool CHECK_HLS_INTEGRITY = true;
+	const bool CHECK_HLS_INTEGRITY = false;//命中转码清单后仍逐个检查播放列表中的切片文件
+	const bool HLS_MANIFEST_FULL_HASH = false;//对整个输入文件计算xxHash64作为内容指纹，默认只抽样读取首尾与中间若干块
 	const int MAX_RECONVERT_ATTENMPTS = 3;
 
 	const std::unordered_set<std::string> SUPPORTED_FORMAT = {
@@ -42,6 +100,38 @@ struct Config {
 		, TRANSCODE_AUDIO_CODECS(::TRANSCODE_AUDIO_CODECS)
 	{
 	}
+
+	// 指定输出目录与端口，用于在同一进程内运行独立实例（如基准测试）
+	Config(std::string hls_dir, uint64_t http_port)
+		: TRANSCODE_VIDEO_CODECS(::TRANSCODE_VIDEO_CODECS)
+		, TRANSCODE_AUDIO_CODECS(::TRANSCODE_AUDIO_CODECS)
+		, HLS_DIR(std::move(hls_dir))
+		, HTTP_PORT(http_port)
+	{
+	}
+
+	// 基准测试对比不同的发送与读取路径：切片缓存预算（0表示禁用）、io_uring与sendfile可分别关闭
+	Config(std::string hls_dir, uint64_t http_port, size_t segment_cache_bytes, bool io_uring, bool zero_copy)
+		: TRANSCODE_VIDEO_CODECS(::TRANSCODE_VIDEO_CODECS)
+		, TRANSCODE_AUDIO_CODECS(::TRANSCODE_AUDIO_CODECS)
+		, HLS_DIR(std::move(hls_dir))
+		, HTTP_PORT(http_port)
+		, SEGMENT_CACHE_BYTES(segment_cache_bytes)
+		, FILE_READER_IO_URING(io_uring)
+		, HTTP_ZERO_COPY(zero_copy)
+	{
+	}
+
+	// 监视目录服务中的一个转码任务：指定输入文件、输出目录、可用线程数与是否记录检查点，其余取默认值
+	Config(std::string video_path, std::string hls_dir, int thread_budget, bool checkpoint)
+		: TRANSCODE_VIDEO_CODECS(::TRANSCODE_VIDEO_CODECS)
+		, TRANSCODE_AUDIO_CODECS(::TRANSCODE_AUDIO_CODECS)
+		, VIDEO_PATH(std::move(video_path))
+		, HLS_DIR(std::move(hls_dir))
+		, HLS_THREAD_BUDGET(thread_budget)
+		, HLS_CHECKPOINT(checkpoint)
+	{
+	}
 };
 struct RTMPConfig{
 	bool enabled= true;
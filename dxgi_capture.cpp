@@ -1,7 +1,7 @@
 #include "dxgi_capture.h"
+#include "logger.h"
 #include<chrono>
 #include<stdexcept>
-#include<iostream>
 
 #pragma comment(lib,"swscale.lib")
 #pragma comment(lib,"avutil.lib")
@@ -53,7 +53,7 @@ DXGICapture::~DXGICapture() {
 bool DXGICapture::init() {
 	HRESULT hr = CreateDXGIFactory2(0, IID_PPV_ARGS(&dxgi_factory_));
 	if (FAILED(hr)) {
-		std::cerr << "CreateDXGIFactory2 failed:" << hr << std::endl;
+		LOG_ERROR("CreateDXGIFactory2 failed:" << hr);
 		return false;
 	}
 
@@ -81,9 +81,8 @@ bool DXGICapture::init() {
                             
                             // 创建staging纹理
                             if (create_staging_texture(dupl_desc.ModeDesc.Width, dupl_desc.ModeDesc.Height)) {
-                                std::cout << "DXGI capture initialized successfully: " 
-                                          << dupl_desc.ModeDesc.Width << "x" << dupl_desc.ModeDesc.Height 
-                                          << std::endl;
+                                LOG_INFO("DXGI capture initialized successfully: " 
+                                          << dupl_desc.ModeDesc.Width << "x" << dupl_desc.ModeDesc.Height);
                                 return true;
                             }
                         }
@@ -95,7 +94,7 @@ bool DXGICapture::init() {
         adapter.Reset();
     }
 
-    std::cerr << "Failed to initialize output duplication" << std::endl;
+    LOG_ERROR("Failed to initialize output duplication");
     return false;
 }
 
@@ -124,7 +123,7 @@ bool DXGICapture::create_staging_texture(UINT width, UINT height) {
 
 	HRESULT hr=d3d_device_->CreateTexture2D(&desc,nullptr,&staging_texture_);
 	if(FAILED(hr)){
-		std::cerr<<"Failed to create staging texture"<<std::endl;
+		LOG_ERROR("Failed to create staging texture");
 		return false;
 	}
 	int src_width = width;
@@ -135,7 +134,7 @@ bool DXGICapture::create_staging_texture(UINT width, UINT height) {
         src_height = config_.region_height > 0 ? config_.region_height : height;
         
         if (src_width <= 0 || src_height <= 0) {
-            std::cerr << "Invalid region dimensions: " << src_width << "x" << src_height << std::endl;
+            LOG_ERROR("Invalid region dimensions: " << src_width << "x" << src_height);
             return false;
         }
     }
@@ -168,12 +167,12 @@ bool DXGICapture::create_staging_texture(UINT width, UINT height) {
 	);
     
     if(!sws_context_){
-        std::cerr<<"Failed to create sws_context"<<std::endl;
+        LOG_ERROR("Failed to create sws_context");
         return false;
     }
 
-    std::cout << "Scaling configured: " << src_width << "x" << src_height 
-              << " -> " << target_width << "x" << target_height << std::endl;
+    LOG_INFO("Scaling configured: " << src_width << "x" << src_height 
+              << " -> " << target_width << "x" << target_height);
     return true;
 }
 
@@ -183,7 +182,7 @@ bool DXGICapture::start() {
 		return true;
 	if (!duplication_ || !d3d_device_ || !d3d_context_) {
 		if (!init()) {  
-			std::cerr << "Failed to reinitialize DXGICapture on start()" << std::endl;
+			LOG_ERROR("Failed to reinitialize DXGICapture on start()");
 			return false;
 		}
 	}
@@ -211,7 +210,7 @@ void DXGICapture::capture_thread() {
 		const auto start_time = std::chrono::steady_clock::now();
 
 		if (!duplication_) {
-			std::cerr << "duplication_ is null, reinitializing..." << std::endl;
+			LOG_WARN("duplication_ is null, reinitializing...");
 			if (!init()) {  
 				std::this_thread::sleep_for(frame_interval);
 				continue;
@@ -222,7 +221,7 @@ void DXGICapture::capture_thread() {
 		HRESULT hr = duplication_->AcquireNextFrame(100, &frame_info,&resource);
 		if (FAILED(hr)) {
 			if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET) {
-				std::cerr << "Device lost,reinitializing..." << std::endl;
+				LOG_WARN("Device lost,reinitializing...");
 				device_lost_ = true;
 				if (!handle_device_lost()) {
 					std::this_thread::sleep_for(frame_interval);
@@ -336,8 +335,8 @@ bool DXGICapture::convert_texture_to_yuv(ID3D11Texture2D* texture, VideoFrame& f
         d3d_context_->Unmap(staging_texture_.Get(), 0);
 
         if (converted_lines != target_height) {
-            std::cerr << "sws_scale failed: converted " << converted_lines
-                << " lines (expected " << target_height << ")" << std::endl;
+            LOG_ERROR("sws_scale failed: converted " << converted_lines
+                << " lines (expected " << target_height << ")");
             return false;
         }
     }
@@ -457,11 +456,11 @@ bool DXGICapture::process_region_capture(D3D11_MAPPED_SUBRESOURCE& mapped_resour
 bool DXGICapture::validate_region_parameters(D3D11_TEXTURE2D_DESC& desc){
 	RECT rect=config_.capture_rect;
 	if(rect.left<0||rect.top<0||rect.right>(int)desc.Width||rect.bottom>(int)desc.Height){
-		std::cerr<<"Invalid region parameters: "<<rect.left<<","<<rect.top<<","<<rect.right<<","<<rect.bottom<<std::endl;
+		LOG_ERROR("Invalid region parameters: "<<rect.left<<","<<rect.top<<","<<rect.right<<","<<rect.bottom);
 		return false;
 	}
 	if(rect.right<=rect.left||rect.bottom<=rect.top){
-		std::cerr<<"Invalid capture region dimensions"<<std::endl;
+		LOG_ERROR("Invalid capture region dimensions");
 		return false;
 	}
 	return true;
@@ -632,7 +631,7 @@ bool DXGICapture::process_fullscreen_capture(D3D11_MAPPED_SUBRESOURCE& mapped_re
 
 bool DXGICapture::set_capture_region(int x, int y, int width, int height) {
     if (width <= 0 || height <= 0) {
-        std::cerr << "Invalid region dimensions: " << width << "x" << height << std::endl;
+        LOG_ERROR("Invalid region dimensions: " << width << "x" << height);
         return false;
     }
 
@@ -652,7 +651,7 @@ bool DXGICapture::set_capture_region(int x, int y, int width, int height) {
 
 bool DXGICapture::set_capture_window(HWND window) {
     if (!IsWindow(window)) {
-        std::cerr << "Invalid window handle" << std::endl;
+        LOG_ERROR("Invalid window handle");
         return false;
     }
 
@@ -680,7 +679,7 @@ bool DXGICapture::update_region_dynamically() {
     RECT current_rect;
     if (GetWindowRect(config_.target_window, &current_rect)) {
         if (memcmp(&current_rect, &config_.capture_rect, sizeof(RECT)) != 0) {
-            std::cout << "Window moved, updating capture region..." << std::endl;
+            LOG_DEBUG("Window moved, updating capture region...");
             return set_capture_region(
                 current_rect.left, current_rect.top,
                 current_rect.right - current_rect.left,
@@ -1,5 +1,39 @@
 #include "encoder.h"
-#include<iostream>
+#include "metrics.h"
+#include "logger.h"
+#include<chrono>
+
+namespace {
+    // 编码指标：kind区分视频与音频；编码耗时只统计编码器调用本身，不含包回调（写文件/推流）
+    struct EncoderMetrics {
+        Metrics::Counter& frames;
+        Metrics::Histogram& encode_seconds;
+        Metrics::Histogram& packet_bytes;
+
+        explicit EncoderMetrics(const std::string& kind)
+            : frames(Metrics::instance().counter("recorder_encoded_frames_total",
+                "Frames submitted to the encoder", "kind=\"" + kind + "\""))
+            , encode_seconds(Metrics::instance().histogram("recorder_encode_seconds",
+                "Encoder time per submitted frame", Metrics::latency_buckets(), "kind=\"" + kind + "\""))
+            , packet_bytes(Metrics::instance().histogram("recorder_encoded_packet_bytes",
+                "Size of encoded packets", Metrics::size_buckets(), "kind=\"" + kind + "\"")) {
+        }
+    };
+
+    EncoderMetrics& video_metrics() {
+        static EncoderMetrics metrics("video");
+        return metrics;
+    }
+
+    EncoderMetrics& audio_metrics() {
+        static EncoderMetrics metrics("audio");
+        return metrics;
+    }
+
+    double seconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
 
 Encoder::Encoder()=default ;
 Encoder::~Encoder(){
@@ -13,13 +47,13 @@ bool Encoder::initialize(const EncoderConfig& config){
     codec_=avcodec_find_encoder_by_name(config_.video_codec_name.c_str());
     if(!codec_)
     {
-        std::cerr<<"Failed to find encoder: "<<config_.video_codec_name<<std::endl;
+        LOG_ERROR("Failed to find encoder: "<<config_.video_codec_name);
         return false;
     }
     codec_ctx_=avcodec_alloc_context3(codec_);
 
     if(!codec_ctx_){
-        std::cerr<<"Failed to allocate codec context"<<std::endl;
+        LOG_ERROR("Failed to allocate codec context");
         return false;
     }
 
@@ -55,17 +89,17 @@ bool Encoder::initialize(const EncoderConfig& config){
     if(ret<0){
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error,sizeof(error),ret);
-        std::cerr<<"Failed to open codec: "<<error<<std::endl;
+        LOG_ERROR("Failed to open codec: "<<error);
         return false;
     }
-    std::cout<<"Encoder initialized successfully"<<std::endl;
+    LOG_INFO("Encoder initialized successfully");
     return true;
 }
 
 bool Encoder::initializeAudio(const EncoderConfig& config){
     audio_codec_=avcodec_find_encoder_by_name(config_.audio_codec_name.c_str());
     if(!audio_codec_){
-        std::cerr<<"Failed to find audio encoder: "<<config_.audio_codec_name<<std::endl;
+        LOG_ERROR("Failed to find audio encoder: "<<config_.audio_codec_name);
         return false;
     }
 
@@ -73,7 +107,7 @@ bool Encoder::initializeAudio(const EncoderConfig& config){
      
     audio_codec_ctx_=avcodec_alloc_context3(audio_codec_);
     if(!audio_codec_ctx_){
-        std::cerr<<"Failed to allocate audio codec context"<<std::endl;
+        LOG_ERROR("Failed to allocate audio codec context");
         return false;
     }
     
@@ -100,14 +134,14 @@ bool Encoder::initializeAudio(const EncoderConfig& config){
     if(ret<0){
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error,sizeof(error),ret);
-        std::cerr<<"Failed to open audio codec: "<<error<<std::endl;
+        LOG_ERROR("Failed to open audio codec: "<<error);
         return false;
     }
 
     //重采样
     swr_ctx_=swr_alloc();
     if(!swr_ctx_){
-        std::cerr<<"Failed to allocate swr context"<<std::endl;
+        LOG_ERROR("Failed to allocate swr context");
         return false;
     }
     AVChannelLayout in_ch_layout=AV_CHANNEL_LAYOUT_STEREO;
@@ -124,7 +158,7 @@ bool Encoder::initializeAudio(const EncoderConfig& config){
     if (ret < 0) {
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error, sizeof(error), ret);
-        std::cerr << "Failed to set resampler options: " << error << std::endl;
+        LOG_ERROR("Failed to set resampler options: " << error);
         swr_free(&swr_ctx_);
         return false;
     }
@@ -133,15 +167,15 @@ bool Encoder::initializeAudio(const EncoderConfig& config){
     if (ret < 0) {
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error, sizeof(error), ret);
-        std::cerr << "Failed to initialize resampler: " << error << std::endl;
+        LOG_ERROR("Failed to initialize resampler: " << error);
         swr_free(&swr_ctx_);
         return false;
     }
 
-    std::cout << "Audio encoder initialized successfully" << std::endl;
-    std::cout << "  Sample rate: " << config.sample_rate << "Hz" << std::endl;
-    std::cout << "  Channels: " << config.channel_layout.nb_channels << std::endl;
-    std::cout << "  Format: " << av_get_sample_fmt_name(config.sample_format) << std::endl;
+    LOG_INFO("Audio encoder initialized successfully");
+    LOG_INFO("  Sample rate: " << config.sample_rate << "Hz");
+    LOG_INFO("  Channels: " << config.channel_layout.nb_channels);
+    LOG_INFO("  Format: " << av_get_sample_fmt_name(config.sample_format));
     
     return true;
 }
@@ -159,43 +193,50 @@ bool Encoder::encodeFrame(AVFrame* frame) {
     
     frame_count_++;
 
-    std::cout << "Encoding video frame #" << frame_count_ 
+    LOG_DEBUG("Encoding video frame #" << frame_count_ 
               << ", pts: " << frame->pts 
-              << " (" << pts_us << "us)" << std::endl;
+              << " (" << pts_us << "us)");
 
+    EncoderMetrics& metrics = video_metrics();
+    metrics.frames.inc();
+    auto call_start = std::chrono::steady_clock::now();
     int ret = avcodec_send_frame(codec_ctx_, frame);
+    double encode_seconds = seconds_since(call_start);
     if (ret < 0) {
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error, sizeof(error), ret);
-        std::cerr << "Failed to send frame to encoder: " << error << std::endl;
+        LOG_ERROR("Failed to send frame to encoder: " << error);
         return false;
     }
 
-    AVPacket* packet = av_packet_alloc();
+    Packet packet = packet_pool_.acquire();
     bool success = false;
     int packet_count = 0;
 
     while (ret >= 0) {
+        call_start = std::chrono::steady_clock::now();
         ret = avcodec_receive_packet(codec_ctx_, packet);
+        encode_seconds += seconds_since(call_start);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break;
         }
         else if (ret < 0) {
             char error[AV_ERROR_MAX_STRING_SIZE];
             av_make_error_string(error, sizeof(error), ret);
-            std::cerr << "Error during encoding: " << error << std::endl;
+            LOG_ERROR("Error during encoding: " << error);
             break;
         }
         // skip empty packets
         if (packet->size <= 0) {
-            std::cout << "Skipping empty packet" << std::endl;
+            LOG_DEBUG("Skipping empty packet");
             av_packet_unref(packet);
             continue;
         }
 
         packet_count++;
-        std::cout << "Encoded packet #" << packet_count << ", size: " << packet->size
-            << ", keyframe: " << (packet->flags & AV_PKT_FLAG_KEY ? "YES" : "NO") << std::endl;
+        metrics.packet_bytes.observe(packet->size);
+        LOG_TRACE("Encoded packet #" << packet_count << ", size: " << packet->size
+            << ", keyframe: " << (packet->flags & AV_PKT_FLAG_KEY ? "YES" : "NO"));
 
         if (packet->size > 0) {
             std::lock_guard<std::mutex> lock(callback_mutex_);
@@ -208,13 +249,13 @@ bool Encoder::encodeFrame(AVFrame* frame) {
         av_packet_unref(packet);
     }
 
-    av_packet_free(&packet);
+    metrics.encode_seconds.observe(encode_seconds);
 
     if (packet_count > 0) {
-        std::cout << "Successfully encoded " << packet_count << " packets for frame #" << frame_count_ << std::endl;
+        LOG_DEBUG("Successfully encoded " << packet_count << " packets for frame #" << frame_count_);
     }
     else {
-        std::cout << "No packets encoded for frame #" << frame_count_ << std::endl;
+        LOG_DEBUG("No packets encoded for frame #" << frame_count_);
     }
 
     return success;
@@ -237,38 +278,45 @@ bool Encoder::encodeAudioFrame(AVFrame* frame) {
     audio_samples_encoded_ += frame->nb_samples;
     audio_frame_count_++;
 
-    std::cout << "Audio encoding frame #" << audio_frame_count_
+    LOG_DEBUG("Audio encoding frame #" << audio_frame_count_
               << ", samples: " << frame->nb_samples 
               << ", pts: " << frame->pts
               << " (" << pts_us << "us)"
-              << ", total_samples: " << audio_samples_encoded_ << std::endl;
+              << ", total_samples: " << audio_samples_encoded_);
 
+    EncoderMetrics& metrics = audio_metrics();
+    metrics.frames.inc();
+    auto call_start = std::chrono::steady_clock::now();
     int ret=avcodec_send_frame(audio_codec_ctx_,frame);
+    double encode_seconds = seconds_since(call_start);
     if(ret<0){
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error,sizeof(error),ret);
-        std::cerr<<"Failed to send frame to audio encoder: "<<error<<std::endl;
+        LOG_ERROR("Failed to send frame to audio encoder: "<<error);
         return false;
     }
     
-    AVPacket* packet=av_packet_alloc();
+    Packet packet=packet_pool_.acquire();
     bool success=false;
     int packet_count=0;
 
     while(ret>=0){
+        call_start = std::chrono::steady_clock::now();
         ret=avcodec_receive_packet(audio_codec_ctx_,packet);
+        encode_seconds += seconds_since(call_start);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break;
         } else if (ret < 0) {
             char error[AV_ERROR_MAX_STRING_SIZE];
             av_make_error_string(error,sizeof(error),ret);
-            std::cerr << "Error during audio encoding: " << error << std::endl;
+            LOG_ERROR("Error during audio encoding: " << error);
             break;
         }
         packet_count++;
-        std::cout << "Audio encoded packet #" << packet_count 
+        metrics.packet_bytes.observe(packet->size);
+        LOG_TRACE("Audio encoded packet #" << packet_count 
                   << ", size: " << packet->size 
-                  << ", pts: " << packet->pts << std::endl;
+                  << ", pts: " << packet->pts);
         
         if (packet->size > 0) {
             std::lock_guard<std::mutex> lock(audio_callback_mutex_);
@@ -278,15 +326,15 @@ bool Encoder::encodeAudioFrame(AVFrame* frame) {
             }
             success = true;
         }else{
-            std::cout << "Skipping empty audio packet" << std::endl;
+            LOG_DEBUG("Skipping empty audio packet");
         }
         av_packet_unref(packet);
     }
-    av_packet_free(&packet);
+    metrics.encode_seconds.observe(encode_seconds);
     if (packet_count > 0) {
-        std::cout << "Successfully encoded " << packet_count << " audio packets for frame #" << audio_frame_count_ << std::endl;
+        LOG_DEBUG("Successfully encoded " << packet_count << " audio packets for frame #" << audio_frame_count_);
     } else {
-        std::cout << "No audio packets encoded for frame #" << audio_frame_count_ << std::endl;
+        LOG_DEBUG("No audio packets encoded for frame #" << audio_frame_count_);
     }
     return success;
 }
@@ -298,7 +346,7 @@ bool Encoder::flush() {
     int ret = avcodec_send_frame(codec_ctx_, nullptr);
     if (ret < 0) return false;
     
-    AVPacket* packet = av_packet_alloc();
+    Packet packet = packet_pool_.acquire();
     bool success = false;
     
     while (ret >= 0) {
@@ -317,7 +365,6 @@ bool Encoder::flush() {
         av_packet_unref(packet);
     }
     
-    av_packet_free(&packet);
     return success;
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include"utils.h"
+#include"ffmpeg_utils.h"
 #include"time_manager.h"
 #include<memory>
 #include<mutex>
@@ -83,6 +84,7 @@ private:
     std::vector<PacketCallback> audio_packet_callbacks_;
     std::mutex callback_mutex_;
     std::mutex audio_callback_mutex_;
+    PacketPool packet_pool_;    // 编码输出包复用，稳态下不再分配
     
     int64_t frame_count_ = 0;
     int64_t audio_frame_count_ = 0;
@@ -7,6 +7,8 @@ extern "C" {
 #include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
 #include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
 }
 
 // CodecContext实现
@@ -34,11 +36,31 @@ CodecContext& CodecContext::operator=(CodecContext&& other) noexcept {
 
 // SwsContext实现
 FFmpegSwsContext::FFmpegSwsContext(int src_w, int src_h, AVPixelFormat src_fmt,
-    int dst_w, int dst_h, AVPixelFormat dst_fmt, int flags) {
-    ctx = sws_getContext(src_w, src_h, src_fmt,
-        dst_w, dst_h, dst_fmt,
-        flags, nullptr, nullptr, nullptr);
+    int dst_w, int dst_h, AVPixelFormat dst_fmt, int flags, int threads) {
+    if (threads <= 1) {
+        ctx = sws_getContext(src_w, src_h, src_fmt,
+            dst_w, dst_h, dst_fmt,
+            flags, nullptr, nullptr, nullptr);
+        if (!ctx) throw std::runtime_error("Failed to allocate SwsContext");
+        return;
+    }
+    // 多线程缩放只能通过选项设置：sws_scale内部把图像切成水平slice交给自带的线程池
+    ctx = sws_alloc_context();
     if (!ctx) throw std::runtime_error("Failed to allocate SwsContext");
+    av_opt_set_int(ctx, "srcw", src_w, 0);
+    av_opt_set_int(ctx, "srch", src_h, 0);
+    av_opt_set_int(ctx, "src_format", src_fmt, 0);
+    av_opt_set_int(ctx, "dstw", dst_w, 0);
+    av_opt_set_int(ctx, "dsth", dst_h, 0);
+    av_opt_set_int(ctx, "dst_format", dst_fmt, 0);
+    av_opt_set_int(ctx, "sws_flags", flags, 0);
+    av_opt_set_int(ctx, "threads", threads, 0);
+    int ret = sws_init_context(ctx, nullptr, nullptr);
+    if (ret < 0) {
+        sws_freeContext(ctx);
+        ctx = nullptr;
+        check_ffmpeg_error(ret, "Failed to initialize SwsContext");
+    }
 }
 
 FFmpegSwsContext::~FFmpegSwsContext() {
@@ -81,9 +103,174 @@ Frame::Frame(int width, int height, AVPixelFormat fmt) {
 }
 
 Frame::~Frame() {
-    if (frame) av_frame_free(&frame);
+    reset();
+}
+
+Frame::Frame(Frame&& other) noexcept : frame(other.frame), pool(other.pool) {
+    other.frame = nullptr;
+    other.pool = nullptr;
+}
+
+Frame& Frame::operator=(Frame&& other) noexcept {
+    if (this != &other) {
+        reset();
+        frame = other.frame;
+        pool = other.pool;
+        other.frame = nullptr;
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+void Frame::reset() {
+    if (!frame) return;
+    if (pool) pool->release(frame);
+    else av_frame_free(&frame);
+    frame = nullptr;
+    pool = nullptr;
 }
 
 void Frame::alloc_buffer(int align) {
     check_ffmpeg_error(av_frame_get_buffer(frame, align), "Failed to alloc frame buffer");
+}
+
+// Packet实现
+Packet::~Packet() {
+    reset();
+}
+
+Packet::Packet(Packet&& other) noexcept : packet(other.packet), pool(other.pool) {
+    other.packet = nullptr;
+    other.pool = nullptr;
+}
+
+Packet& Packet::operator=(Packet&& other) noexcept {
+    if (this != &other) {
+        reset();
+        packet = other.packet;
+        pool = other.pool;
+        other.packet = nullptr;
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+void Packet::reset() {
+    if (!packet) return;
+    if (pool) pool->release(packet);
+    else av_packet_free(&packet);
+    packet = nullptr;
+    pool = nullptr;
+}
+
+// PacketPool实现
+PacketPool::PacketPool(size_t max_idle) : max_idle_(max_idle) {
+    idle_.reserve(max_idle_);
+}
+
+PacketPool::~PacketPool() {
+    for (AVPacket* packet : idle_) {
+        av_packet_free(&packet);
+    }
+}
+
+Packet PacketPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            AVPacket* packet = idle_.back();
+            idle_.pop_back();
+            return Packet(packet, this);
+        }
+    }
+    AVPacket* packet = av_packet_alloc();
+    if (!packet) throw std::runtime_error("Failed to allocate AVPacket");
+    return Packet(packet, this);
+}
+
+Packet PacketPool::ref(const AVPacket* src) {
+    Packet packet = acquire();
+    check_ffmpeg_error(av_packet_ref(packet.get(), src), "Failed to reference AVPacket");
+    return packet;
+}
+
+void PacketPool::release(AVPacket* packet) {
+    av_packet_unref(packet);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < max_idle_) {
+            idle_.push_back(packet);
+            return;
+        }
+    }
+    av_packet_free(&packet);
+}
+
+// FramePool实现
+namespace {
+    constexpr int FRAME_POOL_ALIGN = 32;   // 与av_frame_get_buffer默认对齐一致，满足SIMD要求
+}
+
+FramePool::FramePool(size_t max_idle) : max_idle_(max_idle) {
+    idle_.reserve(max_idle_);
+}
+
+FramePool::FramePool(int width, int height, AVPixelFormat fmt, size_t max_idle)
+    : width_(width), height_(height), format_(fmt), max_idle_(max_idle) {
+    idle_.reserve(max_idle_);
+    // 所有平面放在同一块缓冲区里，尾部留出与AVPacket相同的填充，防止SIMD越界读
+    int size = av_image_get_buffer_size(fmt, width, height, FRAME_POOL_ALIGN);
+    check_ffmpeg_error(size, "Failed to compute frame buffer size");
+    buffers_ = av_buffer_pool_init(static_cast<size_t>(size) + AV_INPUT_BUFFER_PADDING_SIZE, nullptr);
+    if (!buffers_) throw std::runtime_error("Failed to allocate AVBufferPool");
+}
+
+FramePool::~FramePool() {
+    for (AVFrame* frame : idle_) {
+        av_frame_free(&frame);
+    }
+    // 仍被编码器持有的缓冲区在最后一个引用释放时才真正回收
+    if (buffers_) av_buffer_pool_uninit(&buffers_);
+}
+
+Frame FramePool::acquire() {
+    AVFrame* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            frame = idle_.back();
+            idle_.pop_back();
+        }
+    }
+    if (!frame) {
+        frame = av_frame_alloc();
+        if (!frame) throw std::runtime_error("Failed to allocate AVFrame");
+    }
+    Frame result(frame, this);
+    if (!buffers_) {
+        return result;
+    }
+
+    frame->width = width_;
+    frame->height = height_;
+    frame->format = format_;
+    frame->buf[0] = av_buffer_pool_get(buffers_);
+    if (!frame->buf[0]) throw std::runtime_error("Failed to get buffer from AVBufferPool");
+    int ret = av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data,
+        static_cast<AVPixelFormat>(format_), width_, height_, FRAME_POOL_ALIGN);
+    check_ffmpeg_error(ret, "Failed to fill frame planes");
+    frame->extended_data = frame->data;
+    return result;
+}
+
+void FramePool::release(AVFrame* frame) {
+    av_frame_unref(frame);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < max_idle_) {
+            idle_.push_back(frame);
+            return;
+        }
+    }
+    av_frame_free(&frame);
 }
\ No newline at end of file
@@ -2,12 +2,17 @@
 #ifndef FFMPEG_UTILS_H
 #define FFMPEG_UTILS_H
 #include<memory>
+#include<mutex>
+#include<vector>
+#include<cstddef>
 extern "C" {
 	struct AVCodec;
 	struct AVCodecContext;
 	struct SwsContext;
 	struct SwrContext;
 	struct AVFrame;
+	struct AVPacket;
+	struct AVBufferPool;
 	struct AVChannelLayout;
 	enum AVPixelFormat;
 	enum AVSampleFormat;
@@ -37,7 +42,7 @@ private:
 public:
 	FFmpegSwsContext(int src_w, int src_h, AVPixelFormat src_fmt,
 		int dst_w, int dst_h, AVPixelFormat dst_fmt,
-		int flag = 0);
+		int flag = 0, int threads = 1);	// threads>1时按水平slice并行缩放
 	~FFmpegSwsContext();
 	FFmpegSwsContext(const FFmpegSwsContext&) = delete;
 	FFmpegSwsContext& operator=(const FFmpegSwsContext&) = delete;
@@ -58,17 +63,98 @@ public:
 
 };
 
+class FramePool;
+class PacketPool;
+
+// 只能移动的AVFrame所有权；来自FramePool时析构把AVFrame还给池子而不是释放
 class Frame {
 private:
 	AVFrame* frame = nullptr;
+	FramePool* pool = nullptr;
+	friend class FramePool;
+	Frame(AVFrame* pooled, FramePool* owner) : frame(pooled), pool(owner) {}
 public:
-	Frame(int width = 0, int height = 0, AVPixelFormat fmt = (AVPixelFormat)-1);
+	Frame() = default;		// 空，用作队列槽位或占位
+	explicit Frame(int width, int height = 0, AVPixelFormat fmt = (AVPixelFormat)-1);
 	~Frame();
 	Frame(const Frame&) = delete;
 	Frame& operator=(const Frame&) = delete;
+	Frame(Frame&&) noexcept;
+	Frame& operator=(Frame&&) noexcept;
 	AVFrame* get()const { return frame; }
 	operator AVFrame* ()const { return frame; }
+	AVFrame* operator->()const { return frame; }
+	explicit operator bool()const { return frame != nullptr; }
 	void alloc_buffer(int align = 32);
+	void reset();	// 立即释放或归还，之后为空
+};
+
+// 只能移动的AVPacket所有权；来自PacketPool时析构把AVPacket还给池子而不是释放
+class Packet {
+private:
+	AVPacket* packet = nullptr;
+	PacketPool* pool = nullptr;
+	friend class PacketPool;
+	Packet(AVPacket* pooled, PacketPool* owner) : packet(pooled), pool(owner) {}
+public:
+	Packet() = default;		// 空，用作队列槽位或占位
+	~Packet();
+	Packet(const Packet&) = delete;
+	Packet& operator=(const Packet&) = delete;
+	Packet(Packet&&) noexcept;
+	Packet& operator=(Packet&&) noexcept;
+	AVPacket* get()const { return packet; }
+	operator AVPacket* ()const { return packet; }
+	AVPacket* operator->()const { return packet; }
+	explicit operator bool()const { return packet != nullptr; }
+	void reset();
+};
+
+// AVPacket结构体的复用池，线程安全；池子必须比借出的Packet活得久
+class PacketPool {
+public:
+	explicit PacketPool(size_t max_idle = 64);
+	~PacketPool();
+	PacketPool(const PacketPool&) = delete;
+	PacketPool& operator=(const PacketPool&) = delete;
+
+	Packet acquire();
+	// 借出一个引用src数据的包：引用计数的数据只增加引用不复制
+	Packet ref(const AVPacket* src);
+
+private:
+	friend class Packet;
+	void release(AVPacket* packet);
+
+	std::mutex mutex_;
+	std::vector<AVPacket*> idle_;
+	size_t max_idle_;
+};
+
+// AVFrame结构体的复用池，线程安全；指定了尺寸和像素格式时，图像缓冲区来自AVBufferPool，
+// 帧被编码器等处释放后缓冲区自动回到池中，稳态下不再分配内存。池子必须比借出的Frame活得久
+class FramePool {
+public:
+	explicit FramePool(size_t max_idle = 16);
+	FramePool(int width, int height, AVPixelFormat fmt, size_t max_idle = 16);
+	~FramePool();
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	// 未指定格式时返回空帧（供解码器填充），否则返回已挂好缓冲区的可写帧
+	Frame acquire();
+
+private:
+	friend class Frame;
+	void release(AVFrame* frame);
+
+	int width_ = 0;
+	int height_ = 0;
+	int format_ = -1;
+	AVBufferPool* buffers_ = nullptr;
+	std::mutex mutex_;
+	std::vector<AVFrame*> idle_;
+	size_t max_idle_;
 };
 
 #endif // !FFMPEG_UTILS_H
@@ -0,0 +1,448 @@
+#include "file_reader.h"
+#include "metrics.h"
+#include "logger.h"
+#include <fstream>
+#include <cstring>
+
+#if defined(HLS_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+    struct ReaderMetrics {
+        Metrics& registry = Metrics::instance();
+        Metrics::Counter& uring_reads = registry.counter("hls_file_reads_total",
+            "Whole-file reads by backend", "backend=\"io_uring\"");
+        Metrics::Counter& pool_reads = registry.counter("hls_file_reads_total",
+            "Whole-file reads by backend", "backend=\"thread_pool\"");
+        Metrics::Histogram& uring_seconds = registry.histogram("hls_file_read_seconds",
+            "Whole-file read latency by backend", Metrics::latency_buckets(), "backend=\"io_uring\"");
+        Metrics::Histogram& pool_seconds = registry.histogram("hls_file_read_seconds",
+            "Whole-file read latency by backend", Metrics::latency_buckets(), "backend=\"thread_pool\"");
+    };
+
+    ReaderMetrics& reader_metrics() {
+        static ReaderMetrics metrics;
+        return metrics;
+    }
+
+#if defined(HLS_HAVE_IO_URING)
+    // 单次READ的长度上限，超过部分分多次提交
+    constexpr uint64_t MAX_READ_CHUNK = 1u << 30;
+
+    int io_uring_setup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    unsigned* ring_field(void* ring, uint32_t offset) {
+        return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+    }
+#endif
+}
+
+FileReader::FileReader(boost::asio::io_context& io_context, bool use_io_uring, int pool_threads, unsigned ring_entries)
+    : io_context_(io_context) {
+#if defined(HLS_HAVE_IO_URING)
+    if (use_io_uring && setup_ring(ring_entries)) {
+        LOG_INFO("File reader: io_uring with " << sq_entries_ << " entries");
+        wait_completions();
+    }
+#else
+    (void)use_io_uring;
+    (void)ring_entries;
+#endif
+
+    // 线程池总是存在：非Linux平台的主路径，也是io_uring队列满时的回退
+    int thread_count = std::max(1, pool_threads);
+    for (int i = 0; i < thread_count; ++i) {
+        pool_threads_.emplace_back([this]() { pool_worker(); });
+    }
+}
+
+FileReader::~FileReader() {
+#if defined(HLS_HAVE_IO_URING)
+    // 先等io_uring在途读取完成，其中需要回退的读取还会交给线程池
+    teardown_ring();
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        pool_stopping_ = true;
+    }
+    pool_cv_.notify_all();
+    for (auto& thread : pool_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+const char* FileReader::backend_name() const {
+#if defined(HLS_HAVE_IO_URING)
+    if (ring_fd_ >= 0) {
+        return "io_uring";
+    }
+#endif
+    return "thread_pool";
+}
+
+void FileReader::read(const std::string& path, uint64_t max_bytes, Callback callback) {
+    auto op = std::make_unique<ReadOp>();
+    op->path = path;
+    op->max_bytes = max_bytes;
+    op->callback = std::move(callback);
+    op->started = std::chrono::steady_clock::now();
+
+#if defined(HLS_HAVE_IO_URING)
+    if (ring_fd_ >= 0) {
+        // open/fstat是元数据操作，通常命中内核缓存，直接在调用线程完成；内容读取交给io_uring
+        op->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (op->fd < 0) {
+            op->result.error = std::error_code(errno, std::generic_category());
+            finish(std::move(op), true);
+            return;
+        }
+
+        struct stat st {};
+        if (::fstat(op->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            op->result.error = std::make_error_code(std::errc::io_error);
+            finish(std::move(op), true);
+            return;
+        }
+
+        op->result.file_size = static_cast<uint64_t>(st.st_size);
+        auto mtime = std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec);
+        op->result.validators = make_file_validators(op->result.file_size,
+            std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(mtime)));
+
+        if (op->result.file_size > op->max_bytes) {
+            op->result.too_large = true;
+            finish(std::move(op), true);
+            return;
+        }
+        if (op->result.file_size == 0) {
+            finish(std::move(op), true);
+            return;
+        }
+
+        op->result.data.resize(static_cast<size_t>(op->result.file_size));
+        if (submit_read(op.get())) {
+            op.release();   // 完成时由reap_completions接管
+            return;
+        }
+
+        fall_back(std::move(op));
+        return;
+    }
+#endif
+
+    enqueue_blocking(std::move(op));
+}
+
+void FileReader::enqueue_blocking(std::unique_ptr<ReadOp> op) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        pool_queue_.push_back(std::move(op));
+    }
+    pool_cv_.notify_one();
+}
+
+void FileReader::pool_worker() {
+    while (true) {
+        std::unique_ptr<ReadOp> op;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex_);
+            pool_cv_.wait(lock, [this]() { return pool_stopping_ || !pool_queue_.empty(); });
+            // 停止时仍处理完已排队的读取，保证每个回调都被调用
+            if (pool_queue_.empty()) {
+                return;
+            }
+            op = std::move(pool_queue_.front());
+            pool_queue_.pop_front();
+        }
+        read_blocking(*op);
+        finish(std::move(op), false);
+    }
+}
+
+void FileReader::read_blocking(ReadOp& op) {
+    std::ifstream in(op.path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        op.result.error = std::make_error_code(std::errc::no_such_file_or_directory);
+        return;
+    }
+
+    std::streamoff size = in.tellg();
+    if (size < 0) {
+        op.result.error = std::make_error_code(std::errc::io_error);
+        return;
+    }
+    op.result.file_size = static_cast<uint64_t>(size);
+    if (op.result.file_size > op.max_bytes) {
+        op.result.too_large = true;
+        return;
+    }
+
+    op.result.data.resize(static_cast<size_t>(size));
+    in.seekg(0);
+    if (!in.read(op.result.data.data(), size)) {
+        op.result.error = std::make_error_code(std::errc::io_error);
+        op.result.data.clear();
+        return;
+    }
+    op.result.validators = load_file_validators(op.path, op.result.file_size);
+}
+
+void FileReader::finish(std::unique_ptr<ReadOp> op, bool io_uring) {
+#if defined(HLS_HAVE_IO_URING)
+    if (op->fd >= 0) {
+        ::close(op->fd);
+        op->fd = -1;
+    }
+#endif
+    if (op->result.error && op->result.error != std::errc::no_such_file_or_directory) {
+        LOG_ERROR("Failed to read file: " << op->path << " " << op->result.error.message());
+    }
+
+    ReaderMetrics& metrics = reader_metrics();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - op->started).count();
+    (io_uring ? metrics.uring_reads : metrics.pool_reads).inc();
+    (io_uring ? metrics.uring_seconds : metrics.pool_seconds).observe(seconds);
+
+    op->callback(std::move(op->result));
+}
+
+#if defined(HLS_HAVE_IO_URING)
+bool FileReader::setup_ring(unsigned entries) {
+    io_uring_params params{};
+    int fd = io_uring_setup(std::max(8u, entries), &params);
+    if (fd < 0) {
+        LOG_WARN("io_uring unavailable (" << std::strerror(errno) << "), using thread pool reader");
+        return false;
+    }
+    ring_fd_ = fd;
+
+    // IORING_OP_READ与IORING_FEAT_RW_CUR_POS同在5.6内核引入，以此判断是否支持
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        LOG_WARN("io_uring lacks IORING_OP_READ, using thread pool reader");
+        teardown_ring();
+        return false;
+    }
+
+    sq_entries_ = params.sq_entries;
+    cq_entries_ = params.cq_entries;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        teardown_ring();
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    }
+    else {
+        cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            teardown_ring();
+            return false;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        teardown_ring();
+        return false;
+    }
+
+    sq_head_ = ring_field(sq_ring_, params.sq_off.head);
+    sq_tail_ = ring_field(sq_ring_, params.sq_off.tail);
+    sq_mask_ = ring_field(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = ring_field(sq_ring_, params.sq_off.array);
+    cq_head_ = ring_field(cq_ring_, params.cq_off.head);
+    cq_tail_ = ring_field(cq_ring_, params.cq_off.tail);
+    cq_mask_ = ring_field(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = static_cast<char*>(cq_ring_) + params.cq_off.cqes;
+
+    // 完成事件通过eventfd通知，eventfd挂到io_context上异步等待
+    event_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event_fd_ < 0 || io_uring_register(fd, IORING_REGISTER_EVENTFD, &event_fd_, 1) < 0) {
+        LOG_ERROR("Failed to register io_uring eventfd: " << std::strerror(errno));
+        teardown_ring();
+        return false;
+    }
+    event_descriptor_ = std::make_unique<boost::asio::posix::stream_descriptor>(io_context_, event_fd_);
+    return true;
+}
+
+void FileReader::teardown_ring() {
+    if (event_descriptor_) {
+        boost::system::error_code ignored;
+        event_descriptor_->cancel(ignored);
+    }
+
+    // 等待已提交的读取全部完成，缓冲区在此之前不能释放
+    while (ring_fd_ >= 0 && in_flight_ > 0) {
+        int ret = io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+        if (ret < 0 && errno != EINTR) {
+            LOG_ERROR("io_uring drain failed: " << std::strerror(errno));
+            break;
+        }
+        reap_completions();
+    }
+
+    // stream_descriptor析构时关闭event_fd_
+    if (event_descriptor_) {
+        event_descriptor_.reset();
+    }
+    else if (event_fd_ >= 0) {
+        ::close(event_fd_);
+    }
+    event_fd_ = -1;
+
+    if (sqes_) ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) ::munmap(sq_ring_, sq_ring_size_);
+    sqes_ = cq_ring_ = sq_ring_ = nullptr;
+    if (ring_fd_ >= 0) {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+}
+
+bool FileReader::submit_read(ReadOp* op) {
+    std::lock_guard<std::mutex> lock(submit_mutex_);
+    // 限制在途数量不超过CQ容量，避免完成事件溢出
+    if (in_flight_ >= cq_entries_) {
+        return false;
+    }
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail_;
+    if (tail - head >= sq_entries_) {
+        return false;
+    }
+
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    uint64_t remaining = op->result.file_size - op->done;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = op->fd;
+    sqe->off = op->done;
+    sqe->addr = reinterpret_cast<uint64_t>(op->result.data.data() + op->done);
+    sqe->len = static_cast<uint32_t>(std::min(remaining, MAX_READ_CHUNK));
+    sqe->user_data = reinterpret_cast<uint64_t>(op);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    in_flight_++;
+
+    int ret;
+    do {
+        ret = io_uring_enter(ring_fd_, 1, 0, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 1 && __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) != tail + 1) {
+        // 内核没有取走这个SQE：收回它并返回false由调用方改走线程池。留在队列里要等下一次提交才会发出，
+        // 没有后续读取时等待者永远不会完成，析构时的排空也会一直等它
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        in_flight_--;
+        LOG_ERROR("io_uring_enter failed: " << (ret < 0 ? std::strerror(errno) : "no SQE consumed"));
+        return false;
+    }
+    return true;
+}
+
+void FileReader::wait_completions() {
+    event_descriptor_->async_read_some(boost::asio::buffer(&event_value_, sizeof(event_value_)),
+        [this](const boost::system::error_code& error, std::size_t /*bytes_transferred*/) {
+            if (error) {
+                // 析构时取消等待
+                return;
+            }
+            reap_completions();
+            wait_completions();
+        });
+}
+
+void FileReader::reap_completions() {
+    unsigned head = *cq_head_;
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(cqes_) + (head & *cq_mask_);
+        auto* op = reinterpret_cast<ReadOp*>(cqe->user_data);
+        int res = cqe->res;
+        // 先归还CQE槽位再处理，处理中可能继续提交
+        __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+        in_flight_--;
+        complete_read(op, res);
+    }
+}
+
+void FileReader::complete_read(ReadOp* op, int res) {
+    std::unique_ptr<ReadOp> owned(op);
+
+    if (res == -EINTR || res == -EAGAIN) {
+        if (submit_read(op)) {
+            owned.release();
+            return;
+        }
+        fall_back(std::move(owned));
+        return;
+    }
+
+    if (res < 0) {
+        owned->result.error = std::error_code(-res, std::generic_category());
+        owned->result.data.clear();
+    }
+    else if (res == 0) {
+        // 读取期间文件被截断
+        owned->result.error = std::make_error_code(std::errc::io_error);
+        owned->result.data.clear();
+    }
+    else {
+        owned->done += static_cast<uint64_t>(res);
+        if (owned->done < owned->result.file_size) {
+            // 短读：继续提交剩余部分
+            if (submit_read(op)) {
+                owned.release();
+                return;
+            }
+            fall_back(std::move(owned));
+            return;
+        }
+    }
+    finish(std::move(owned), true);
+}
+#endif
+
+#if defined(HLS_HAVE_IO_URING)
+void FileReader::fall_back(std::unique_ptr<ReadOp> op) {
+    // 提交队列已满：关闭文件，交给线程池从头重读
+    ::close(op->fd);
+    op->fd = -1;
+    op->done = 0;
+    op->result = FileReadResult{};
+    enqueue_blocking(std::move(op));
+}
+#endif
@@ -0,0 +1,103 @@
+#pragma once
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include "http_utils.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <system_error>
+#include <boost/asio.hpp>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HLS_HAVE_IO_URING 1
+#endif
+
+// 一次整文件读取的结果
+struct FileReadResult {
+    std::string data;
+    uint64_t file_size = 0;
+    FileValidators validators;
+    std::error_code error;
+    bool too_large = false;   // 文件超过max_bytes，未读取内容
+};
+
+// 异步整文件读取，避免冷数据的磁盘读阻塞io_context线程
+// Linux上优先使用io_uring，完成事件经eventfd接入Asio事件循环；
+// io_uring不可用（内核过旧、被禁用或提交队列已满）时回退到专用线程池的阻塞读
+class FileReader {
+public:
+    using Callback = std::function<void(FileReadResult result)>;
+
+    FileReader(boost::asio::io_context& io_context, bool use_io_uring, int pool_threads, unsigned ring_entries);
+    ~FileReader();
+
+    // 回调在io_context线程（io_uring）或读线程（线程池）上执行
+    void read(const std::string& path, uint64_t max_bytes, Callback callback);
+    const char* backend_name() const;
+
+private:
+    struct ReadOp {
+        int fd = -1;
+        std::string path;
+        uint64_t max_bytes = 0;
+        uint64_t done = 0;
+        FileReadResult result;
+        Callback callback;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    void enqueue_blocking(std::unique_ptr<ReadOp> op);
+    static void read_blocking(ReadOp& op);
+    void finish(std::unique_ptr<ReadOp> op, bool io_uring);
+    void pool_worker();
+
+    boost::asio::io_context& io_context_;
+    std::vector<std::thread> pool_threads_;
+    std::deque<std::unique_ptr<ReadOp>> pool_queue_;
+    std::mutex pool_mutex_;
+    std::condition_variable pool_cv_;
+    bool pool_stopping_ = false;
+
+#if defined(HLS_HAVE_IO_URING)
+    bool setup_ring(unsigned entries);
+    void teardown_ring();
+    bool submit_read(ReadOp* op);
+    void wait_completions();
+    void reap_completions();
+    void complete_read(ReadOp* op, int res);
+    void fall_back(std::unique_ptr<ReadOp> op);
+
+    int ring_fd_ = -1;
+    int event_fd_ = -1;
+    unsigned sq_entries_ = 0;
+    unsigned cq_entries_ = 0;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    void* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    void* cqes_ = nullptr;
+    std::mutex submit_mutex_;
+    std::atomic<unsigned> in_flight_{ 0 };
+    uint64_t event_value_ = 0;
+    std::unique_ptr<boost::asio::posix::stream_descriptor> event_descriptor_;
+#endif
+};
+
+#endif // FILE_READER_H
@@ -1,7 +1,19 @@
 #include "hls_generator.h"
 #include"ffmpeg_utils.h"
 #include"utils.h"
-#include<iostream>
+#include"metrics.h"
+#include"logger.h"
+#include"bounded_queue.h"
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<condition_variable>
+#include<functional>
+#include<limits>
+#include<mutex>
+#include<thread>
 #include<direct.h>
 extern"C" {
 #include<libavcodec/avcodec.h>
@@ -13,7 +25,153 @@ extern"C" {
 #include<libavutil/pixdesc.h>
 }
 
+namespace {
+    struct GeneratorMetrics {
+        Metrics& registry = Metrics::instance();
+        Metrics::Counter& video_packets = registry.counter("hls_generator_packets_total",
+            "Demuxed input packets", "stream=\"video\"");
+        Metrics::Counter& audio_packets = registry.counter("hls_generator_packets_total",
+            "Demuxed input packets", "stream=\"audio\"");
+        Metrics::Counter& video_frames = registry.counter("hls_generator_transcoded_frames_total",
+            "Frames sent to the output encoder", "stream=\"video\"");
+        Metrics::Counter& audio_frames = registry.counter("hls_generator_transcoded_frames_total",
+            "Frames sent to the output encoder", "stream=\"audio\"");
+        Metrics::Counter& segments = registry.counter("hls_generator_segments_total",
+            "Media segments finished by the muxers, all renditions included");
+        Metrics::Gauge& fps = registry.gauge("hls_generator_video_fps",
+            "Video frames processed per second over the last interval");
+    };
+
+    GeneratorMetrics& generator_metrics() {
+        static GeneratorMetrics metrics;
+        return metrics;
+    }
+
+    // 每秒根据计数器的增量更新一次fps
+    class FpsWindow {
+    public:
+        explicit FpsWindow(Metrics::Counter& source)
+            : source_(source), frames_(source.value()), start_(std::chrono::steady_clock::now()) {}
+        void update(bool force = false) {
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - start_).count();
+            if (elapsed >= 1.0 || (force && elapsed > 0)) {
+                uint64_t frames = source_.value();
+                generator_metrics().fps.set((frames - frames_) / elapsed);
+                start_ = now;
+                frames_ = frames;
+            }
+        }
+    private:
+        Metrics::Counter& source_;
+        uint64_t frames_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // 流水线阶段的利用率：阻塞在队列上的时间算空闲，其余算工作；每秒更新一次指标，结束时打印总体利用率
+    class StageMeter {
+    public:
+        explicit StageMeter(const char* stage)
+            : stage_(stage)
+            , gauge_(Metrics::instance().gauge("hls_generator_stage_utilization",
+                "Fraction of time a transcode pipeline stage spent working instead of waiting on its queues",
+                std::string("stage=\"") + stage + "\""))
+            , started_(std::chrono::steady_clock::now())
+            , window_start_(started_) {}
+
+        // 执行一次可能阻塞的队列操作并计入等待时间
+        template <typename F>
+        bool wait(F&& operation) {
+            auto before = std::chrono::steady_clock::now();
+            bool result = operation();
+            auto after = std::chrono::steady_clock::now();
+            waited_ += after - before;
+            window_waited_ += after - before;
+            if (after - window_start_ >= std::chrono::seconds(1)) {
+                gauge_.set(utilization(after - window_start_, window_waited_));
+                window_start_ = after;
+                window_waited_ = {};
+            }
+            return result;
+        }
+
+        void finish() {
+            double total = utilization(std::chrono::steady_clock::now() - started_, waited_);
+            gauge_.set(0);
+            LOG_INFO("转码流水线阶段 " << stage_ << " 利用率 " << static_cast<int>(total * 100 + 0.5) << "%");
+        }
+
+    private:
+        static double utilization(std::chrono::steady_clock::duration elapsed, std::chrono::steady_clock::duration waited) {
+            if (elapsed.count() <= 0) return 0;
+            return std::clamp(1.0 - std::chrono::duration<double>(waited) / std::chrono::duration<double>(elapsed), 0.0, 1.0);
+        }
+
+        const char* stage_;
+        Metrics::Gauge& gauge_;
+        std::chrono::steady_clock::time_point started_;
+        std::chrono::steady_clock::time_point window_start_;
+        std::chrono::steady_clock::duration waited_{};
+        std::chrono::steady_clock::duration window_waited_{};
+    };
+
+    // 多码率阶梯中发给某一档线程的一项：解码帧的引用或一个音频包
+    struct RenditionItem {
+        Frame frame;
+        Packet packet;
+    };
+
+    // 按媒体播放列表中各切片的时长和文件大小计算峰值与平均码率（bit/s）
+    bool measure_playlist_bandwidth(const std::string& m3u8_path, int64_t& peak, int64_t& average) {
+        std::ifstream m3u8_file(m3u8_path);
+        if (!m3u8_file.is_open()) {
+            return false;
+        }
+        std::filesystem::path dir = std::filesystem::path(m3u8_path).parent_path();
+        double duration = 0;
+        double total_seconds = 0;
+        double total_bits = 0;
+        double peak_bps = 0;
+        std::string line;
+        while (std::getline(m3u8_file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.rfind("#EXTINF:", 0) == 0) {
+                duration = std::atof(line.c_str() + 8);
+                continue;
+            }
+            if (line.empty() || line[0] == '#' || duration <= 0) continue;
+            std::error_code ec;
+            auto size = std::filesystem::file_size(dir / line, ec);
+            if (!ec) {
+                double bits = static_cast<double>(size) * 8;
+                peak_bps = std::max(peak_bps, bits / duration);
+                total_bits += bits;
+                total_seconds += duration;
+            }
+            duration = 0;
+        }
+        if (total_seconds <= 0) {
+            return false;
+        }
+        peak = static_cast<int64_t>(peak_bps + 0.5);
+        average = static_cast<int64_t>(total_bits / total_seconds + 0.5);
+        return true;
+    }
+}
+
 HLSGenerator::~HLSGenerator() {
+	stop();
+	if (worker_.joinable()) {
+		worker_.join();
+	}
+	for (size_t i = 1; i < renditions_.size(); ++i) {
+		AVFormatContext* output = renditions_[i].output;
+		if (!output) continue;
+		if (!(output->oformat->flags & AVFMT_NOFILE)) {
+			avio_closep(&output->pb);
+		}
+		avformat_free_context(output);
+	}
 	if (output_ctx_) {
 		if (!(output_ctx_->oformat->flags & AVFMT_NOFILE)) {
 			avio_closep(&output_ctx_->pb);
@@ -24,98 +182,297 @@ HLSGenerator::~HLSGenerator() {
 		avformat_close_input(&input_ctx_);
 	}
 }
+std::string HLSGenerator::manifest_path() const {
+    return config_.HLS_DIR+"/"+config_.M3U8_FILENAME+".manifest";
+}
+
 bool HLSGenerator::should_reconvert() {
     std::string m3u8_path=config_.HLS_DIR+"/"+config_.M3U8_FILENAME;
+    // 按内容与参数判断，而不是修改时间：touch输入不会触发重转，改码率或转码格式集合会
+    identity_=compute_transcode_identity(config_,config_.HLS_MANIFEST_FULL_HASH);
     if(config_.FORCE_RECONVERT){
-        std::cout<<"强制重新转化格式"<<std::endl;
+        LOG_INFO("强制重新转化格式");
         return true;
     }
 
-    if(!std::filesystem::exists(m3u8_path)){
-        std::cout<<"HLS文件不存在，重新转化格式"<<std::endl;
-        return true;
-    }
-    auto input_time=std::filesystem::last_write_time(config_.VIDEO_PATH);
-    auto output_time=std::filesystem::last_write_time(m3u8_path);
-    if(input_time>output_time){
-        std::cout<<"输入文件更新，重新转化格式"<<std::endl;
+    if(!manifest_matches(manifest_path(),identity_,m3u8_path)){
+        LOG_INFO("没有与当前输入内容和转码参数一致的转码清单，重新转化格式");
         return true;
     }
     if(config_.CHECK_HLS_INTEGRITY&&!check_hls_integrity()){
-        std::cout<<"HLS文件损坏，重新转化格式"<<std::endl;
+        LOG_INFO("HLS文件损坏，重新转化格式");
         return true;
     }
-    std::cout<<"HLS文件未更新，不重新转化格式"<<std::endl;
+    LOG_INFO("命中转码清单（"<<identity_.to_string()<<"），不重新转化格式");
     return false;
 }
 bool HLSGenerator::check_hls_integrity() {
     std::string m3u8_path=config_.HLS_DIR+"/"+config_.M3U8_FILENAME;
     try{
-        std::ifstream m3u8_file(m3u8_path);
-        if(!m3u8_file.is_open()){
-            std::cerr<<"无法打开m3u8文件"<<m3u8_path<<std::endl;
+        if(!check_playlist_integrity(m3u8_path)){
             return false;
         }
-        std::string line;
-        int segment_count=0;
-        while(std::getline(m3u8_file,line)){
-            if(line.empty()||line[0]=='#')continue;
-            std::string ts_path=config_.HLS_DIR+"/"+line;
-            if(!std::filesystem::exists(ts_path)){
-                std::cerr<<"无法找到TS文件"<<ts_path<<std::endl;
-                return false;
-            }
-            auto file_size=std::filesystem::file_size(ts_path);
-            if(file_size<1024){
-                std::cerr<<"TS文件大小异常"<<ts_path<<std::endl;
+        LOG_INFO("HLS文件完整，无需重新转化格式");
+        return true;
+    }catch(std::exception& e){
+        LOG_ERROR("检查HLS文件完整性失败:"<<e.what());
+        return false;
+    }
+}
+
+bool HLSGenerator::check_playlist_integrity(const std::string& m3u8_path) {
+    std::ifstream m3u8_file(m3u8_path);
+    if(!m3u8_file.is_open()){
+        LOG_ERROR("无法打开m3u8文件"<<m3u8_path);
+        return false;
+    }
+    // 切片与子播放列表的路径相对于当前播放列表所在目录
+    std::string dir=std::filesystem::path(m3u8_path).parent_path().string();
+    std::string line;
+    int segment_count=0;
+    int variant_count=0;
+    bool ended=false;
+    while(std::getline(m3u8_file,line)){
+        if(!line.empty()&&line.back()=='\r')line.pop_back();
+        if(line.rfind("#EXT-X-ENDLIST",0)==0)ended=true;
+        if(line.empty()||line[0]=='#')continue;
+        if(line.ends_with(".m3u8")){
+            // 主播放列表中的一档，逐档检查
+            if(!check_playlist_integrity(dir+"/"+line)){
                 return false;
             }
-            segment_count++;
+            variant_count++;
+            continue;
         }
-        if(segment_count==0){
-            std::cerr<<"HLS文件中没有有效的TS片段"<<std::endl;
+        std::string ts_path=dir+"/"+line;
+        if(!std::filesystem::exists(ts_path)){
+            LOG_ERROR("无法找到TS文件"<<ts_path);
             return false;
         }
-        std::cout<<"HLS文件完整，无需重新转化格式"<<std::endl;
+        auto file_size=std::filesystem::file_size(ts_path);
+        if(file_size<1024){
+            LOG_ERROR("TS文件大小异常"<<ts_path);
+            return false;
+        }
+        segment_count++;
+    }
+    if(variant_count>0){
         return true;
-    }catch(std::exception& e){
-        std::cerr<<"检查HLS文件完整性失败:"<<e.what()<<std::endl;
+    }
+    if(segment_count==0){
+        LOG_ERROR("HLS文件中没有有效的TS片段"<<m3u8_path);
+        return false;
+    }
+    if(!ended){
+        // 后台生成被中断时EVENT播放列表没有结束标记
+        LOG_ERROR("播放列表缺少EXT-X-ENDLIST，上次转换未完成"<<m3u8_path);
         return false;
     }
+    return true;
 }
 
 
+bool HLSGenerator::checkpoint_enabled() const {
+    // 低延迟HLS的播放列表由LLHLSPlaylist生成，多码率阶梯每档各有播放列表，都不记检查点
+    return config_.HLS_CHECKPOINT && !config_.LL_HLS_ENABLED && !ladder_enabled();
+}
+
+std::string HLSGenerator::repair_dir() const {
+    return config_.HLS_DIR + "/.repair/" + std::to_string(first_segment_);
+}
+
+bool HLSGenerator::plan_from_checkpoint() {
+    std::string m3u8_path=config_.HLS_DIR+"/"+config_.M3U8_FILENAME;
+    journal_ = std::make_unique<CheckpointJournal>(m3u8_path + ".journal", identity_.to_string());
+    if (config_.FORCE_RECONVERT || !journal_->load() || journal_->segments().empty()) {
+        journal_->reset();
+        return true;
+    }
+
+    const auto& segments = journal_->segments();
+    std::vector<size_t> damaged;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (!journal_->verify(config_.HLS_DIR, segments[i])) {
+            damaged.push_back(i);
+        }
+    }
+
+    if (journal_->complete()) {
+        // 上次转换已完成：只重新转码损坏的切片，其余切片与播放列表的时间轴不变
+        try {
+            for (size_t index : damaged) {
+                LOG_INFO("重新生成损坏的切片 " << segments[index].filename << "（" << segments[index].start << "秒起，"
+                    << segments[index].duration << "秒）");
+                HLSGenerator repairer(config_);
+                repairer.set_output_listener(output_listener_);
+                repairer.render_segment(segments[index], index);
+                journal_->refresh(index, config_.HLS_DIR);
+            }
+        }
+        catch (const std::exception& e) {
+            LOG_ERROR("修复切片失败，重新转换全部内容: " << e.what());
+            journal_->reset();
+            return true;
+        }
+        journal_->write_playlist(m3u8_path, segments.size(), true, config_.HLS_SERVE_WHILE_GENERATING);
+        return false;
+    }
+
+    // 上次转换被中断：保留开头连续完好的切片，从最后一个完好切片的结尾续转
+    size_t good = damaged.empty() ? segments.size() : damaged.front();
+    if (good == 0) {
+        journal_->reset();
+        return true;
+    }
+    journal_->truncate(good);
+    journal_->write_playlist(m3u8_path, good, false, config_.HLS_SERVE_WHILE_GENERATING);
+    const SegmentCheckpoint& last = journal_->segments().back();
+    checkpoint_start_ = last.start + last.duration;
+    first_segment_ = good;
+    LOG_INFO("从检查点续转：保留前" << good << "个切片，从" << checkpoint_start_ << "秒处继续");
+    return true;
+}
+
+void HLSGenerator::render_segment(const SegmentCheckpoint& segment, size_t index) {
+    repairing_ = true;
+    checkpoint_start_ = segment.start;
+    checkpoint_end_ = segment.start + segment.duration;
+    first_segment_ = index;
+    init_input();
+    init_output();
+    seek_to_checkpoint();
+
+    // FFmpeg出错时抛出异常，包随栈展开归还
+    Packet pkt = packet_pool_.acquire();
+    while (!stop_requested_ && read_input_packet(pkt)) {
+        process_packet(pkt);
+        av_packet_unref(pkt);
+    }
+    Packet flush_pkt = packet_pool_.acquire();
+    process_packet(flush_pkt);
+    write_output_trailer(output_ctx_);
+
+    std::string repaired = repair_dir() + "/" + segment.filename;
+    if (stop_requested_ || !std::filesystem::exists(repaired)) {
+        throw std::runtime_error("Failed to regenerate segment " + segment.filename);
+    }
+    std::filesystem::rename(repaired, config_.HLS_DIR + "/" + segment.filename);
+    notify_output(config_.HLS_DIR + "/" + segment.filename);
+    std::error_code ec;
+    std::filesystem::remove_all(repair_dir(), ec);
+}
+
+void HLSGenerator::seek_to_checkpoint() {
+    if (checkpoint_start_ < 0) {
+        return;
+    }
+    AVStream* stream = input_ctx_->streams[video_stream_idx_];
+    int64_t origin = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    auto to_pts = [&](double seconds) {
+        return origin + static_cast<int64_t>(std::llround(seconds / av_q2d(stream->time_base)));
+    };
+    // 日志里的时间保留6位小数，累加后与真实时间戳差几个微秒；范围两端放宽半帧
+    AVRational fps = stream->avg_frame_rate.num > 0 ? stream->avg_frame_rate : av_make_q(30, 1);
+    int64_t slack = std::max<int64_t>(1, av_rescale_q(1, av_inv_q(fps), stream->time_base) / 2);
+    int64_t start = to_pts(checkpoint_start_);
+    range_start_ = start - slack;
+    if (checkpoint_end_ >= 0) {
+        range_end_ = to_pts(checkpoint_end_) - slack;
+    }
+
+    // 日志只记录muxer在关键帧处切开的切片（停止时被截断的切片不记录），接续点总是下一个切片的关键帧：
+    // 直接复制时会正好落在这个关键帧上；转码时从之前最近的关键帧解码，接续点之前的帧解码后丢弃
+    int ret = av_seek_frame(input_ctx_, video_stream_idx_, start + slack, AVSEEK_FLAG_BACKWARD);
+    check_ffmpeg_error(ret, "Failed to seek input to checkpoint");
+    if (video_decoder_ctx_) {
+        avcodec_flush_buffers(video_decoder_ctx_->get());
+    }
+    if (audio_decoder_ctx_) {
+        avcodec_flush_buffers(audio_decoder_ctx_->get());
+    }
+}
+
+bool HLSGenerator::outside_range(int64_t ts, AVRational time_base) const {
+    if (ts == AV_NOPTS_VALUE || range_start_ == AV_NOPTS_VALUE) {
+        return false;
+    }
+    int64_t video_ts = av_rescale_q(ts, time_base, input_ctx_->streams[video_stream_idx_]->time_base);
+    return video_ts < range_start_ || (range_end_ != AV_NOPTS_VALUE && video_ts >= range_end_);
+}
+
+void HLSGenerator::report_progress(int64_t ts, AVRational time_base) {
+    if (ts == AV_NOPTS_VALUE || input_ctx_->duration <= 0) {
+        return;
+    }
+    int64_t start = input_ctx_->start_time != AV_NOPTS_VALUE ? input_ctx_->start_time : 0;
+    int64_t done = av_rescale_q(ts, time_base, av_make_q(1, AV_TIME_BASE)) - start;
+    progress_.store(std::clamp(static_cast<double>(done) / input_ctx_->duration, 0.0, 1.0), std::memory_order_relaxed);
+}
+
+bool HLSGenerator::read_input_packet(AVPacket* pkt) {
+    while (av_read_frame(input_ctx_, pkt) >= 0) {
+        if (pkt->stream_index == video_stream_idx_) {
+            report_progress(pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts, input_ctx_->streams[video_stream_idx_]->time_base);
+        }
+        if (range_start_ == AV_NOPTS_VALUE) {
+            return true;
+        }
+        int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        if (pkt->stream_index == video_stream_idx_) {
+            if (range_end_ != AV_NOPTS_VALUE && (pkt->flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE && ts >= range_end_) {
+                // 下一个切片起点的关键帧，修复范围到此为止
+                av_packet_unref(pkt);
+                return false;
+            }
+            // 转码时解码器需要关键帧之后的每个包，范围之外的帧解码后再丢弃
+            if (need_video_transcode_ || !outside_range(ts, input_ctx_->streams[video_stream_idx_]->time_base)) {
+                return true;
+            }
+        }
+        else if (pkt->stream_index == audio_stream_idx_) {
+            if (!outside_range(ts, input_ctx_->streams[audio_stream_idx_]->time_base)) {
+                return true;
+            }
+        }
+        else {
+            return true;
+        }
+        av_packet_unref(pkt);
+    }
+    return false;
+}
+
 bool HLSGenerator::needs_transcoding(const AVCodecParameters* codecpar,bool is_video) {
     if(!codecpar)
     return false;
     if(is_video){
         if(codecpar->codec_id==AV_CODEC_ID_H264){
             if(codecpar->format==AV_PIX_FMT_YUV420P){
-                std::cout<<"视频流兼容，无需转码"<<std::endl;
+                LOG_INFO("视频流兼容，无需转码");
                 return false;
             }
-            std::cout<<"视频流为H264但像素格式不兼容"<<std::endl;
+            LOG_INFO("视频流为H264但像素格式不兼容");
             return true;
         }
 
         if(config_.TRANSCODE_VIDEO_CODECS.find(codecpar->codec_id)!=config_.TRANSCODE_VIDEO_CODECS.end()){
             const char* codec_name=avcodec_get_name(codecpar->codec_id);
-            std::cout<<"视频流为"<<codec_name<<"格式，需要转码"<<std::endl;
+            LOG_INFO("视频流为"<<codec_name<<"格式，需要转码");
             return true;
         }   
-        std::cout<<"视频编码格式未知"<<std::endl;
+        LOG_INFO("视频编码格式未知");
         return true;
     }else{
         if(codecpar->codec_id==AV_CODEC_ID_AAC){
-            std::cout<<"音频流为AAC格式，无需转码"<<std::endl;
+            LOG_INFO("音频流为AAC格式，无需转码");
             return false;
         }
         if(config_.TRANSCODE_AUDIO_CODECS.find(codecpar->codec_id)!=config_.TRANSCODE_AUDIO_CODECS.end()){
             const char* codec_name=avcodec_get_name(codecpar->codec_id);
-            std::cout<<"音频流为"<<codec_name<<"格式，需要转码"<<std::endl;
+            LOG_INFO("音频流为"<<codec_name<<"格式，需要转码");
             return true;
         }
-        std::cout<<"音频编码格式未知"<<std::endl;
+        LOG_INFO("音频编码格式未知");
         return true;
     }
 }
@@ -134,7 +491,7 @@ void HLSGenerator::setup_direct_stream_copy(int stream_idx){
     check_ffmpeg_error(ret, "Failed to copy codec parameters");
 
     out_stream->time_base=in_stream->time_base;
-    std::cout<<"设置直接流复制：流索引"<<stream_idx<<std::endl;
+    LOG_INFO("设置直接流复制：流索引"<<stream_idx);
 }
 
 
@@ -150,11 +507,11 @@ void HLSGenerator::init_input() {
 		auto* stream = input_ctx_->streams[i];
 		if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video_stream_idx_ == -1) {
 			video_stream_idx_ = i;
-			std::cout << "Find video stream:" << video_stream_idx_ << std::endl;
+			LOG_INFO("Find video stream:" << video_stream_idx_);
 		}
 		else if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && audio_stream_idx_ == -1) {
 			audio_stream_idx_ = i;
-		std::cout << "Find audio stream:" << audio_stream_idx_ << std::endl;
+		LOG_INFO("Find audio stream:" << audio_stream_idx_);
 		}
 		av_dump_format(input_ctx_, i, config_.VIDEO_PATH.c_str(), 0);
 	}
@@ -165,19 +522,15 @@ void HLSGenerator::init_input() {
 
     //检查是否需要转码
     auto* video_stream=input_ctx_->streams[video_stream_idx_];
-    need_video_transcode_=needs_transcoding(video_stream->codecpar,true);
+    // 多码率阶梯的每一档都要重新编码
+    need_video_transcode_=needs_transcoding(video_stream->codecpar,true)||ladder_enabled();
     
     if(need_video_transcode_){
-
-        const AVCodec* video_decoder = avcodec_find_decoder(video_stream->codecpar->codec_id);
-        check_ffmpeg_error(video_decoder?0:-1,"Failed to find video decoder");
-        video_decoder_ctx_ = std::make_unique<CodecContext>(video_decoder);
-
-        ret=avcodec_parameters_to_context(video_decoder_ctx_->get(),video_stream->codecpar);
-        check_ffmpeg_error(ret,"Failed to copy video decoder parameters");
-
-        ret=avcodec_open2(video_decoder_ctx_->get(),video_decoder,nullptr);
-        check_ffmpeg_error(ret,"Failed to open video decoder");
+        // 并行分段或多码率时每个工作线程各有一套缩放/编码，核心数按线程数均分
+        int concurrent = ladder_enabled() ? static_cast<int>(config_.HLS_ABR_LADDER.size()) : parallel_workers();
+        threading_ = tune_codec_threading(config_, video_stream->codecpar->width, video_stream->codecpar->height,
+            concurrent);
+        video_decoder_ctx_ = open_video_decoder(video_stream);
     }
 
 	if (audio_stream_idx_ != -1) {
@@ -201,15 +554,60 @@ void HLSGenerator::init_input() {
 void HLSGenerator::init_output() {
 
 	std::string output_path = config_.HLS_DIR + "/" + config_.M3U8_FILENAME;
+	if (config_.LL_HLS_ENABLED) {
+		// muxer只负责切出partial segment，对外的播放列表由LLHLSPlaylist生成
+		output_path = config_.HLS_DIR + "/" + config_.LL_HLS_PART_PLAYLIST;
+	}
+	else if (ladder_enabled()) {
+		// 第0档的muxer沿用output_ctx_，主播放列表由write_master_playlist生成
+		plan_renditions(input_ctx_->streams[video_stream_idx_]);
+		output_path = rendition_playlist_path(renditions_[0]);
+	}
+	else if (repairing_) {
+		// 修复的切片先写到单独的目录，完整写完后再替换原文件
+		std::filesystem::create_directories(repair_dir());
+		output_path = repair_dir() + "/" + config_.M3U8_FILENAME;
+	}
 	int ret = avformat_alloc_output_context2(&output_ctx_, nullptr, "hls", output_path.c_str());
 	check_ffmpeg_error(ret, "Failed to create HLS output context");
+	install_io_hooks(output_ctx_);
 
 	//设置HLS参数
 	AVDictionary* options = nullptr;
-	av_dict_set(&options, "hls_time", std::to_string(config_.HLS_SEGMENT_DURATION).c_str(), 0);
-	av_dict_set(&options, "hls_list_size", "0", 0);
-	if (config_.CLEAN_OLD_SEGMENTS) {
-		av_dict_set(&options, "hls_flags", "delete_segments", 0);
+	if (config_.LL_HLS_ENABLED) {
+		// 内部列表只需保留最近几项；part文件由LLHLSPlaylist管理，不能让muxer删除
+		std::string part_pattern = config_.HLS_DIR + "/" + config_.LL_HLS_PART_PREFIX + "%d.ts";
+		av_dict_set(&options, "hls_time", std::to_string(config_.LL_HLS_PART_DURATION).c_str(), 0);
+		av_dict_set(&options, "hls_list_size", "6", 0);
+		av_dict_set(&options, "hls_segment_filename", part_pattern.c_str(), 0);
+		ll_playlist_ = std::make_unique<LLHLSPlaylist>(config_);
+		if (!config_.HLS_ABR_LADDER.empty()) {
+			LOG_WARN("低延迟HLS不支持多码率阶梯，只输出源分辨率一路");
+		}
+	}
+	else if (repairing_) {
+		// 切片时长放宽到超过整个范围，保证只切出一个文件，编号与原切片相同
+		int hls_time = static_cast<int>(std::ceil(checkpoint_end_ - checkpoint_start_)) + 1;
+		av_dict_set(&options, "hls_time", std::to_string(hls_time).c_str(), 0);
+		av_dict_set(&options, "hls_list_size", "0", 0);
+		av_dict_set(&options, "start_number", std::to_string(first_segment_).c_str(), 0);
+	}
+	else {
+		av_dict_set(&options, "hls_time", std::to_string(config_.HLS_SEGMENT_DURATION).c_str(), 0);
+		av_dict_set(&options, "hls_list_size", "0", 0);
+		if (config_.HLS_SERVE_WHILE_GENERATING) {
+			// EVENT播放列表只追加不删除，播放器可以边转码边从头观看
+			av_dict_set(&options, "hls_playlist_type", "event", 0);
+		}
+		std::string flags = config_.CLEAN_OLD_SEGMENTS ? "delete_segments" : "";
+		if (first_segment_ > 0) {
+			// 续转：muxer读入按检查点重写的播放列表，在其后追加，接续处标记EXT-X-DISCONTINUITY
+			flags += flags.empty() ? "append_list+discont_start" : "+append_list+discont_start";
+			av_dict_set(&options, "start_number", std::to_string(first_segment_).c_str(), 0);
+		}
+		if (!flags.empty()) {
+			av_dict_set(&options, "hls_flags", flags.c_str(), 0);
+		}
 	}
 
 	//初始化视频流
@@ -218,38 +616,18 @@ void HLSGenerator::init_output() {
     if(!need_video_transcode_){
         setup_direct_stream_copy(video_stream_idx_);
         output_video_stream_idx_=output_ctx_->nb_streams-1;
-        std::cout<<"视频流设置为直接复制模式"<<std::endl;
+        LOG_INFO("视频流设置为直接复制模式");
+    }else if(ladder_enabled()){
+        renditions_[0].output = output_ctx_;
+        open_rendition(renditions_[0], in_video_stream);
+        output_video_stream_idx_ = renditions_[0].video_index;
     }else{
         auto* out_video_stream = avformat_new_stream(output_ctx_, nullptr);
         check_ffmpeg_error(out_video_stream ? 0 : -1, "Failed to create output video stream");
         output_video_stream_idx_ = out_video_stream->index;
 
-        const AVCodec* video_codec = avcodec_find_encoder_by_name("libopenh264");
-        check_ffmpeg_error(video_codec ? 0 : -1, "Failed to find openh264 encoder");
-        video_codec_ctx_ = std::make_unique<CodecContext>(video_codec);
-
+        video_codec_ctx_ = open_video_encoder(in_video_stream);
         auto* vctx = video_codec_ctx_->get();
-        vctx->bit_rate = config_.VIDEO_BITRATE;
-        vctx->width = in_video_stream->codecpar->width;
-        vctx->height = in_video_stream->codecpar->height;
-        vctx->time_base = in_video_stream->time_base;
-        vctx->framerate = av_inv_q(in_video_stream->time_base);
-        vctx->gop_size = 30;
-        vctx->max_b_frames = 0;
-        vctx->pix_fmt = AV_PIX_FMT_YUV420P;
-        vctx->profile = AV_PROFILE_H264_MAIN;
-        vctx->level = 30;
-
-
-        av_opt_set(vctx->priv_data, "preset", "ultrafast",0);
-        av_opt_set(vctx->priv_data, "tune", "zerolatency", 0);
-
-        AVDictionary* encoder_opts = nullptr;
-        av_dict_set(&encoder_opts, "bEnableFrameSkip", "1", 0);
-        
-        ret = avcodec_open2(vctx, video_codec, &encoder_opts);
-        check_ffmpeg_error(ret, "Failed to open video encoder");
-        av_dict_free(&encoder_opts);
 
         ret = avcodec_parameters_from_context(out_video_stream->codecpar, vctx);
         check_ffmpeg_error(ret, "Failed to copy video parameters");
@@ -259,8 +637,9 @@ void HLSGenerator::init_output() {
         sws_ctx_ = std::make_unique<FFmpegSwsContext>(
             vctx->width, vctx->height, (AVPixelFormat)in_video_stream->codecpar->format,
             vctx->width, vctx->height, vctx->pix_fmt,
-            SWS_BILINEAR
+            SWS_BILINEAR, threading_.scale_threads
         );
+        scaled_pool_ = std::make_unique<FramePool>(vctx->width, vctx->height, vctx->pix_fmt, 64);
     }
 	// 初始化音频流（如果存在）
 	if (audio_stream_idx_ != -1) {
@@ -269,7 +648,7 @@ void HLSGenerator::init_output() {
         if(!need_audio_transcode_){
             setup_direct_stream_copy(audio_stream_idx_);
             output_audio_stream_idx_=output_ctx_->nb_streams-1;
-            std::cout<<"音频流设置为直接复制模式"<<std::endl;
+            LOG_INFO("音频流设置为直接复制模式");
         }else{
 
             auto* out_audio_stream = avformat_new_stream(output_ctx_, nullptr);
@@ -304,6 +683,11 @@ void HLSGenerator::init_output() {
         }
     }
 
+	// 其余各档在第0档的音视频流都建好之后创建，音频流参数与第0档相同
+	for (size_t i = 1; i < renditions_.size(); ++i) {
+		open_rendition_output(renditions_[i], in_video_stream, options);
+	}
+
 	// 打开输出文件
 	if (!(output_ctx_->oformat->flags & AVFMT_NOFILE)) {
 		ret = avio_open2(&output_ctx_->pb, output_path.c_str(), AVIO_FLAG_WRITE, nullptr, nullptr);
@@ -315,111 +699,880 @@ void HLSGenerator::init_output() {
 	check_ffmpeg_error(ret, "Failed to write HLS header");
 	av_dict_free(&options);
 	av_dump_format(output_ctx_, 0, output_path.c_str(), 1);
+	if (!renditions_.empty()) {
+		write_master_playlist(false);
+	}
+}
+
+
+std::unique_ptr<CodecContext> HLSGenerator::open_video_decoder(const AVStream* stream) {
+    const AVCodec* video_decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+    check_ffmpeg_error(video_decoder?0:-1,"Failed to find video decoder");
+    auto decoder = std::make_unique<CodecContext>(video_decoder);
+
+    int ret=avcodec_parameters_to_context(decoder->get(),stream->codecpar);
+    check_ffmpeg_error(ret,"Failed to copy video decoder parameters");
+    apply_decoder_threading(decoder->get(), threading_);
+
+    ret=avcodec_open2(decoder->get(),video_decoder,nullptr);
+    check_ffmpeg_error(ret,"Failed to open video decoder");
+    return decoder;
+}
+
+std::unique_ptr<CodecContext> HLSGenerator::open_video_encoder(const AVStream* in_video_stream, int width, int height, int bitrate) {
+    const AVCodec* video_codec = avcodec_find_encoder_by_name("libopenh264");
+    check_ffmpeg_error(video_codec ? 0 : -1, "Failed to find openh264 encoder");
+    auto encoder = std::make_unique<CodecContext>(video_codec);
+
+    auto* vctx = encoder->get();
+    vctx->bit_rate = bitrate > 0 ? bitrate : config_.VIDEO_BITRATE;
+    vctx->width = width > 0 ? width : in_video_stream->codecpar->width;
+    vctx->height = height > 0 ? height : in_video_stream->codecpar->height;
+    vctx->time_base = in_video_stream->time_base;
+    vctx->framerate = av_inv_q(in_video_stream->time_base);
+    vctx->gop_size = 30;
+    if (config_.LL_HLS_ENABLED) {
+        // 每个partial segment都从关键帧开始，才能标记为INDEPENDENT
+        AVRational fps = in_video_stream->avg_frame_rate.num > 0 ? in_video_stream->avg_frame_rate : av_make_q(30, 1);
+        vctx->gop_size = std::max(1, static_cast<int>(av_q2d(fps) * config_.LL_HLS_PART_DURATION + 0.5));
+    }
+    else if (ladder_enabled()) {
+        // 阶梯各档只在run_ladder强制的帧上出关键帧：GOP不短于一个切片，编码器自己不插入关键帧
+        AVRational fps = in_video_stream->avg_frame_rate.num > 0 ? in_video_stream->avg_frame_rate : av_make_q(30, 1);
+        vctx->gop_size = std::max(vctx->gop_size,
+            static_cast<int>(std::ceil(av_q2d(fps) * config_.HLS_SEGMENT_DURATION)) + 1);
+    }
+    vctx->max_b_frames = 0;
+    vctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    vctx->profile = AV_PROFILE_H264_MAIN;
+    vctx->level = 30;
+    apply_encoder_threading(vctx, threading_);
+
+    av_opt_set(vctx->priv_data, "preset", "ultrafast",0);
+    av_opt_set(vctx->priv_data, "tune", "zerolatency", 0);
+
+    AVDictionary* encoder_opts = nullptr;
+    if (ladder_enabled()) {
+        // 码率控制跳帧在各档独立发生，可能跳过强制的关键帧，使低码率档与其他档在不同的帧处切片
+        av_dict_set(&encoder_opts, "allow_skip_frames", "0", 0);
+    }
+    else {
+        av_dict_set(&encoder_opts, "bEnableFrameSkip", "1", 0);
+    }
+
+    int ret = avcodec_open2(vctx, video_codec, &encoder_opts);
+    check_ffmpeg_error(ret, "Failed to open video encoder");
+    av_dict_free(&encoder_opts);
+    return encoder;
+}
+
+void HLSGenerator::install_io_hooks(AVFormatContext* ctx) {
+    ctx->opaque = this;
+    default_io_open_ = ctx->io_open;
+    default_io_close_ = ctx->io_close2;
+    ctx->io_open = &HLSGenerator::io_open_hook;
+    ctx->io_close2 = &HLSGenerator::io_close_hook;
 }
 
+int HLSGenerator::io_open_hook(AVFormatContext* s, AVIOContext** pb, const char* url, int flags, AVDictionary** options) {
+    // hls muxer内部的切片muxer会继承opaque与io回调；多码率时各档的muxer在各自线程上回调
+    auto* self = static_cast<HLSGenerator*>(s->opaque);
+    int ret = self->default_io_open_(s, pb, url, flags, options);
+    if (ret >= 0 && (flags & AVIO_FLAG_WRITE)) {
+        std::lock_guard<std::mutex> lock(self->outputs_mutex_);
+        self->open_outputs_[*pb] = url;
+    }
+    return ret;
+}
+
+int HLSGenerator::io_close_hook(AVFormatContext* s, AVIOContext* pb) {
+    auto* self = static_cast<HLSGenerator*>(s->opaque);
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(self->outputs_mutex_);
+        auto it = self->open_outputs_.find(pb);
+        if (it != self->open_outputs_.end()) {
+            url = it->second;
+            self->open_outputs_.erase(it);
+        }
+    }
+
+    int ret = self->default_io_close_ ? self->default_io_close_(s, pb) : avio_close(pb);
+    if (!url.empty()) {
+        // 文件已完整落盘
+        self->on_output_closed(s, url);
+    }
+    return ret;
+}
+
+void HLSGenerator::notify_output(const std::string& path) {
+    if (output_listener_) {
+        output_listener_(path);
+    }
+}
+
+void HLSGenerator::on_output_closed(AVFormatContext* s, const std::string& url) {
+    if (url.ends_with(".ts")) {
+        generator_metrics().segments.inc();
+        if (journal_) {
+            journal_->on_segment_closed(url);
+        }
+        // 续转会覆盖上次截断的同名切片；修复时写在.repair目录中，改名后再通知
+        if (!repairing_) {
+            notify_output(url);
+        }
+    }
+    else if (journal_ && !stop_requested_ && (url.ends_with(".m3u8") || url.ends_with(".m3u8.tmp"))) {
+        // EVENT播放列表先写到.tmp再改名，关闭时内容已完整。
+        // 停止后写尾部时muxer会在任意一帧处截断正在写的切片，它的结尾不是关键帧，不能作为续转的接续点，不记入日志
+        journal_->on_playlist_closed(url);
+    }
+
+    if (url.ends_with(".m3u8.tmp")) {
+        // 关闭之后muxer才把.tmp改名，要等这次muxer调用返回后才能对外发布
+        std::lock_guard<std::mutex> lock(outputs_mutex_);
+        renamed_playlists_[s].push_back(url.substr(0, url.size() - 4));
+    }
+    else if (url.ends_with(".m3u8")) {
+        on_playlist_written(url);
+    }
+}
+
+void HLSGenerator::on_playlist_written(const std::string& path) {
+    if (repairing_) {
+        return;     // 修复时的播放列表写在.repair目录中，不对外提供
+    }
+    if (ll_playlist_ && path.ends_with(config_.LL_HLS_PART_PLAYLIST)) {
+        // muxer内部的part列表不对外提供，客户端等待的是据此重写的主播放列表
+        ll_playlist_->update_from_part_playlist(path);
+        notify_output(config_.HLS_DIR + "/" + config_.M3U8_FILENAME);
+        return;
+    }
+    notify_output(path);
+}
+
+void HLSGenerator::publish_playlists(AVFormatContext* ctx) {
+    std::vector<std::string> renamed;
+    {
+        std::lock_guard<std::mutex> lock(outputs_mutex_);
+        auto it = renamed_playlists_.find(ctx);
+        if (it == renamed_playlists_.end()) {
+            return;
+        }
+        renamed = std::move(it->second);
+        renamed_playlists_.erase(it);
+    }
+    for (const auto& path : renamed) {
+        on_playlist_written(path);
+    }
+}
+
+int HLSGenerator::write_output_packet(AVFormatContext* ctx, AVPacket* pkt) {
+    int ret = av_interleaved_write_frame(ctx, pkt);
+    publish_playlists(ctx);
+    return ret;
+}
+
+int HLSGenerator::write_output_trailer(AVFormatContext* ctx) {
+    int ret = av_write_trailer(ctx);
+    publish_playlists(ctx);
+    return ret;
+}
 
 void HLSGenerator::start(){
     if(!should_reconvert()){
-        std::cout<<"跳过HLS转换，直接启动HTTP服务器"<<std::endl;
+        LOG_INFO("跳过HLS转换，直接启动HTTP服务器");
+        progress_ = 1;
         return ;
     }
-    std::cout<<"开始HLS转换"<<std::endl;
+    // 转换完成前清单不成立，中途退出后下次启动不会误用半成品
+    std::error_code manifest_ec;
+    std::filesystem::remove(manifest_path(), manifest_ec);
+    if (checkpoint_enabled() && !plan_from_checkpoint()) {
+        write_manifest(manifest_path(), identity_, config_.HLS_DIR + "/" + config_.M3U8_FILENAME);
+        progress_ = 1;
+        LOG_INFO("已按检查点修复HLS文件，直接启动HTTP服务器");
+        return;
+    }
+    LOG_INFO("开始HLS转换");
 	init_input();
 	init_output();
+    seek_to_checkpoint();
+
+    // FFmpeg出错时抛出异常，包随栈展开归还
+    Packet pkt = packet_pool_.acquire();
 
-    AVPacket* pkt=av_packet_alloc();
-    if (!pkt) {
-        throw std::runtime_error("Failed to allocate AVPacket");
+    // 多码率阶梯：解码一次，各档并行编码
+    bool laddered = false;
+    if (ladder_enabled()) {
+        LOG_INFO("多码率转码：" << renditions_.size() << "档");
+        run_ladder_transcode();
+        laddered = true;
     }
 
-    while (av_read_frame(input_ctx_, pkt) >= 0) {
+    // 视频需要转码时优先按关键帧分段并行转码，只有一个分段时退回串行
+    bool parallel = false;
+    int workers = parallel_workers();
+    if (workers > 1) {
+        std::vector<VideoChunk> chunks = plan_video_chunks();
+        if (chunks.size() > 1) {
+            LOG_INFO("分段并行转码：" << chunks.size() << "个分段，" << workers << "个工作线程");
+            run_parallel_transcode(chunks, workers);
+            parallel = true;
+        }
+    }
+
+    // 串行转码时把各步骤拆到流水线线程上，互相重叠
+    bool pipelined = false;
+    if (!parallel && !laddered && config_.HLS_PIPELINE_QUEUE > 0 && (need_video_transcode_ || need_audio_transcode_)) {
+        run_pipelined_transcode();
+        pipelined = true;
+    }
+
+    // 每秒根据已处理的视频帧数更新一次fps；直接复制时一个视频包即一帧
+    GeneratorMetrics& metrics = generator_metrics();
+    FpsWindow fps(need_video_transcode_ ? metrics.video_frames : metrics.video_packets);
+    while (!parallel && !pipelined && !laddered && !stop_requested_ && read_input_packet(pkt)) {
         // 处理当前帧
         process_packet(pkt);
         av_packet_unref(pkt);
+        fps.update();
+    }
+    metrics.fps.set(0);
+
+    if (stop_requested_) {
+        // 结尾标记会让半成品看起来已完成，写完尾部后删除播放列表，下次启动时重新转换
+        write_output_trailer(output_ctx_);
+        std::error_code ec;
+        std::filesystem::remove(config_.HLS_DIR + "/" + config_.M3U8_FILENAME, ec);
+        LOG_WARN("HLS转换被中止，已删除未完成的播放列表");
+        return;
     }
 
-    // 处理编码器中剩余的帧（冲刷编码器）
-    std::cout << "输入帧读取完成，冲刷编码器剩余数据..." << std::endl;
-    AVPacket* flush_pkt = av_packet_alloc();
-    process_packet(flush_pkt);  // 发送空包触发冲刷
-    av_packet_free(&flush_pkt);
+    // 处理编码器中剩余的帧（冲刷编码器）；并行、流水线与多码率模式已各自冲刷
+    if (!parallel && !pipelined && !laddered) {
+        LOG_INFO("输入帧读取完成，冲刷编码器剩余数据...");
+        Packet flush_pkt = packet_pool_.acquire();
+        process_packet(flush_pkt);  // 发送空包触发冲刷
+    }
 
     // 写入HLS尾（点播场景必需，标记播放结束）
-    av_write_trailer(output_ctx_);
-    std::cout << "HLS生成完成！" << std::endl;
+    write_output_trailer(output_ctx_);
+    if (ll_playlist_) {
+        ll_playlist_->finish();
+        notify_output(config_.HLS_DIR + "/" + config_.M3U8_FILENAME);
+    }
+    if (!renditions_.empty()) {
+        write_master_playlist(true);
+    }
+    if (journal_) {
+        journal_->mark_complete();
+    }
+    write_manifest(manifest_path(), identity_, config_.HLS_DIR + "/" + config_.M3U8_FILENAME);
+    progress_ = 1;
+    LOG_INFO("HLS生成完成！");
+}
+
+int HLSGenerator::parallel_workers() const {
+    // 直接复制不需要并行；低延迟HLS依赖连续的GOP切分part，保持串行；多码率阶梯已按档位并行；
+    // 续转与修复只处理输入的一段，不分段
+    if (!need_video_transcode_ || config_.LL_HLS_ENABLED || ladder_enabled() || config_.HLS_PARALLEL_WORKERS == 1
+        || checkpoint_start_ >= 0) {
+        return 1;
+    }
+    if (config_.HLS_PARALLEL_WORKERS > 0) {
+        return config_.HLS_PARALLEL_WORKERS;
+    }
+    return available_threads(config_);
+}
+
+std::vector<HLSGenerator::VideoChunk> HLSGenerator::plan_video_chunks() {
+    // 只解复用不解码，收集视频关键帧的时间戳
+    AVFormatContext* scan_ctx = nullptr;
+    int ret = avformat_open_input(&scan_ctx, config_.VIDEO_PATH.c_str(), nullptr, nullptr);
+    check_ffmpeg_error(ret, "Failed to open input file for keyframe scan");
+    ret = avformat_find_stream_info(scan_ctx, nullptr);
+    if (ret < 0) {
+        avformat_close_input(&scan_ctx);
+    }
+    check_ffmpeg_error(ret, "Failed to find stream info for keyframe scan");
+    for (unsigned int i = 0; i < scan_ctx->nb_streams; i++) {
+        if (static_cast<int>(i) != video_stream_idx_) {
+            scan_ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    std::vector<int64_t> keyframes;
+    AVPacket* pkt = av_packet_alloc();
+    while (av_read_frame(scan_ctx, pkt) >= 0) {
+        if (pkt->stream_index == video_stream_idx_ && (pkt->flags & AV_PKT_FLAG_KEY)) {
+            int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if (ts != AV_NOPTS_VALUE) {
+                keyframes.push_back(ts);
+            }
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&scan_ctx);
+    std::sort(keyframes.begin(), keyframes.end());
+
+    // 相邻分段在关键帧处衔接，每段至少HLS_CHUNK_SEGMENTS个切片时长
+    AVRational time_base = input_ctx_->streams[video_stream_idx_]->time_base;
+    int64_t chunk_length = av_rescale_q(static_cast<int64_t>(config_.HLS_SEGMENT_DURATION) * config_.HLS_CHUNK_SEGMENTS,
+        av_make_q(1, 1), time_base);
+    std::vector<VideoChunk> chunks(1);
+    chunks.back().start_pts = std::numeric_limits<int64_t>::min();   // 第一段从文件开头解码
+    int64_t chunk_start = keyframes.empty() ? 0 : keyframes.front();
+    for (int64_t ts : keyframes) {
+        if (ts - chunk_start >= chunk_length) {
+            chunks.back().end_pts = ts;
+            chunks.emplace_back();
+            chunks.back().start_pts = ts;
+            chunk_start = ts;
+        }
+    }
+    chunks.back().end_pts = std::numeric_limits<int64_t>::max();
+    return chunks;
+}
 
+void HLSGenerator::transcode_video_chunk(AVFormatContext* input, CodecContext& decoder,
+    FFmpegSwsContext& sws, VideoChunk& chunk) {
+    // 第一段总是最先被领取，此时该线程的输入刚打开，不需要seek
+    if (chunk.start_pts != std::numeric_limits<int64_t>::min()) {
+        int ret = av_seek_frame(input, video_stream_idx_, chunk.start_pts, AVSEEK_FLAG_BACKWARD);
+        check_ffmpeg_error(ret, "Failed to seek to chunk start");
+    }
+    avcodec_flush_buffers(decoder.get());
+    // 每段使用新的编码器：首帧即为IDR，且冲刷后的编码器不能继续使用
+    std::unique_ptr<CodecContext> encoder = open_video_encoder(input->streams[video_stream_idx_]);
+    AVCodecContext* enc = encoder->get();
+
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* dec_frame = av_frame_alloc();
+    check_ffmpeg_error(pkt && dec_frame ? 0 : -1, "Failed to allocate chunk buffers");
+    bool reached_end = false;
+
+    auto encode = [&](AVFrame* frame) {
+        int ret = avcodec_send_frame(enc, frame);
+        check_ffmpeg_error(ret, "Failed to send frame to video encoder");
+        while (true) {
+            AVPacket* enc_pkt = av_packet_alloc();
+            check_ffmpeg_error(enc_pkt ? 0 : -1, "Failed to allocate encode AVPacket");
+            ret = avcodec_receive_packet(enc, enc_pkt);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                av_packet_free(&enc_pkt);
+                break;
+            }
+            check_ffmpeg_error(ret, "Failed to receive packet from video encoder");
+            chunk.packets.push_back(enc_pkt);
+        }
+    };
+
+    // 解码顺序会越过下一段的关键帧，按显示时间戳裁到[start_pts, end_pts)
+    auto drain_decoder = [&]() {
+        while (!reached_end && avcodec_receive_frame(decoder.get(), dec_frame) >= 0) {
+            int64_t pts = dec_frame->pts != AV_NOPTS_VALUE ? dec_frame->pts : dec_frame->best_effort_timestamp;
+            if (pts >= chunk.end_pts) {
+                reached_end = true;
+            }
+            else if (pts >= chunk.start_pts) {
+                // 各工作线程共用scaled_pool_，编码尺寸相同
+                Frame enc_frame = scaled_pool_->acquire();
+                enc_frame->pts = pts;
+                sws_scale(sws.get(), dec_frame->data, dec_frame->linesize, 0, dec_frame->height,
+                    enc_frame->data, enc_frame->linesize);
+                encode(enc_frame);
+                generator_metrics().video_frames.inc();
+            }
+            av_frame_unref(dec_frame);
+        }
+    };
+
+    while (!reached_end && !stop_requested_ && av_read_frame(input, pkt) >= 0) {
+        if (pkt->stream_index == video_stream_idx_) {
+            generator_metrics().video_packets.inc();
+            int ret = avcodec_send_packet(decoder.get(), pkt);
+            check_ffmpeg_error(ret, "Failed to send packet to video decoder");
+            drain_decoder();
+        }
+        av_packet_unref(pkt);
+    }
+    if (!reached_end && !stop_requested_) {
+        // 文件结尾：取出解码器里剩余的帧
+        avcodec_send_packet(decoder.get(), nullptr);
+        drain_decoder();
+    }
+    encode(nullptr);
+
+    av_frame_free(&dec_frame);
     av_packet_free(&pkt);
+}
+
+void HLSGenerator::run_parallel_transcode(std::vector<VideoChunk>& chunks, int workers) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t next_chunk = 0;
+    size_t next_to_write = 0;
+    bool aborted = false;
+    std::exception_ptr worker_error;
+    // 已领取但还没写出的分段数上限，编码结果在内存中排队，限制占用
+    const size_t window = static_cast<size_t>(workers) * 2;
+
+    auto worker = [&]() {
+        AVFormatContext* input = nullptr;
+        try {
+            // 每个线程独立的输入、解码器与格式转换器
+            int ret = avformat_open_input(&input, config_.VIDEO_PATH.c_str(), nullptr, nullptr);
+            check_ffmpeg_error(ret, "Failed to open input file:" + config_.VIDEO_PATH);
+            ret = avformat_find_stream_info(input, nullptr);
+            check_ffmpeg_error(ret, "Failed to find stream info");
+            for (unsigned int i = 0; i < input->nb_streams; i++) {
+                if (static_cast<int>(i) != video_stream_idx_) {
+                    input->streams[i]->discard = AVDISCARD_ALL;
+                }
+            }
+            AVStream* stream = input->streams[video_stream_idx_];
+            std::unique_ptr<CodecContext> decoder = open_video_decoder(stream);
+            AVCodecContext* vctx = video_codec_ctx_->get();
+            FFmpegSwsContext sws(vctx->width, vctx->height, (AVPixelFormat)stream->codecpar->format,
+                vctx->width, vctx->height, vctx->pix_fmt, SWS_BILINEAR, threading_.scale_threads);
+
+            while (true) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&]() {
+                        return aborted || next_chunk >= chunks.size() || next_chunk < next_to_write + window;
+                        });
+                    if (aborted || next_chunk >= chunks.size()) {
+                        break;
+                    }
+                    index = next_chunk++;
+                }
+                try {
+                    transcode_video_chunk(input, *decoder, sws, chunks[index]);
+                }
+                catch (...) {
+                    chunks[index].error = std::current_exception();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    chunks[index].done = true;
+                }
+                cv.notify_all();
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            worker_error = std::current_exception();
+            aborted = true;
+            cv.notify_all();
+        }
+        if (input) {
+            avformat_close_input(&input);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++) {
+        threads.emplace_back(worker);
+    }
+
+    // 音频仍由input_ctx_串行处理（直接复制或转码），按时间戳与各分段的视频包交错写入
+    AVRational video_time_base = video_codec_ctx_->get()->time_base;
+    AVRational audio_time_base = audio_stream_idx_ != -1 ? input_ctx_->streams[audio_stream_idx_]->time_base : av_make_q(1, 1);
+    input_ctx_->streams[video_stream_idx_]->discard = AVDISCARD_ALL;
+    AVPacket* audio_pkt = av_packet_alloc();
+    auto read_audio = [&]() {
+        while (audio_stream_idx_ != -1 && av_read_frame(input_ctx_, audio_pkt) >= 0) {
+            if (audio_pkt->stream_index == audio_stream_idx_) {
+                return true;
+            }
+            av_packet_unref(audio_pkt);
+        }
+        return false;
+    };
+    auto audio_before = [&](int64_t video_ts) {
+        int64_t ts = audio_pkt->dts != AV_NOPTS_VALUE ? audio_pkt->dts : audio_pkt->pts;
+        return ts == AV_NOPTS_VALUE || av_compare_ts(ts, audio_time_base, video_ts, video_time_base) <= 0;
+    };
+
+    std::exception_ptr error;
+    FpsWindow fps(generator_metrics().video_frames);
+    try {
+        bool audio_pending = read_audio();
+        bool incomplete = false;
+        for (size_t i = 0; i < chunks.size() && !stop_requested_; i++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return chunks[i].done || aborted; });
+                if (!chunks[i].done) {
+                    incomplete = true;   // 工作线程初始化失败，错误在下面重新抛出
+                    break;
+                }
+            }
+            if (chunks[i].error) {
+                std::rethrow_exception(chunks[i].error);
+            }
+
+            for (AVPacket*& video_pkt : chunks[i].packets) {
+                int64_t video_ts = video_pkt->dts != AV_NOPTS_VALUE ? video_pkt->dts : video_pkt->pts;
+                while (audio_pending && audio_before(video_ts)) {
+                    process_packet(audio_pkt);
+                    av_packet_unref(audio_pkt);
+                    audio_pending = read_audio();
+                }
+                report_progress(video_ts, video_time_base);
+                write_video_packet(video_pkt, video_time_base);
+                av_packet_free(&video_pkt);
+            }
+            chunks[i].packets.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                next_to_write = i + 1;
+            }
+            cv.notify_all();
+            fps.update(true);
+        }
+
+        while (audio_pending && !stop_requested_ && !incomplete) {
+            process_packet(audio_pkt);
+            av_packet_unref(audio_pkt);
+            audio_pending = read_audio();
+        }
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+    }
+    cv.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& chunk : chunks) {
+        for (AVPacket*& packet : chunk.packets) {
+            av_packet_free(&packet);
+        }
+    }
+    av_packet_free(&audio_pkt);
+
+    if (!error) {
+        error = worker_error;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void HLSGenerator::write_video_packet(AVPacket* enc_pkt, AVRational src_time_base) {
+    prepare_video_packet(enc_pkt, src_time_base);
+    int ret = write_output_packet(output_ctx_, enc_pkt);
+    check_ffmpeg_error(ret, "Failed to write video packet to HLS");
+}
+
+void HLSGenerator::prepare_video_packet(AVPacket* enc_pkt, AVRational src_time_base) {
+    // 从输出视频流获取时间基，根据帧率计算单帧时长
+    AVStream* out_stream = output_ctx_->streams[output_video_stream_idx_];
+    // 假设输入帧率为30fps，若需动态适配可从输入流获取（in_video_stream->r_frame_rate）
+    AVRational frame_rate = av_make_q(30, 1);
+    enc_pkt->duration = av_rescale_q(1, av_inv_q(frame_rate), out_stream->time_base);
+
+    // 设置输出流索引，转换时间戳
+    enc_pkt->stream_index = output_video_stream_idx_;
+    av_packet_rescale_ts(enc_pkt, src_time_base, out_stream->time_base);
+    enc_pkt->pos = -1;  // HLS不需要定位信息
+}
+
+void HLSGenerator::run_pipelined_transcode() {
+    // 解复用(调用线程) → 视频解码 → 缩放 → 视频编码 ┐
+    //                  → 音频（复制或解码/重采样/编码）┴→ 封装
+    // 阶段之间是有界队列，传递的是从池中借出的Packet/Frame，数据缓冲区本身按引用计数共享不复制；
+    // 出错取消时残留在队列里的对象随队列析构归还到池中
+    const size_t depth = config_.HLS_PIPELINE_QUEUE;
+    const bool has_audio = audio_stream_idx_ != -1;
+    BoundedQueue<Packet> video_packets(depth);
+    BoundedQueue<Frame> decoded_frames(depth);
+    BoundedQueue<Frame> scaled_frames(depth);
+    BoundedQueue<Packet> audio_packets(depth);
+    BoundedQueue<Packet> mux_packets(depth * 2, has_audio ? 2 : 1);   // 视频与音频两条线各一个生产者
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        video_packets.cancel();
+        decoded_frames.cancel();
+        scaled_frames.cancel();
+        audio_packets.cancel();
+        mux_packets.cancel();
+    };
+    std::vector<std::thread> threads;
+    auto run_stage = [&](auto body) {
+        threads.emplace_back([&fail, body]() {
+            try {
+                body();
+            }
+            catch (...) {
+                fail();
+            }
+        });
+    };
+
+    if (need_video_transcode_) {
+        run_stage([&]() {
+            StageMeter meter("video_decode");
+            AVCodecContext* decoder = video_decoder_ctx_->get();
+            auto drain = [&]() {
+                while (true) {
+                    Frame frame = frame_pool_.acquire();
+                    int ret = avcodec_receive_frame(decoder, frame);
+                    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                        return;
+                    }
+                    check_ffmpeg_error(ret, "Failed to receive frame from video decoder");
+                    if (outside_range(frame->pts, input_ctx_->streams[video_stream_idx_]->time_base)) {
+                        continue;
+                    }
+                    if (!meter.wait([&]() { return decoded_frames.push(std::move(frame)); })) {
+                        return;
+                    }
+                }
+            };
+            Packet pkt;
+            while (meter.wait([&]() { return video_packets.pop(pkt); })) {
+                int ret = avcodec_send_packet(decoder, pkt);
+                pkt.reset();
+                check_ffmpeg_error(ret, "Failed to send packet to video decoder");
+                drain();
+            }
+            avcodec_send_packet(decoder, nullptr);
+            drain();
+            decoded_frames.close();
+            meter.finish();
+            });
+
+        run_stage([&]() {
+            StageMeter meter("video_scale");
+            Frame dec_frame;
+            while (meter.wait([&]() { return decoded_frames.pop(dec_frame); })) {
+                Frame enc_frame = scaled_pool_->acquire();
+                enc_frame->pts = dec_frame->pts;
+                sws_scale(sws_ctx_->get(), dec_frame->data, dec_frame->linesize, 0, dec_frame->height,
+                    enc_frame->data, enc_frame->linesize);
+                dec_frame.reset();
+                if (!meter.wait([&]() { return scaled_frames.push(std::move(enc_frame)); })) {
+                    break;
+                }
+            }
+            scaled_frames.close();
+            meter.finish();
+            });
+
+        run_stage([&]() {
+            StageMeter meter("video_encode");
+            AVCodecContext* vctx = video_codec_ctx_->get();
+            auto drain = [&]() {
+                while (true) {
+                    Packet enc_pkt = packet_pool_.acquire();
+                    int ret = avcodec_receive_packet(vctx, enc_pkt);
+                    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                        return;
+                    }
+                    check_ffmpeg_error(ret, "Failed to receive packet from video encoder");
+                    prepare_video_packet(enc_pkt, vctx->time_base);
+                    if (!meter.wait([&]() { return mux_packets.push(std::move(enc_pkt)); })) {
+                        return;
+                    }
+                }
+            };
+            Frame frame;
+            while (meter.wait([&]() { return scaled_frames.pop(frame); })) {
+                int ret = avcodec_send_frame(vctx, frame);
+                frame.reset();
+                check_ffmpeg_error(ret, "Failed to send frame to video encoder");
+                generator_metrics().video_frames.inc();
+                drain();
+            }
+            avcodec_send_frame(vctx, nullptr);
+            drain();
+            mux_packets.close();
+            meter.finish();
+            });
+    }
+
+    if (has_audio) {
+        run_stage([&]() {
+            StageMeter meter("audio");
+            auto emit = [&](AVPacket* out_pkt) {
+                Packet queued = packet_pool_.acquire();
+                av_packet_move_ref(queued, out_pkt);
+                meter.wait([&]() { return mux_packets.push(std::move(queued)); });
+            };
+            Packet pkt;
+            while (meter.wait([&]() { return audio_packets.pop(pkt); })) {
+                process_audio_packet(pkt, emit);
+                pkt.reset();
+            }
+            mux_packets.close();
+            meter.finish();
+            });
+    }
+
+    run_stage([&]() {
+        StageMeter meter("mux");
+        Packet pkt;
+        while (meter.wait([&]() { return mux_packets.pop(pkt); })) {
+            int ret = write_output_packet(output_ctx_, pkt);
+            pkt.reset();
+            check_ffmpeg_error(ret, "Failed to write packet to HLS");
+        }
+        meter.finish();
+        });
+
+    // 解复用在调用线程上进行
+    {
+        StageMeter meter("demux");
+        FpsWindow fps(need_video_transcode_ ? generator_metrics().video_frames : generator_metrics().video_packets);
+        try {
+            while (!stop_requested_) {
+                Packet pkt = packet_pool_.acquire();
+                if (!read_input_packet(pkt)) {
+                    break;
+                }
+                bool queued = true;
+                if (pkt->stream_index == video_stream_idx_) {
+                    if (pkt->size > 0) generator_metrics().video_packets.inc();
+                    if (need_video_transcode_) {
+                        queued = meter.wait([&]() { return video_packets.push(std::move(pkt)); });
+                    }
+                    else {
+                        // 直接复制的视频包不经过解码线程，与串行路径一样只换算时间基
+                        pkt->stream_index = output_video_stream_idx_;
+                        av_packet_rescale_ts(pkt, input_ctx_->streams[video_stream_idx_]->time_base,
+                            output_ctx_->streams[output_video_stream_idx_]->time_base);
+                        queued = meter.wait([&]() { return mux_packets.push(std::move(pkt)); });
+                    }
+                }
+                else if (pkt->stream_index == audio_stream_idx_) {
+                    if (pkt->size > 0) generator_metrics().audio_packets.inc();
+                    queued = meter.wait([&]() { return audio_packets.push(std::move(pkt)); });
+                }
+                if (!queued) {
+                    // 某个阶段出错，队列已取消
+                    break;
+                }
+                fps.update();
+            }
+        }
+        catch (...) {
+            fail();
+        }
+        if (need_video_transcode_) {
+            video_packets.close();
+        }
+        else {
+            mux_packets.close();
+        }
+        audio_packets.close();
+        meter.finish();
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
 
+void HLSGenerator::start_async() {
+    finished_ = false;
+    worker_ = std::thread([this]() {
+        try {
+            start();
+        }
+        catch (...) {
+            error_ = std::current_exception();
+        }
+        finished_ = true;
+    });
+}
+
+void HLSGenerator::stop() {
+    stop_requested_ = true;
+}
+
+void HLSGenerator::wait() {
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
 }
 
 void HLSGenerator::process_packet(AVPacket* pkt) {
-    AVPacket* filtered_pkt = av_packet_clone(pkt);  // 复制数据包
-    if (!filtered_pkt) {
-        throw std::runtime_error("Failed to clone AVPacket");
+    if (pkt->size > 0) {
+        if (pkt->stream_index == video_stream_idx_) generator_metrics().video_packets.inc();
+        else if (pkt->stream_index == audio_stream_idx_) generator_metrics().audio_packets.inc();
     }
 
     // 1. 区分视频流和音频流
     if (pkt->stream_index == video_stream_idx_) {
         if (!need_video_transcode_) {
-            // 直接复制视频包
-            filtered_pkt->stream_index = output_video_stream_idx_;
-            av_packet_rescale_ts(filtered_pkt,
+            // 直接复制视频包：muxer接管pkt的数据引用，调用方随后unref，不需要克隆
+            pkt->stream_index = output_video_stream_idx_;
+            av_packet_rescale_ts(pkt,
                 input_ctx_->streams[video_stream_idx_]->time_base,
                 output_ctx_->streams[output_video_stream_idx_]->time_base);
-            
-            int ret = av_interleaved_write_frame(output_ctx_, filtered_pkt);
-            if (ret < 0) {
-                av_packet_free(&filtered_pkt);
-                check_ffmpeg_error(ret, "Failed to write video packet to HLS");
-            }
+
+            int ret = write_output_packet(output_ctx_, pkt);
+            check_ffmpeg_error(ret, "Failed to write video packet to HLS");
         }else{
             // ------------------- 视频流处理：解码→转换→编码→写入 -------------------
-            AVFrame* dec_frame = av_frame_alloc();
-            check_ffmpeg_error(dec_frame ? 0 : -1, "Failed to allocate decode frame");
+            // 帧与包都从池中借用，缓冲区在编码器释放引用后回到池中
+            Frame dec_frame = frame_pool_.acquire();
 
             // 1.1 解码HEVC输入帧
             int ret = avcodec_send_packet(video_decoder_ctx_->get(), pkt);
-            if (ret < 0) {
-                // 如果是EAGAIN，先尝试接收已解码的帧，再重试发送
-                if (ret == AVERROR(EAGAIN)) {
-                    // 先接收解码器中已有的帧
-                    AVFrame* temp_frame = av_frame_alloc();
-                    while (avcodec_receive_frame(video_decoder_ctx_->get(), temp_frame) >= 0) {
-                        av_frame_free(&temp_frame);
-                        temp_frame = av_frame_alloc();
-                    }
-                    av_frame_free(&temp_frame);
-                    // 重试发送数据包
-                    ret = avcodec_send_packet(video_decoder_ctx_->get(), pkt);
-                }
-                if (ret < 0) {
-                    av_frame_free(&dec_frame);
-                    check_ffmpeg_error(ret, "Failed to send packet to video decoder");
+            if (ret == AVERROR(EAGAIN)) {
+                // 先取走解码器中已有的帧，再重试发送
+                while (avcodec_receive_frame(video_decoder_ctx_->get(), dec_frame) >= 0) {
+                    av_frame_unref(dec_frame);
                 }
+                ret = avcodec_send_packet(video_decoder_ctx_->get(), pkt);
             }
+            check_ffmpeg_error(ret, "Failed to send packet to video decoder");
 
             while (ret >= 0) {
                 ret = avcodec_receive_frame(video_decoder_ctx_->get(), dec_frame);
                 if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
                     break;
                 }
-                else if (ret < 0) {
-                    av_frame_free(&dec_frame);
-                    check_ffmpeg_error(ret, "Failed to receive frame from video decoder");
+                check_ffmpeg_error(ret, "Failed to receive frame from video decoder");
+                if (outside_range(dec_frame->pts, input_ctx_->streams[video_stream_idx_]->time_base)) {
+                    // 续转时从前一个关键帧开始解码，接续点之前的帧已在上次输出
+                    av_frame_unref(dec_frame);
+                    continue;
                 }
 
-                // 1.2 格式转换：输入帧（HEVC解码后的YUV）→ 编码器要求的YUV420P
-                AVFrame* enc_frame = av_frame_alloc();
-                check_ffmpeg_error(enc_frame ? 0 : -1, "Failed to allocate encode frame");
-                enc_frame->width = video_codec_ctx_->get()->width;
-                enc_frame->height = video_codec_ctx_->get()->height;
-                enc_frame->format = video_codec_ctx_->get()->pix_fmt;
+                // 1.2 格式转换：输入帧（HEVC解码后的YUV）→ 编码器要求的YUV420P，缓冲区来自scaled_pool_
+                Frame enc_frame = scaled_pool_->acquire();
                 enc_frame->pts = dec_frame->pts;  // 传递时间戳
 
-                // 分配帧数据缓冲区
-                ret = av_frame_get_buffer(enc_frame, 0);
-                check_ffmpeg_error(ret, "Failed to get buffer for encode frame");
-
                 // 调用sws_scale转换格式（FFmpegSwsContext的get()返回原生SwsContext*）
                 sws_scale(sws_ctx_->get(),
                     dec_frame->data, dec_frame->linesize, 0, dec_frame->height,
@@ -427,168 +1580,400 @@ void HLSGenerator::process_packet(AVPacket* pkt) {
 
                 // 1.3 编码为H.264
                 ret = avcodec_send_frame(video_codec_ctx_->get(), enc_frame);
-                if (ret < 0) {
-                    av_frame_free(&enc_frame);
-                    av_frame_free(&dec_frame);
-                    check_ffmpeg_error(ret, "Failed to send frame to video encoder");
-                }
-
-                AVPacket* enc_pkt=av_packet_alloc();
-                if (!enc_pkt) {
-                    av_packet_free(&enc_pkt);
-                    throw std::runtime_error("Failed to allocate encode AVPacket");
-                }
+                check_ffmpeg_error(ret, "Failed to send frame to video encoder");
+                generator_metrics().video_frames.inc();
 
+                Packet enc_pkt = packet_pool_.acquire();
                 while (ret >= 0) {
                     ret = avcodec_receive_packet(video_codec_ctx_->get(), enc_pkt);
                     if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
                         break;
                     }
-                    else if (ret < 0) {
-                        av_packet_unref(enc_pkt);
-                        av_frame_free(&enc_frame);
-                        av_frame_free(&dec_frame);
-                        check_ffmpeg_error(ret, "Failed to receive packet from video encoder");
-                    }
-                    if (enc_pkt->stream_index == output_video_stream_idx_) {
-                        // 从输出视频流获取时间基，根据帧率计算单帧时长
-                        AVStream* out_stream = output_ctx_->streams[output_video_stream_idx_];
-                        // 假设输入帧率为30fps，若需动态适配可从输入流获取（in_video_stream->r_frame_rate）
-                        AVRational frame_rate = av_make_q(30, 1);
-                        enc_pkt->duration = av_rescale_q(1, av_inv_q(frame_rate), out_stream->time_base);
-                    }
-
-                    // 1.4 设置输出流索引，转换时间戳
-                    enc_pkt->stream_index = output_video_stream_idx_;
-                    av_packet_rescale_ts(enc_pkt,
-                        video_codec_ctx_->get()->time_base,
-                        output_ctx_->streams[output_video_stream_idx_]->time_base);
-                    enc_pkt->pos = -1;  // HLS不需要定位信息
-
-                    // 1.5 写入HLS切片
-                    ret = av_interleaved_write_frame(output_ctx_, enc_pkt);
-                    if (ret < 0) {
-                        av_packet_unref(enc_pkt);
-                        av_frame_free(&enc_frame);
-                        av_frame_free(&dec_frame);
-                        check_ffmpeg_error(ret, "Failed to write video packet to HLS");
-                    }
+                    check_ffmpeg_error(ret, "Failed to receive packet from video encoder");
+                    // 1.4 转换时间戳并写入HLS切片
+                    write_video_packet(enc_pkt, video_codec_ctx_->get()->time_base);
                     av_packet_unref(enc_pkt);
                 }
-
-                av_frame_free(&enc_frame);
             }
-
-            av_frame_free(&dec_frame);
             // ---------------------------------------------------------------------
         }
     }
     else if (pkt->stream_index == audio_stream_idx_) {
-        if(!need_audio_transcode_){
-            // 直接复制音频包
-            filtered_pkt->stream_index = output_audio_stream_idx_;
-            av_packet_rescale_ts(filtered_pkt,
-                input_ctx_->streams[audio_stream_idx_]->time_base,
-                output_ctx_->streams[output_audio_stream_idx_]->time_base);
+        process_audio_packet(pkt, [this](AVPacket* out_pkt) {
+            int ret = write_output_packet(output_ctx_, out_pkt);
+            check_ffmpeg_error(ret, "Failed to write audio packet to HLS");
+            });
+    }
+}
 
-            int ret=av_interleaved_write_frame(output_ctx_, filtered_pkt);
-            if (ret < 0) {
-                av_packet_free(&filtered_pkt);
-                check_ffmpeg_error(ret, "Failed to write audio packet to HLS");
-            }
-        }else{
-            // ------------------- 音频流处理：解码→重采样→编码→写入 -------------------
-            AVFrame* dec_frame = av_frame_alloc();
-            check_ffmpeg_error(dec_frame ? 0 : -1, "Failed to allocate audio decode frame");
+void HLSGenerator::process_audio_packet(AVPacket* pkt, const std::function<void(AVPacket*)>& emit) {
+    if(!need_audio_transcode_){
+        // 直接复制音频包：就地改写pkt，emit取走引用后由调用方unref
+        pkt->stream_index = output_audio_stream_idx_;
+        av_packet_rescale_ts(pkt,
+            input_ctx_->streams[audio_stream_idx_]->time_base,
+            output_ctx_->streams[output_audio_stream_idx_]->time_base);
+        emit(pkt);
+        return;
+    }
+
+    // ------------------- 音频流处理：解码→重采样→编码→写入 -------------------
+    Frame dec_frame = frame_pool_.acquire();
 
-            int ret = avcodec_send_packet(audio_decoder_ctx_->get(), pkt);
-            if (ret < 0) {
-                av_frame_free(&dec_frame);
-                check_ffmpeg_error(ret, "Failed to send packet to audio decoder");
+    int ret = avcodec_send_packet(audio_decoder_ctx_->get(), pkt);
+    check_ffmpeg_error(ret, "Failed to send packet to audio decoder");
+
+    while (ret >= 0) {
+        ret = avcodec_receive_frame(audio_decoder_ctx_->get(), dec_frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        }
+        check_ffmpeg_error(ret, "Failed to receive frame from audio decoder");
+
+        // 重采样：输入音频格式→编码器要求的FLTP
+        Frame enc_frame = frame_pool_.acquire();
+        enc_frame->format = audio_codec_ctx_->get()->sample_fmt;
+        enc_frame->ch_layout = audio_codec_ctx_->get()->ch_layout;
+        enc_frame->sample_rate = audio_codec_ctx_->get()->sample_rate;
+        enc_frame->nb_samples = swr_get_out_samples(swr_ctx_->get(), dec_frame->nb_samples);
+        enc_frame->pts = dec_frame->pts;
+
+        ret = av_frame_get_buffer(enc_frame, 0);
+        check_ffmpeg_error(ret, "Failed to get buffer for audio encode frame");
+
+        // 调用swr_convert重采样（FFmpegSwrContext的get()返回原生SwrContext*）
+        int samples_written = swr_convert(swr_ctx_->get(),
+            enc_frame->data, enc_frame->nb_samples,
+            (const uint8_t**)dec_frame->data, dec_frame->nb_samples);
+        check_ffmpeg_error(samples_written, "Failed to resample audio");
+        enc_frame->nb_samples = samples_written;
+
+        // 编码为AAC
+        ret = avcodec_send_frame(audio_codec_ctx_->get(), enc_frame);
+        check_ffmpeg_error(ret, "Failed to send frame to audio encoder");
+        generator_metrics().audio_frames.inc();
+
+        Packet enc_pkt = packet_pool_.acquire();
+        while (ret >= 0) {
+            ret = avcodec_receive_packet(audio_codec_ctx_->get(), enc_pkt);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                break;
             }
+            check_ffmpeg_error(ret, "Failed to receive packet from audio encoder");
 
-            while (ret >= 0) {
-                ret = avcodec_receive_frame(audio_decoder_ctx_->get(), dec_frame);
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                    break;
-                }
-                else if (ret < 0) {
-                    av_frame_free(&dec_frame);
-                    check_ffmpeg_error(ret, "Failed to receive frame from audio decoder");
-                }
+            // 设置输出流索引，转换时间戳
+            enc_pkt->stream_index = output_audio_stream_idx_;
+            av_packet_rescale_ts(enc_pkt,
+                audio_codec_ctx_->get()->time_base,
+                output_ctx_->streams[output_audio_stream_idx_]->time_base);
+            enc_pkt->pos = -1;
 
-                // 重采样：输入音频格式→编码器要求的FLTP
-                AVFrame* enc_frame = av_frame_alloc();
-                check_ffmpeg_error(enc_frame ? 0 : -1, "Failed to allocate audio encode frame");
-                enc_frame->format = audio_codec_ctx_->get()->sample_fmt;
-                enc_frame->ch_layout = audio_codec_ctx_->get()->ch_layout;
-                enc_frame->sample_rate = audio_codec_ctx_->get()->sample_rate;
-                enc_frame->pts = dec_frame->pts;
+            emit(enc_pkt);
+            av_packet_unref(enc_pkt);
+        }
+    }
+    // ---------------------------------------------------------------------
+}
 
-                ret = av_frame_get_buffer(enc_frame, 0);
-                check_ffmpeg_error(ret, "Failed to get buffer for audio encode frame");
-
-                // 调用swr_convert重采样（FFmpegSwrContext的get()返回原生SwrContext*）
-                int samples_written = swr_convert(swr_ctx_->get(),
-                    enc_frame->data, enc_frame->nb_samples,
-                    (const uint8_t**)dec_frame->data, dec_frame->nb_samples);
-                if (samples_written < 0) {
-                    av_frame_free(&enc_frame);
-                    av_frame_free(&dec_frame);
-                    check_ffmpeg_error(samples_written, "Failed to resample audio");
-                }
-                enc_frame->nb_samples = samples_written;
-
-                // 编码为AAC
-                ret = avcodec_send_frame(audio_codec_ctx_->get(), enc_frame);
-                if (ret < 0) {
-                    av_frame_free(&enc_frame);
-                    av_frame_free(&dec_frame);
-                    check_ffmpeg_error(ret, "Failed to send frame to audio encoder");
-                }
+bool HLSGenerator::ladder_enabled() const {
+    return !config_.HLS_ABR_LADDER.empty() && !config_.LL_HLS_ENABLED;
+}
 
-                AVPacket* enc_pkt=av_packet_alloc();
-                if (!enc_pkt) {
-                    av_packet_free(&enc_pkt);
-                    throw std::runtime_error("Failed to allocate encoder");
-                }
+void HLSGenerator::plan_renditions(const AVStream* in_video_stream) {
+    int source_width = in_video_stream->codecpar->width;
+    int source_height = in_video_stream->codecpar->height;
+    // 不放大：高于源分辨率的档位跳过，全部跳过时按源分辨率输出最低码率那一档
+    for (const AbrRendition& spec : config_.HLS_ABR_LADDER) {
+        if (spec.height > source_height) {
+            LOG_INFO("跳过档位" << spec.name << "：高于源分辨率" << source_height << "p");
+            continue;
+        }
+        Rendition rendition;
+        rendition.name = spec.name;
+        rendition.height = spec.height & ~1;
+        // 宽度按源画面比例取偶数，YUV420P要求宽高都是偶数
+        rendition.width = static_cast<int>(static_cast<int64_t>(source_width) * spec.height / source_height) & ~1;
+        rendition.video_bitrate = spec.video_bitrate;
+        renditions_.push_back(std::move(rendition));
+    }
+    if (renditions_.empty()) {
+        auto lowest = std::min_element(config_.HLS_ABR_LADDER.begin(), config_.HLS_ABR_LADDER.end(),
+            [](const AbrRendition& a, const AbrRendition& b) { return a.video_bitrate < b.video_bitrate; });
+        Rendition rendition;
+        rendition.name = lowest->name;
+        rendition.width = source_width;
+        rendition.height = source_height;
+        rendition.video_bitrate = lowest->video_bitrate;
+        renditions_.push_back(std::move(rendition));
+    }
+    for (const Rendition& rendition : renditions_) {
+        std::filesystem::create_directories(config_.HLS_DIR + "/" + rendition.name);
+        LOG_INFO("档位" << rendition.name << "：" << rendition.width << "x" << rendition.height
+            << " " << rendition.video_bitrate / 1000 << "kbps");
+    }
+}
 
-                while (ret >= 0) {
-                    ret = avcodec_receive_packet(audio_codec_ctx_->get(), enc_pkt);
-                    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                        break;
+std::string HLSGenerator::rendition_playlist_path(const Rendition& rendition) const {
+    return config_.HLS_DIR + "/" + rendition.name + "/" + config_.M3U8_FILENAME;
+}
+
+void HLSGenerator::open_rendition(Rendition& rendition, const AVStream* in_video_stream) {
+    auto* out_video_stream = avformat_new_stream(rendition.output, nullptr);
+    check_ffmpeg_error(out_video_stream ? 0 : -1, "Failed to create rendition video stream");
+    rendition.video_index = out_video_stream->index;
+
+    rendition.encoder = open_video_encoder(in_video_stream, rendition.width, rendition.height, rendition.video_bitrate);
+    auto* vctx = rendition.encoder->get();
+    int ret = avcodec_parameters_from_context(out_video_stream->codecpar, vctx);
+    check_ffmpeg_error(ret, "Failed to copy rendition video parameters");
+    out_video_stream->time_base = vctx->time_base;
+
+    rendition.sws = std::make_unique<FFmpegSwsContext>(
+        in_video_stream->codecpar->width, in_video_stream->codecpar->height,
+        (AVPixelFormat)in_video_stream->codecpar->format,
+        vctx->width, vctx->height, vctx->pix_fmt,
+        SWS_BILINEAR, threading_.scale_threads);
+    rendition.pool = std::make_unique<FramePool>(vctx->width, vctx->height, vctx->pix_fmt, 64);
+}
+
+void HLSGenerator::open_rendition_output(Rendition& rendition, const AVStream* in_video_stream, const AVDictionary* options) {
+    std::string output_path = rendition_playlist_path(rendition);
+    int ret = avformat_alloc_output_context2(&rendition.output, nullptr, "hls", output_path.c_str());
+    check_ffmpeg_error(ret, "Failed to create rendition output context");
+    install_io_hooks(rendition.output);
+    open_rendition(rendition, in_video_stream);
+
+    if (audio_stream_idx_ != -1) {
+        const AVStream* main_audio = output_ctx_->streams[output_audio_stream_idx_];
+        auto* out_audio_stream = avformat_new_stream(rendition.output, nullptr);
+        check_ffmpeg_error(out_audio_stream ? 0 : -1, "Failed to create rendition audio stream");
+        ret = avcodec_parameters_copy(out_audio_stream->codecpar, main_audio->codecpar);
+        check_ffmpeg_error(ret, "Failed to copy rendition audio parameters");
+        out_audio_stream->time_base = main_audio->time_base;
+        rendition.audio_index = out_audio_stream->index;
+    }
+
+    if (!(rendition.output->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open2(&rendition.output->pb, output_path.c_str(), AVIO_FLAG_WRITE, nullptr, nullptr);
+        check_ffmpeg_error(ret, "Failed to open output file: " + output_path);
+    }
+    // avformat_write_header会取走识别出的选项，每档用一份拷贝
+    AVDictionary* rendition_options = nullptr;
+    av_dict_copy(&rendition_options, options, 0);
+    ret = avformat_write_header(rendition.output, &rendition_options);
+    av_dict_free(&rendition_options);
+    check_ffmpeg_error(ret, "Failed to write rendition HLS header");
+}
+
+void HLSGenerator::run_ladder_transcode() {
+    // 解复用与解码在调用线程上只做一次，解码帧以引用的方式分发给各档，不复制像素；
+    // 每档一个线程负责缩放、编码并写入自己的muxer。音频包也经各档的队列写入，每个muxer只被一个线程访问
+    const size_t depth = std::max<size_t>(config_.HLS_PIPELINE_QUEUE, 8);
+    std::vector<std::unique_ptr<BoundedQueue<RenditionItem>>> queues;
+    for (size_t i = 0; i < renditions_.size(); ++i) {
+        queues.push_back(std::make_unique<BoundedQueue<RenditionItem>>(depth));
+    }
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        for (auto& queue : queues) {
+            queue->cancel();
+        }
+    };
+
+    // 音频包由process_audio_packet换算到第0档音频流的时间基
+    AVRational audio_time_base = audio_stream_idx_ != -1
+        ? output_ctx_->streams[output_audio_stream_idx_]->time_base : av_make_q(1, 1);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < renditions_.size(); ++i) {
+        threads.emplace_back([this, &fail, &queue = *queues[i], &rendition = renditions_[i], audio_time_base]() {
+            try {
+                AVCodecContext* enc = rendition.encoder->get();
+                AVRational video_time_base = rendition.output->streams[rendition.video_index]->time_base;
+                Packet enc_pkt = packet_pool_.acquire();
+                auto drain = [&]() {
+                    while (true) {
+                        int ret = avcodec_receive_packet(enc, enc_pkt);
+                        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                            return;
+                        }
+                        check_ffmpeg_error(ret, "Failed to receive packet from rendition encoder");
+                        enc_pkt->stream_index = rendition.video_index;
+                        av_packet_rescale_ts(enc_pkt, enc->time_base, video_time_base);
+                        enc_pkt->pos = -1;
+                        ret = write_output_packet(rendition.output, enc_pkt);
+                        check_ffmpeg_error(ret, "Failed to write rendition video packet");
                     }
-                    else if (ret < 0) {
-                        av_packet_unref(enc_pkt);
-                        av_frame_free(&enc_frame);
-                        av_frame_free(&dec_frame);
-                        check_ffmpeg_error(ret, "Failed to receive packet from audio encoder");
+                };
+
+                RenditionItem item;
+                while (queue.pop(item)) {
+                    if (item.frame) {
+                        Frame scaled = rendition.pool->acquire();
+                        scaled->pts = item.frame->pts;
+                        scaled->pict_type = item.frame->pict_type;    // 切片边界处统一强制的关键帧
+                        sws_scale(rendition.sws->get(), item.frame->data, item.frame->linesize, 0, item.frame->height,
+                            scaled->data, scaled->linesize);
+                        item.frame.reset();
+                        int ret = avcodec_send_frame(enc, scaled);
+                        check_ffmpeg_error(ret, "Failed to send frame to rendition encoder");
+                        drain();
                     }
-
-                    // 设置输出流索引，转换时间戳
-                    enc_pkt->stream_index = output_audio_stream_idx_;
-                    av_packet_rescale_ts(enc_pkt,
-                        audio_codec_ctx_->get()->time_base,
-                        output_ctx_->streams[output_audio_stream_idx_]->time_base);
-                    enc_pkt->pos = -1;
-
-                    // 写入HLS
-                    ret = av_interleaved_write_frame(output_ctx_, enc_pkt);
-                    if (ret < 0) {
-                        av_packet_unref(enc_pkt);
-                        av_frame_free(&enc_frame);
-                        av_frame_free(&dec_frame);
-                        check_ffmpeg_error(ret, "Failed to write audio packet to HLS");
+                    else if (item.packet) {
+                        item.packet->stream_index = rendition.audio_index;
+                        av_packet_rescale_ts(item.packet, audio_time_base,
+                            rendition.output->streams[rendition.audio_index]->time_base);
+                        int ret = write_output_packet(rendition.output, item.packet);
+                        item.packet.reset();
+                        check_ffmpeg_error(ret, "Failed to write rendition audio packet");
                     }
-                    av_packet_unref(enc_pkt);
                 }
+                avcodec_send_frame(enc, nullptr);
+                drain();
+            }
+            catch (...) {
+                fail();
+            }
+            });
+    }
 
-                av_frame_free(&enc_frame);
+    // 各档的关键帧对齐：从第一帧起每隔一个切片时长强制一个关键帧，所有档位在同一帧处切片
+    AVCodecContext* decoder = video_decoder_ctx_->get();
+    AVRational in_time_base = input_ctx_->streams[video_stream_idx_]->time_base;
+    const int64_t segment_ticks = std::max<int64_t>(1,
+        av_rescale_q(config_.HLS_SEGMENT_DURATION, av_make_q(1, 1), in_time_base));
+    int64_t next_keyframe = AV_NOPTS_VALUE;
+    Frame decoded = frame_pool_.acquire();
+
+    auto distribute = [&]() {
+        int64_t pts = decoded->pts != AV_NOPTS_VALUE ? decoded->pts : decoded->best_effort_timestamp;
+        bool keyframe = next_keyframe == AV_NOPTS_VALUE || pts >= next_keyframe;
+        if (keyframe) {
+            next_keyframe = (next_keyframe == AV_NOPTS_VALUE ? pts : next_keyframe) + segment_ticks;
+            while (next_keyframe <= pts) {
+                next_keyframe += segment_ticks;
             }
+        }
+        decoded->pts = pts;
+        decoded->pict_type = keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+        generator_metrics().video_frames.inc();
+        for (auto& queue : queues) {
+            RenditionItem item;
+            item.frame = frame_pool_.acquire();
+            check_ffmpeg_error(av_frame_ref(item.frame, decoded), "Failed to reference decoded frame");
+            if (!queue->push(std::move(item))) {
+                return false;
+            }
+        }
+        av_frame_unref(decoded);
+        return true;
+    };
+    auto emit_audio = [&](AVPacket* out_pkt) {
+        for (auto& queue : queues) {
+            RenditionItem item;
+            item.packet = packet_pool_.ref(out_pkt);
+            queue->push(std::move(item));   // 被取消时丢弃
+        }
+    };
+
+    try {
+        Packet pkt = packet_pool_.acquire();
+        FpsWindow fps(generator_metrics().video_frames);
+        bool running = true;
+        while (running && !stop_requested_ && read_input_packet(pkt)) {
+            if (pkt->stream_index == video_stream_idx_) {
+                if (pkt->size > 0) generator_metrics().video_packets.inc();
+                int ret = avcodec_send_packet(decoder, pkt);
+                check_ffmpeg_error(ret, "Failed to send packet to video decoder");
+                while (running && avcodec_receive_frame(decoder, decoded) >= 0) {
+                    running = distribute();
+                }
+            }
+            else if (pkt->stream_index == audio_stream_idx_) {
+                if (pkt->size > 0) generator_metrics().audio_packets.inc();
+                process_audio_packet(pkt, emit_audio);
+            }
+            av_packet_unref(pkt);
+            fps.update();
+        }
+        if (running && !stop_requested_) {
+            // 取出解码器里剩余的帧
+            avcodec_send_packet(decoder, nullptr);
+            while (running && avcodec_receive_frame(decoder, decoded) >= 0) {
+                running = distribute();
+            }
+        }
+    }
+    catch (...) {
+        fail();
+    }
+    for (auto& queue : queues) {
+        queue->close();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
 
-            av_frame_free(&dec_frame);
-            // ---------------------------------------------------------------------
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    // 第0档即output_ctx_，尾部由start()写入
+    for (size_t i = 1; i < renditions_.size(); ++i) {
+        int ret = write_output_trailer(renditions_[i].output);
+        check_ffmpeg_error(ret, "Failed to write rendition HLS trailer");
+    }
+}
+
+void HLSGenerator::write_master_playlist(bool measured) {
+    int64_t audio_bitrate = 0;
+    std::string audio_codec;
+    if (audio_stream_idx_ != -1) {
+        const AVCodecParameters* audio = output_ctx_->streams[output_audio_stream_idx_]->codecpar;
+        audio_bitrate = audio->bit_rate > 0 ? audio->bit_rate : config_.AUDIO_BITRATE;
+        // AAC的RFC 6381对象类型等于profile+1（LC为2，HE为5）
+        int object_type = audio->profile >= 0 ? audio->profile + 1 : 2;
+        audio_codec = ",mp4a.40." + std::to_string(object_type);
+    }
+
+    std::ostringstream playlist;
+    playlist << "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-INDEPENDENT-SEGMENTS\n";
+    for (const Rendition& rendition : renditions_) {
+        // BANDWIDTH是切片的峰值码率：转码完成前按目标码率加上TS封装开销估算，完成后按实际切片测量
+        int64_t average = rendition.video_bitrate + audio_bitrate;
+        int64_t peak = average * 11 / 10;
+        if (measured && !measure_playlist_bandwidth(rendition_playlist_path(rendition), peak, average)) {
+            LOG_WARN("无法测量档位" << rendition.name << "的码率，使用目标码率");
         }
+        const AVCodecContext* vctx = rendition.encoder->get();
+        char video_codec[32];
+        std::snprintf(video_codec, sizeof(video_codec), "avc1.%02x00%02x",
+            vctx->profile > 0 ? vctx->profile : AV_PROFILE_H264_MAIN, vctx->level > 0 ? vctx->level : 30);
+
+        playlist << "#EXT-X-STREAM-INF:BANDWIDTH=" << peak << ",AVERAGE-BANDWIDTH=" << average
+            << ",RESOLUTION=" << rendition.width << "x" << rendition.height
+            << ",CODECS=\"" << video_codec << audio_codec << "\"\n"
+            << rendition.name << "/" << config_.M3U8_FILENAME << "\n";
+    }
+
+    // 先写临时文件再改名，HTTP服务器不会读到写了一半的主播放列表
+    std::string playlist_path = config_.HLS_DIR + "/" + config_.M3U8_FILENAME;
+    std::string temp_path = playlist_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << playlist.str();
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, playlist_path, ec);
+    if (ec) {
+        LOG_ERROR("写入主播放列表失败: " << ec.message());
+        return;
     }
-    av_packet_free(&filtered_pkt);
-}
\ No newline at end of file
+    notify_output(playlist_path);
+}
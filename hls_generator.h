@@ -3,16 +3,31 @@
 #define HLS_GENERATOR_H
 #include"config.h"
 #include"ffmpeg_utils.h"
+#include"ll_hls_playlist.h"
+#include"codec_threading.h"
+#include"checkpoint_journal.h"
+#include"transcode_manifest.h"
 #include<memory>
+#include<atomic>
+#include<thread>
+#include<exception>
 #include<string>
 #include<fstream>
 #include<sstream>
 #include<filesystem>
+#include<unordered_map>
+#include<mutex>
+#include<vector>
+#include<functional>
 
 extern "C" {
 	struct AVFormatContext;
 	struct AVPacket;
 	struct AVCodecParameters;
+	struct AVIOContext;
+	struct AVDictionary;
+	struct AVStream;
+	struct AVRational;
 }
 
 class HLSGenerator {
@@ -34,13 +49,123 @@ private:
 
 	bool need_video_transcode_=true;
 	bool need_audio_transcode_=true;
+	// 转码热路径上复用的包与帧；scaled_pool_按编码器尺寸和像素格式在init_output中创建
+	PacketPool packet_pool_{ 256 };		// 覆盖流水线各队列同时在途的包
+	FramePool frame_pool_{ 64 };
+	std::unique_ptr<FramePool> scaled_pool_;
+	CodecThreading threading_;	// 视频解码/编码/缩放的线程配置，init_input中按分辨率选定
 	int input_video_codec_id=0;
 	int input_audio_codec_id=0;
 
+	// 拦截muxer的文件打开/关闭，用于感知切片与播放列表何时写完
+	int (*default_io_open_)(AVFormatContext*, AVIOContext**, const char*, int, AVDictionary**) = nullptr;
+	int (*default_io_close_)(AVFormatContext*, AVIOContext*) = nullptr;
+	std::mutex outputs_mutex_;		// 多码率时各档的muxer在各自线程上回调，保护以下两项
+	std::unordered_map<AVIOContext*, std::string> open_outputs_;
+	std::unordered_map<AVFormatContext*, std::vector<std::string>> renamed_playlists_;	// 已关闭、待muxer改名后发布的播放列表
+	std::unique_ptr<LLHLSPlaylist> ll_playlist_;
+	std::function<void(const std::string&)> output_listener_;
+	void notify_output(const std::string& path);
+
+	// 后台生成：工作线程、停止请求与结束状态
+	std::thread worker_;
+	std::atomic<bool> stop_requested_{ false };
+	std::atomic<bool> finished_{ false };
+	std::exception_ptr error_;
+	std::atomic<double> progress_{ 0 };
+	// 按已读取或已写出的视频时间戳更新进度
+	void report_progress(int64_t ts, AVRational time_base);
+
+	static int io_open_hook(AVFormatContext* s, AVIOContext** pb, const char* url, int flags, AVDictionary** options);
+	static int io_close_hook(AVFormatContext* s, AVIOContext* pb);
+	void install_io_hooks(AVFormatContext* ctx);
+	void on_output_closed(AVFormatContext* s, const std::string& url);
+	// 播放列表以最终文件名写完：更新低延迟HLS的主播放列表，并通知监听者
+	void on_playlist_written(const std::string& path);
+	// 所有写入muxer的调用都经过以下两个函数，返回后发布本次调用中改名完成的播放列表
+	void publish_playlists(AVFormatContext* ctx);
+	int write_output_packet(AVFormatContext* ctx, AVPacket* pkt);
+	int write_output_trailer(AVFormatContext* ctx);
+
+	// 分段并行转码：每段从关键帧开始，由工作线程独立解码/编码，编码结果按顺序拼接写入muxer
+	struct VideoChunk {
+		int64_t start_pts = 0;              // 包含，输入视频流时间基
+		int64_t end_pts = 0;                // 不包含
+		std::vector<AVPacket*> packets;     // 编码结果，时间基与编码器相同
+		bool done = false;
+		std::exception_ptr error;
+	};
+	int parallel_workers() const;
+	std::vector<VideoChunk> plan_video_chunks();
+	void transcode_video_chunk(AVFormatContext* input, CodecContext& decoder, FFmpegSwsContext& sws, VideoChunk& chunk);
+	void run_parallel_transcode(std::vector<VideoChunk>& chunks, int workers);
+	std::unique_ptr<CodecContext> open_video_decoder(const AVStream* stream);
+	// width/height/bitrate为0时使用输入分辨率与VIDEO_BITRATE
+	std::unique_ptr<CodecContext> open_video_encoder(const AVStream* in_video_stream, int width = 0, int height = 0, int bitrate = 0);
+	void write_video_packet(AVPacket* enc_pkt, AVRational src_time_base);
+	// 设置视频包的输出流索引、时长并换算到输出时间基，不写入
+	void prepare_video_packet(AVPacket* enc_pkt, AVRational src_time_base);
+
+	// 流水线转码：解复用/解码/缩放/编码/封装各占一个线程，音频单独一条线，阶段之间用有界队列衔接
+	void run_pipelined_transcode();
+	// 复制或转码一个音频包，产出的每个包（已换算到输出时间基）交给emit
+	void process_audio_packet(AVPacket* pkt, const std::function<void(AVPacket*)>& emit);
+
+	// 多码率阶梯：输入只解码一次，解码帧分发给各档的线程各自缩放、编码并写入自己的muxer，
+	// 输出到HLS_DIR/<name>/，主播放列表列出各档
+	struct Rendition {
+		std::string name;
+		int width = 0;
+		int height = 0;
+		int video_bitrate = 0;
+		AVFormatContext* output = nullptr;	// 第0档即output_ctx_，其余由析构函数释放
+		int video_index = -1;
+		int audio_index = -1;
+		std::unique_ptr<CodecContext> encoder;
+		std::unique_ptr<FFmpegSwsContext> sws;
+		std::unique_ptr<FramePool> pool;
+	};
+	std::vector<Rendition> renditions_;
+	bool ladder_enabled() const;
+	void plan_renditions(const AVStream* in_video_stream);
+	std::string rendition_playlist_path(const Rendition& rendition) const;
+	// 在rendition.output中创建视频流并打开该档的编码器与缩放器
+	void open_rendition(Rendition& rendition, const AVStream* in_video_stream);
+	// 第1档起：创建muxer、视频流与音频流（参数同第0档）并写入头部
+	void open_rendition_output(Rendition& rendition, const AVStream* in_video_stream, const AVDictionary* options);
+	void run_ladder_transcode();
+	// measured为false时按目标码率估算BANDWIDTH，为true时按已写出切片的大小与时长测量
+	void write_master_playlist(bool measured);
+
+	// 断点续转与切片修复：journal_记录每个写完的切片；续转或修复时只处理输入中[checkpoint_start_, checkpoint_end_)
+	// 这一段（秒，相对输入视频第一帧，负数表示不限），init_input之后换算成range_start_/range_end_并寻址
+	std::unique_ptr<CheckpointJournal> journal_;
+	double checkpoint_start_ = -1;
+	double checkpoint_end_ = -1;
+	size_t first_segment_ = 0;			// 本次输出的第一个切片编号
+	bool repairing_ = false;			// 只重新生成一个切片，输出到HLS_DIR/.repair/
+	int64_t range_start_ = AV_NOPTS_VALUE;	// 输入视频流时间基
+	int64_t range_end_ = AV_NOPTS_VALUE;
+	bool checkpoint_enabled() const;
+	// 单个切片的临时输出目录，按切片编号区分，多个实例可以同时生成不同的切片
+	std::string repair_dir() const;
+	// 根据检查点日志决定本次怎么做：返回false表示已修复完毕，不需要转码
+	bool plan_from_checkpoint();
+	void seek_to_checkpoint();
+	// 时间戳落在续转/修复范围之前或之后
+	bool outside_range(int64_t ts, AVRational time_base) const;
+	// 读取下一个要处理的输入包，跳过范围之外的包，读到范围结尾时返回false
+	bool read_input_packet(AVPacket* pkt);
+
+	// 输入内容指纹与转码参数哈希，should_reconvert中计算；转换完成后写入清单
+	TranscodeIdentity identity_;
+	std::string manifest_path() const;
+
 	void init_input();
 	void init_output();
 	bool should_reconvert();
 	bool check_hls_integrity();
+	bool check_playlist_integrity(const std::string& m3u8_path);
 	bool needs_transcoding(const AVCodecParameters* codecpar,bool is_video);
 	void setup_direct_stream_copy(int stream_index);
 	void cleanup_output_context();
@@ -51,7 +176,22 @@ public:
 	~HLSGenerator();
 
 	void start();
+	// 在后台线程中执行start()，立即返回；切片写完即出现在EVENT播放列表中
+	void start_async();
+	// 请求后台转码在下一个数据包处停止，不等待
+	void stop();
+	// 等待后台线程结束，转码抛出的异常在这里重新抛出
+	void wait();
+	bool is_finished() const { return finished_; }
+	// 已处理的输入时长占比（0~1），可在其他线程读取
+	double progress() const { return progress_.load(std::memory_order_relaxed); }
 	void process_packet(AVPacket* pkt);
+	// 在start()之前设置：每个切片或播放列表写完、或切片被修复替换后以其路径调用，
+	// 供HTTP服务器丢弃缓存的旧内容并唤醒等待该文件的请求；在转码线程上调用，多码率时可能并发
+	void set_output_listener(std::function<void(const std::string&)> listener) { output_listener_ = std::move(listener); }
+	// 在新的实例上调用：转码一个切片对应的输入范围，生成后替换HLS_DIR下的同名文件；
+	// 检查点修复与按需转码共用
+	void render_segment(const SegmentCheckpoint& segment, size_t index);
 };
 
 #endif // !HLS_GENERATOR_H
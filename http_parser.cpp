@@ -0,0 +1,168 @@
+#include "http_parser.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    // RFC 9110 token字符
+    bool is_tchar(unsigned char c) {
+        if (std::isalnum(c)) return true;
+        switch (c) {
+        case '!': case '#': case '$': case '%': case '&': case '\'': case '*': case '+':
+        case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool is_token(std::string_view value) {
+        return !value.empty() && std::all_of(value.begin(), value.end(),
+            [](char c) { return is_tchar(static_cast<unsigned char>(c)); });
+    }
+
+    // 字段值允许可见字符、空格、制表符和obs-text
+    bool is_field_value(std::string_view value) {
+        return std::all_of(value.begin(), value.end(), [](char ch) {
+            unsigned char c = static_cast<unsigned char>(ch);
+            return c == '\t' || (c >= 0x20 && c != 0x7f);
+            });
+    }
+
+    std::string_view trim_ows(std::string_view value) {
+        size_t begin = value.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) return {};
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(begin, end - begin + 1);
+    }
+
+    HttpParseStatus parse_request_line(std::string_view line, HttpRequestHead& head) {
+        size_t first_space = line.find(' ');
+        if (first_space == std::string_view::npos) return HttpParseStatus::Invalid;
+        size_t second_space = line.find(' ', first_space + 1);
+        if (second_space == std::string_view::npos) return HttpParseStatus::Invalid;
+
+        head.method = line.substr(0, first_space);
+        head.target = line.substr(first_space + 1, second_space - first_space - 1);
+        head.version = line.substr(second_space + 1);
+
+        if (!is_token(head.method) || head.target.empty()) return HttpParseStatus::Invalid;
+        // 只接受origin-form（以/开头）和OPTIONS使用的 *
+        if (head.target[0] != '/' && head.target != "*") return HttpParseStatus::Invalid;
+        for (char ch : head.target) {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (c <= 0x20 || c >= 0x7f) return HttpParseStatus::Invalid;
+        }
+
+        const std::string_view& version = head.version;
+        if (version.size() != 8 || version.compare(0, 5, "HTTP/") != 0 ||
+            !std::isdigit(static_cast<unsigned char>(version[5])) || version[6] != '.' ||
+            !std::isdigit(static_cast<unsigned char>(version[7]))) {
+            return HttpParseStatus::Invalid;
+        }
+        if (version != "HTTP/1.1" && version != "HTTP/1.0") return HttpParseStatus::UnsupportedVersion;
+        return HttpParseStatus::Complete;
+    }
+
+    // 重复出现时返回false
+    bool set_once(std::string_view& field, std::string_view value) {
+        if (field.data() != nullptr) return false;
+        // 空值也要记录为已出现，指向行内位置而不是nullptr
+        field = value.data() != nullptr ? value : std::string_view("", 0);
+        return true;
+    }
+
+    HttpParseStatus parse_header_line(std::string_view line, HttpRequestHead& head) {
+        // 折叠行（以空白开头的续行）已被RFC 9112废弃
+        if (line[0] == ' ' || line[0] == '\t') return HttpParseStatus::Invalid;
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) return HttpParseStatus::Invalid;
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = line.substr(colon + 1);
+        // 字段名与冒号之间不允许空白
+        if (!is_token(name) || !is_field_value(value)) return HttpParseStatus::Invalid;
+        value = trim_ows(value);
+
+        if (http_iequals(name, "Connection")) {
+            head.connection_close = head.connection_close || http_list_contains(value, "close");
+            head.connection_keep_alive = head.connection_keep_alive || http_list_contains(value, "keep-alive");
+        }
+        else if (http_iequals(name, "Range")) {
+            if (!set_once(head.range, value)) return HttpParseStatus::Invalid;
+        }
+        else if (http_iequals(name, "If-None-Match")) {
+            if (!set_once(head.if_none_match, value)) return HttpParseStatus::Invalid;
+        }
+        else if (http_iequals(name, "If-Modified-Since")) {
+            if (!set_once(head.if_modified_since, value)) return HttpParseStatus::Invalid;
+        }
+        else if (http_iequals(name, "If-Range")) {
+            if (!set_once(head.if_range, value)) return HttpParseStatus::Invalid;
+        }
+        else if (http_iequals(name, "Transfer-Encoding")) {
+            head.has_body = true;
+        }
+        else if (http_iequals(name, "Content-Length")) {
+            head.has_body = head.has_body || value.find_first_not_of('0') != std::string_view::npos;
+        }
+        return HttpParseStatus::Complete;
+    }
+}
+
+HttpParseStatus parse_http_request_head(std::string_view data, const HttpParserLimits& limits,
+    HttpRequestHead& head) {
+    head = HttpRequestHead{};
+    // 只在限制范围内查找行尾，超长的请求头不会被完整扫描
+    std::string_view window = data.substr(0, std::min(data.size(), limits.max_head_bytes));
+    bool have_request_line = false;
+    size_t line_start = 0;
+
+    while (true) {
+        size_t line_end = window.find('\n', line_start);
+        if (line_end == std::string_view::npos) {
+            return data.size() >= limits.max_head_bytes ? HttpParseStatus::TooLarge : HttpParseStatus::Incomplete;
+        }
+        if (line_end == line_start || window[line_end - 1] != '\r') {
+            return HttpParseStatus::Invalid;   // 裸LF
+        }
+        std::string_view line = window.substr(line_start, line_end - 1 - line_start);
+        line_start = line_end + 1;
+
+        if (!have_request_line) {
+            // 请求行之前的空行按RFC 9112忽略
+            if (line.empty()) continue;
+            HttpParseStatus status = parse_request_line(line, head);
+            if (status != HttpParseStatus::Complete) return status;
+            have_request_line = true;
+            continue;
+        }
+
+        if (line.empty()) {
+            head.head_bytes = line_start;
+            return HttpParseStatus::Complete;
+        }
+        if (++head.header_count > limits.max_headers) return HttpParseStatus::TooLarge;
+        HttpParseStatus status = parse_header_line(line, head);
+        if (status != HttpParseStatus::Complete) return status;
+    }
+}
+
+bool http_iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool http_list_contains(std::string_view list, std::string_view token) {
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        if (http_iequals(trim_ows(list.substr(0, comma)), token)) return true;
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
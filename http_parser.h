@@ -0,0 +1,50 @@
+#pragma once
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <cstddef>
+#include <string_view>
+
+// 解析出的请求头，各字段都指向接收缓冲区，缓冲区被消费或追加数据之前有效
+struct HttpRequestHead {
+    std::string_view method;
+    std::string_view target;
+    std::string_view version;
+
+    // 服务器使用的请求头，未出现时为空
+    std::string_view range;
+    std::string_view if_none_match;
+    std::string_view if_modified_since;
+    std::string_view if_range;
+    bool connection_close = false;
+    bool connection_keep_alive = false;
+    bool has_body = false;           // 带Content-Length或Transfer-Encoding，请求体不会被读取
+
+    size_t header_count = 0;
+    size_t head_bytes = 0;           // 请求行到结尾空行的总长度，即应从缓冲区消费的字节数
+};
+
+enum class HttpParseStatus {
+    Complete,
+    Incomplete,           // 尚未收到结尾空行
+    Invalid,              // 格式错误，应返回400
+    TooLarge,             // 超出请求头大小或字段数限制，应返回431
+    UnsupportedVersion    // 不是HTTP/1.0或HTTP/1.1，应返回505
+};
+
+struct HttpParserLimits {
+    size_t max_head_bytes = 16 * 1024;
+    size_t max_headers = 64;
+};
+
+// 解析data开头的一个请求头，不复制数据、不分配内存
+// 严格模式：每行必须以CRLF结尾；拒绝折叠行、字段名前后的空白、控制字符，
+// 以及重复的Range/If-*字段（无法在不复制的前提下合并，且重复的Range有歧义）
+HttpParseStatus parse_http_request_head(std::string_view data, const HttpParserLimits& limits,
+    HttpRequestHead& head);
+
+bool http_iequals(std::string_view a, std::string_view b);
+// 逗号分隔的列表（如Connection）中是否包含token，不区分大小写
+bool http_list_contains(std::string_view list, std::string_view token);
+
+#endif // HTTP_PARSER_H
@@ -0,0 +1,232 @@
+#include "http_utils.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    bool parse_uint(const std::string& text, uint64_t& value) {
+        if (text.empty()) return false;
+        value = 0;
+        for (char c : text) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+            uint64_t next = value * 10 + static_cast<uint64_t>(c - '0');
+            if (next < value) return false;   // 溢出
+            value = next;
+        }
+        return true;
+    }
+
+    std::string trim(const std::string& value) {
+        size_t begin = value.find_first_not_of(" \t");
+        if (begin == std::string::npos) return "";
+        size_t end = value.find_last_not_of(" \t");
+        return value.substr(begin, end - begin + 1);
+    }
+
+    const char* const WEEKDAYS[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    const char* const MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    // 公历日期与1970-01-01之间的天数换算，避免依赖timegm/_mkgmtime
+    int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+        y -= m <= 2;
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(y - era * 400);
+        const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<int64_t>(doe) - 719468;
+    }
+
+    void civil_from_days(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+        z += 719468;
+        const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10 ? mp + 3 : mp - 9;
+        y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+    }
+
+    std::string strip_weak(const std::string& tag) {
+        std::string value = trim(tag);
+        if (value.compare(0, 2, "W/") == 0) {
+            value = value.substr(2);
+        }
+        return value;
+    }
+}
+
+RangeParseResult parse_range_header(const std::string& value, uint64_t total_size,
+    std::vector<ByteRange>& ranges, size_t max_ranges) {
+    ranges.clear();
+
+    std::string spec = trim(value);
+    if (spec.compare(0, 6, "bytes=") != 0) {
+        return RangeParseResult::None;
+    }
+
+    size_t spec_count = 0;
+    size_t pos = 6;
+    while (pos <= spec.size()) {
+        size_t comma = spec.find(',', pos);
+        if (comma == std::string::npos) comma = spec.size();
+        std::string item = trim(spec.substr(pos, comma - pos));
+        pos = comma + 1;
+
+        if (item.empty()) continue;
+        if (++spec_count > max_ranges) {
+            ranges.clear();
+            return RangeParseResult::None;
+        }
+
+        size_t dash = item.find('-');
+        if (dash == std::string::npos) {
+            ranges.clear();
+            return RangeParseResult::None;
+        }
+        std::string first = item.substr(0, dash);
+        std::string last = item.substr(dash + 1);
+
+        uint64_t start = 0;
+        uint64_t end = 0;
+        if (first.empty()) {
+            // 后缀范围：最后N个字节
+            uint64_t suffix = 0;
+            if (!parse_uint(last, suffix)) {
+                ranges.clear();
+                return RangeParseResult::None;
+            }
+            if (suffix == 0 || total_size == 0) continue;
+            start = suffix >= total_size ? 0 : total_size - suffix;
+            end = total_size - 1;
+        }
+        else {
+            if (!parse_uint(first, start)) {
+                ranges.clear();
+                return RangeParseResult::None;
+            }
+            if (last.empty()) {
+                end = total_size == 0 ? 0 : total_size - 1;
+            }
+            else if (!parse_uint(last, end) || end < start) {
+                ranges.clear();
+                return RangeParseResult::None;
+            }
+            if (start >= total_size) continue;   // 该范围不可满足
+            if (end >= total_size) end = total_size - 1;
+        }
+
+        ranges.push_back(ByteRange{ start, end - start + 1 });
+    }
+
+    if (spec_count == 0) {
+        return RangeParseResult::None;
+    }
+    return ranges.empty() ? RangeParseResult::Unsatisfiable : RangeParseResult::Satisfiable;
+}
+
+std::string content_range_value(const ByteRange& range, uint64_t total_size) {
+    return "bytes " + std::to_string(range.start) + "-" + std::to_string(range.start + range.length - 1)
+        + "/" + std::to_string(total_size);
+}
+
+FileValidators make_file_validators(uint64_t size, std::chrono::system_clock::time_point mtime) {
+    FileValidators validators;
+    validators.mtime = std::chrono::time_point_cast<std::chrono::seconds>(mtime);
+
+    auto mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    char etag[64];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+        static_cast<unsigned long long>(size), static_cast<unsigned long long>(mtime_ns));
+    validators.etag = etag;
+    validators.last_modified = format_http_date(mtime);
+    return validators;
+}
+
+FileValidators load_file_validators(const std::string& path, uint64_t size) {
+    std::error_code ec;
+    auto file_time = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return FileValidators{};
+    }
+    return make_file_validators(size, to_system_time(file_time));
+}
+
+std::chrono::system_clock::time_point to_system_time(std::filesystem::file_time_type file_time) {
+#if defined(_MSC_VER)
+    return std::chrono::clock_cast<std::chrono::system_clock>(file_time);
+#else
+    return std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        std::filesystem::file_time_type::clock::to_sys(file_time));
+#endif
+}
+
+std::string format_http_date(std::chrono::system_clock::time_point time) {
+    int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+    int64_t days = seconds / 86400;
+    int64_t rem = seconds % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        days -= 1;
+    }
+
+    int64_t year = 0;
+    unsigned month = 0;
+    unsigned day = 0;
+    civil_from_days(days, year, month, day);
+    int weekday = static_cast<int>((days % 7 + 11) % 7);   // 1970-01-01为周四
+
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%s, %02u %s %04lld %02d:%02d:%02d GMT",
+        WEEKDAYS[weekday], day, MONTHS[month - 1], static_cast<long long>(year),
+        static_cast<int>(rem / 3600), static_cast<int>(rem % 3600 / 60), static_cast<int>(rem % 60));
+    return buffer;
+}
+
+bool parse_http_date(const std::string& value, std::chrono::system_clock::time_point& time) {
+    char weekday[4] = {};
+    char month_name[4] = {};
+    unsigned day = 0;
+    int year = 0;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    if (std::sscanf(value.c_str(), "%3s, %u %3s %d %d:%d:%d GMT",
+        weekday, &day, month_name, &year, &hour, &minute, &second) != 7) {
+        return false;
+    }
+
+    unsigned month = 0;
+    for (unsigned i = 0; i < 12; ++i) {
+        if (std::strncmp(month_name, MONTHS[i], 3) == 0) {
+            month = i + 1;
+            break;
+        }
+    }
+    if (month == 0 || day == 0 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    int64_t seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    time = std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+    return true;
+}
+
+bool etag_matches(const std::string& if_none_match, const std::string& etag) {
+    if (etag.empty()) return false;
+    if (trim(if_none_match) == "*") return true;
+
+    std::string target = strip_weak(etag);
+    size_t pos = 0;
+    while (pos <= if_none_match.size()) {
+        size_t comma = if_none_match.find(',', pos);
+        if (comma == std::string::npos) comma = if_none_match.size();
+        if (strip_weak(if_none_match.substr(pos, comma - pos)) == target) {
+            return true;
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef HTTP_UTILS_H
+#define HTTP_UTILS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+// 闭区间[start, start+length-1]对应的字节范围
+struct ByteRange {
+    uint64_t start = 0;
+    uint64_t length = 0;
+};
+
+enum class RangeParseResult {
+    None,           // 无Range头或格式无法识别，按完整内容响应
+    Satisfiable,    // 至少一个范围有效，ranges中为有效范围
+    Unsatisfiable   // 所有范围都超出文件大小，应返回416
+};
+
+// 解析 "bytes=0-99,200-,-500" 形式的Range头
+// 超过max_ranges个范围时视为无法识别，避免大量小范围请求放大开销
+RangeParseResult parse_range_header(const std::string& value, uint64_t total_size,
+    std::vector<ByteRange>& ranges, size_t max_ranges = 16);
+
+std::string content_range_value(const ByteRange& range, uint64_t total_size);
+
+// 按需生成的切片（JitTranscoder）对HttpServer的状态
+enum class SegmentAvailability {
+    Ready,      // 已生成，或不是按需生成的切片：照常发送
+    Pending,    // 正在生成：挂起请求直到文件出现
+    Failed      // 生成失败：返回503，客户端稍后重试时重新生成
+};
+
+// 条件请求使用的校验信息，按文件计算一次后随响应复用
+struct FileValidators {
+    std::string etag;
+    std::string last_modified;
+    std::chrono::system_clock::time_point mtime;
+};
+
+FileValidators make_file_validators(uint64_t size, std::chrono::system_clock::time_point mtime);
+// 读取失败时返回空的校验信息
+FileValidators load_file_validators(const std::string& path, uint64_t size);
+std::chrono::system_clock::time_point to_system_time(std::filesystem::file_time_type file_time);
+
+// IMF-fixdate格式，如 "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string format_http_date(std::chrono::system_clock::time_point time);
+bool parse_http_date(const std::string& value, std::chrono::system_clock::time_point& time);
+
+// If-None-Match弱比较，支持 "*" 与逗号分隔的列表
+bool etag_matches(const std::string& if_none_match, const std::string& etag);
+
+#endif // HTTP_UTILS_H
@@ -0,0 +1,443 @@
+#include "jit_transcoder.h"
+#include "hls_generator.h"
+#include "transcode_manifest.h"
+#include "codec_threading.h"
+#include "metrics.h"
+#include "logger.h"
+#include "utils.h"
+#include<algorithm>
+#include<cctype>
+#include<chrono>
+#include<cmath>
+#include<cstdio>
+#include<filesystem>
+#include<fstream>
+#include<sstream>
+extern"C" {
+#include<libavformat/avformat.h>
+}
+
+namespace {
+    struct JitMetrics {
+        Metrics& registry = Metrics::instance();
+        Metrics::Counter& hits = registry.counter("hls_jit_segment_requests_total",
+            "Segment requests in on-demand mode", "result=\"ready\"");
+        Metrics::Counter& misses = registry.counter("hls_jit_segment_requests_total",
+            "Segment requests in on-demand mode", "result=\"waiting\"");
+        Metrics::Counter& rendered = registry.counter("hls_jit_segments_rendered_total",
+            "Segments transcoded on demand or by prefetch");
+        Metrics::Histogram& render_seconds = registry.histogram("hls_jit_render_seconds",
+            "Time to transcode one segment on demand", Metrics::latency_buckets());
+    };
+
+    JitMetrics& jit_metrics() {
+        static JitMetrics metrics;
+        return metrics;
+    }
+
+    // 堆顶是被请求的任务，其次是先到的预取
+    template <typename Task>
+    bool lower_priority(const Task& a, const Task& b) {
+        if (a.demanded != b.demanded) {
+            return !a.demanded;
+        }
+        return a.sequence > b.sequence;
+    }
+}
+
+JitTranscoder::JitTranscoder(const Config& config)
+    : config_(config)
+    , segment_prefix_(std::filesystem::path(config.M3U8_FILENAME).stem().string()) {
+    int workers = std::max(1, config_.JIT_WORKERS);
+    worker_config_ = std::make_unique<Config>(config_.VIDEO_PATH, config_.HLS_DIR,
+        std::max(1, available_threads(config_) / workers), config_.HLS_CHECKPOINT);
+}
+
+JitTranscoder::~JitTranscoder() {
+    stop();
+}
+
+void JitTranscoder::start() {
+    if (config_.LL_HLS_ENABLED || !config_.HLS_ABR_LADDER.empty()) {
+        LOG_WARN("按需转码只支持单路普通HLS，低延迟HLS与多码率阶梯设置被忽略");
+    }
+    std::filesystem::create_directories(config_.HLS_DIR);
+    std::string identity = compute_transcode_identity(config_, config_.HLS_MANIFEST_FULL_HASH).to_string();
+    if (!load_index(identity)) {
+        auto begin = std::chrono::steady_clock::now();
+        build_index();
+        save_index(identity);
+        LOG_INFO("关键帧索引建立完成：" << segments_.size() << "个切片，用时"
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() << "秒");
+    }
+    write_playlist();
+
+    // 只有按本索引生成并记录过的切片才可用；其余同名文件来自旧的输入、参数或完整转码（切片边界不同），
+    // 必须删除，否则挂起的请求会把它当作刚生成的切片发送
+    states_.assign(segments_.size(), SegmentState::Missing);
+    size_t ready = 0;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (rendered_intact(segments_[i])) {
+            states_[i] = SegmentState::Ready;
+            ready++;
+        }
+    }
+    remove_stale_segments();
+    LOG_INFO("按需转码：" << segments_.size() << "个切片，已生成" << ready << "个，"
+        << std::max(1, config_.JIT_WORKERS) << "个转码线程");
+
+    {
+        // 播放器总是先请求开头，提前生成
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < segments_.size() && i <= static_cast<size_t>(config_.JIT_PREFETCH_SEGMENTS); ++i) {
+            schedule(i, false);
+        }
+    }
+    for (int i = 0; i < std::max(1, config_.JIT_WORKERS); ++i) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+void JitTranscoder::stop() {
+    if (stopping_.exchange(true)) {
+        return;
+    }
+    cv_.notify_all();
+    // 正在转码的切片很短，等它写完
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+SegmentAvailability JitTranscoder::on_segment_request(const std::string& file_path) {
+    int64_t number = segment_number(file_path);
+    if (number < 0 || number >= static_cast<int64_t>(segments_.size())) {
+        return SegmentAvailability::Ready;
+    }
+    size_t index = static_cast<size_t>(number);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 顺序播放时提前准备后面的切片
+    for (size_t i = index + 1; i < segments_.size() && i <= index + config_.JIT_PREFETCH_SEGMENTS; ++i) {
+        schedule(i, false);
+    }
+    if (states_[index] == SegmentState::Ready) {
+        jit_metrics().hits.inc();
+        return SegmentAvailability::Ready;
+    }
+    schedule(index, true);
+    cv_.notify_all();
+    jit_metrics().misses.inc();
+    return SegmentAvailability::Pending;
+}
+
+SegmentAvailability JitTranscoder::segment_state(const std::string& file_path) {
+    int64_t number = segment_number(file_path);
+    if (number < 0 || number >= static_cast<int64_t>(segments_.size())) {
+        return SegmentAvailability::Ready;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (states_[number]) {
+    case SegmentState::Ready: return SegmentAvailability::Ready;
+    case SegmentState::Failed: return SegmentAvailability::Failed;
+    default: return SegmentAvailability::Pending;
+    }
+}
+
+void JitTranscoder::schedule(size_t index, bool demanded) {
+    SegmentState state = states_[index];
+    if (state == SegmentState::Ready || state == SegmentState::Running) {
+        return;
+    }
+    if (state == SegmentState::Failed && !demanded) {
+        return;     // 失败的切片只在再次被请求时重试
+    }
+    if (state == SegmentState::Queued && !demanded) {
+        return;
+    }
+    // 已作为预取排队的切片被请求时再压入一个高优先级的任务，旧任务出队时发现状态已变化而跳过
+    states_[index] = SegmentState::Queued;
+    tasks_.push_back(Task{ index, demanded, next_sequence_++ });
+    std::push_heap(tasks_.begin(), tasks_.end(), lower_priority<Task>);
+    cv_.notify_one();
+}
+
+void JitTranscoder::worker_loop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            std::pop_heap(tasks_.begin(), tasks_.end(), lower_priority<Task>);
+            task = tasks_.back();
+            tasks_.pop_back();
+            if (states_[task.index] != SegmentState::Queued) {
+                continue;
+            }
+            states_[task.index] = SegmentState::Running;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        bool ok = true;
+        try {
+            // FFmpeg的错误以异常抛出，只让这个切片失败，挂起的请求随即得到503
+            HLSGenerator generator(*worker_config_);
+            generator.render_segment(segments_[task.index], task.index);
+        }
+        catch (const std::exception& e) {
+            LOG_ERROR("按需转码切片" << task.index << "失败: " << e.what());
+            ok = false;
+        }
+        SegmentCheckpoint rendered = segments_[task.index];
+        if (ok && !CheckpointJournal::file_crc32(config_.HLS_DIR + "/" + rendered.filename, rendered.bytes, rendered.crc)) {
+            LOG_ERROR("按需转码切片" << task.index << "生成后无法读取");
+            ok = false;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        if (ok) {
+            jit_metrics().rendered.inc();
+            jit_metrics().render_seconds.observe(seconds);
+            LOG_DEBUG("按需转码切片" << task.index << (task.demanded ? "（请求）" : "（预取）") << "用时" << seconds << "秒");
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ok) {
+                segments_[task.index].bytes = rendered.bytes;
+                segments_[task.index].crc = rendered.crc;
+                append_rendered(task.index);
+            }
+            states_[task.index] = ok ? SegmentState::Ready : SegmentState::Failed;
+        }
+        // 状态更新之后再通知，收到通知时查询到的已是最终状态
+        if (output_listener_) {
+            output_listener_(config_.HLS_DIR + "/" + rendered.filename);
+        }
+    }
+}
+
+bool JitTranscoder::rendered_intact(const SegmentCheckpoint& segment) const {
+    if (segment.bytes == 0) {
+        return false;
+    }
+    std::string path = config_.HLS_DIR + "/" + segment.filename;
+    if (config_.CHECK_HLS_INTEGRITY) {
+        uint64_t bytes = 0;
+        uint32_t crc = 0;
+        return CheckpointJournal::file_crc32(path, bytes, crc) && bytes == segment.bytes && crc == segment.crc;
+    }
+    std::error_code ec;
+    return std::filesystem::file_size(path, ec) == segment.bytes && !ec;
+}
+
+void JitTranscoder::remove_stale_segments() {
+    size_t removed = 0;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(config_.HLS_DIR, ec)) {
+        int64_t number = segment_number(config_.HLS_DIR + "/" + entry.path().filename().string());
+        if (number < 0) {
+            continue;
+        }
+        if (number >= static_cast<int64_t>(states_.size()) || states_[number] != SegmentState::Ready) {
+            std::error_code remove_error;
+            if (std::filesystem::remove(entry.path(), remove_error)) {
+                removed++;
+            }
+        }
+    }
+    // 上次进程被杀时遗留的半成品
+    std::filesystem::remove_all(config_.HLS_DIR + "/.repair", ec);
+    if (removed > 0) {
+        LOG_INFO("删除" << removed << "个不属于当前关键帧索引的旧切片");
+    }
+}
+
+void JitTranscoder::append_rendered(size_t index) const {
+    // 调用方持有mutex_
+    const SegmentCheckpoint& segment = segments_[index];
+    std::ofstream out(config_.HLS_DIR + "/" + config_.M3U8_FILENAME + ".index", std::ios::app);
+    out << "rendered " << index << " " << segment.bytes << " " << segment.crc << "\n";
+}
+
+int64_t JitTranscoder::segment_number(const std::string& file_path) const {
+    // HttpServer拼出的路径是HLS_DIR + 请求路径
+    std::string prefix = config_.HLS_DIR + "/" + segment_prefix_;
+    if (!file_path.starts_with(prefix) || !file_path.ends_with(".ts")) {
+        return -1;
+    }
+    std::string digits = file_path.substr(prefix.size(), file_path.size() - prefix.size() - 3);
+    if (digits.empty() || digits.size() > 9 || !std::all_of(digits.begin(), digits.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return -1;
+    }
+    return std::stoll(digits);
+}
+
+bool JitTranscoder::load_index(const std::string& identity) {
+    std::ifstream index(config_.HLS_DIR + "/" + config_.M3U8_FILENAME + ".index");
+    std::string line;
+    if (!index.is_open() || !std::getline(index, line) || line != "identity " + identity) {
+        return false;
+    }
+    std::vector<SegmentCheckpoint> segments;
+    while (std::getline(index, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "segment") {
+            SegmentCheckpoint segment;
+            if (!(fields >> segment.filename >> segment.start >> segment.duration)) {
+                return false;
+            }
+            segments.push_back(std::move(segment));
+        }
+        else if (kind == "rendered") {
+            // 进程在追加时被杀可能留下不完整的最后一行，忽略即可（该切片会重新生成）
+            size_t number = 0;
+            uint64_t bytes = 0;
+            uint32_t crc = 0;
+            if (fields >> number >> bytes >> crc && number < segments.size()) {
+                segments[number].bytes = bytes;
+                segments[number].crc = crc;
+            }
+        }
+        else if (!kind.empty()) {
+            return false;
+        }
+    }
+    if (segments.empty()) {
+        return false;
+    }
+    segments_ = std::move(segments);
+    return true;
+}
+
+void JitTranscoder::build_index() {
+    // 只解复用视频流不解码，收集关键帧的时间；FFmpeg出错时抛出，由start()的调用方处理
+    AVFormatContext* input = nullptr;
+    int ret = avformat_open_input(&input, config_.VIDEO_PATH.c_str(), nullptr, nullptr);
+    check_ffmpeg_error(ret, "Failed to open input file for keyframe index:" + config_.VIDEO_PATH);
+    ret = avformat_find_stream_info(input, nullptr);
+    if (ret < 0) {
+        avformat_close_input(&input);
+    }
+    check_ffmpeg_error(ret, "Failed to find stream info for keyframe index");
+
+    // 与HLSGenerator一样取第一个视频流
+    int video = -1;
+    for (unsigned int i = 0; i < input->nb_streams; i++) {
+        if (video == -1 && input->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            video = static_cast<int>(i);
+        }
+        else {
+            input->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+    if (video == -1) {
+        avformat_close_input(&input);
+        throw std::runtime_error("No video stream found in input file");
+    }
+
+    // 时间相对视频流的start_time，与HLSGenerator续转/修复时的换算一致
+    AVStream* stream = input->streams[video];
+    int64_t origin = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    double time_base = av_q2d(stream->time_base);
+    std::vector<double> keyframes;
+    double end = 0;
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt) {
+        avformat_close_input(&input);
+        throw std::runtime_error("Failed to allocate AVPacket");
+    }
+    while (av_read_frame(input, pkt) >= 0) {
+        int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        if (pkt->stream_index == video && ts != AV_NOPTS_VALUE) {
+            double t = (ts - origin) * time_base;
+            if ((pkt->flags & AV_PKT_FLAG_KEY) && t > 0) {
+                keyframes.push_back(t);
+            }
+            end = std::max(end, t + pkt->duration * time_base);
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&input);
+
+    // 与hls muxer相同的规则：切片满HLS_SEGMENT_DURATION后在下一个关键帧处切开
+    std::sort(keyframes.begin(), keyframes.end());
+    segments_.clear();
+    double start = 0;
+    auto add_segment = [&](double until) {
+        SegmentCheckpoint segment;
+        segment.filename = segment_prefix_ + std::to_string(segments_.size()) + ".ts";
+        segment.start = start;
+        segment.duration = until - start;
+        segments_.push_back(std::move(segment));
+        start = until;
+    };
+    for (double keyframe : keyframes) {
+        if (keyframe - start >= config_.HLS_SEGMENT_DURATION) {
+            add_segment(keyframe);
+        }
+    }
+    if (end > start) {
+        add_segment(end);
+    }
+    if (segments_.empty()) {
+        throw std::runtime_error("Input has no video packets to index");
+    }
+}
+
+void JitTranscoder::save_index(const std::string& identity) const {
+    std::ostringstream index;
+    index << "identity " << identity << "\n";
+    char line[512];
+    for (const auto& segment : segments_) {
+        std::snprintf(line, sizeof(line), "segment %s %.6f %.6f\n", segment.filename.c_str(), segment.start, segment.duration);
+        index << line;
+    }
+    std::string path = config_.HLS_DIR + "/" + config_.M3U8_FILENAME + ".index";
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << index.str();
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        LOG_ERROR("写入关键帧索引失败: " << ec.message());
+    }
+}
+
+void JitTranscoder::write_playlist() const {
+    double target = 1;
+    for (const auto& segment : segments_) {
+        target = std::max(target, std::ceil(segment.duration));
+    }
+    std::ostringstream playlist;
+    playlist << "#EXTM3U\n";
+    playlist << "#EXT-X-VERSION:3\n";
+    playlist << "#EXT-X-TARGETDURATION:" << static_cast<int>(target) << "\n";
+    playlist << "#EXT-X-MEDIA-SEQUENCE:0\n";
+    playlist << "#EXT-X-PLAYLIST-TYPE:VOD\n";
+    char extinf[64];
+    for (const auto& segment : segments_) {
+        std::snprintf(extinf, sizeof(extinf), "#EXTINF:%.6f,\n", segment.duration);
+        playlist << extinf << segment.filename << "\n";
+    }
+    playlist << "#EXT-X-ENDLIST\n";
+
+    std::string playlist_path = config_.HLS_DIR + "/" + config_.M3U8_FILENAME;
+    std::string temp_path = playlist_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << playlist.str();
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, playlist_path, ec);
+    if (ec) {
+        LOG_ERROR("写入按需转码播放列表失败: " << ec.message());
+    }
+}
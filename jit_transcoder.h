@@ -0,0 +1,83 @@
+#pragma once
+#ifndef JIT_TRANSCODER_H
+#define JIT_TRANSCODER_H
+#include"config.h"
+#include"checkpoint_journal.h"
+#include"http_utils.h"
+#include<atomic>
+#include<condition_variable>
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+
+// 按需转码：启动时只扫描一遍输入的关键帧，按HLS_SEGMENT_DURATION在关键帧处划分切片并写出完整的VOD播放列表；
+// 切片在第一次被请求时才转码（每个切片由一个新的HLSGenerator寻址到起点、只转码这一段），
+// 同时预取其后的JIT_PREFETCH_SEGMENTS个切片。生成的切片留在HLS_DIR中，之后的请求直接命中磁盘与内存缓存
+class JitTranscoder {
+public:
+	explicit JitTranscoder(const Config& config);
+	~JitTranscoder();
+
+	// 加载或重建关键帧索引，写出播放列表，启动工作线程并预取开头的切片
+	void start();
+	void stop();
+
+	// HttpServer收到切片请求时调用，不阻塞：
+	// 该切片还没生成时安排转码（上次失败的重新安排）并返回Pending；不是本索引中的切片或已生成时返回Ready
+	SegmentAvailability on_segment_request(const std::string& file_path);
+	// 挂起的请求轮询时调用，只查询不安排转码：转码失败返回Failed
+	SegmentAvailability segment_state(const std::string& file_path);
+
+	size_t segment_count() const { return segments_.size(); }
+	// 在start()之前设置：每次生成一个切片（成功或失败）并更新状态后以其路径调用，在工作线程上调用
+	void set_output_listener(std::function<void(const std::string&)> listener) { output_listener_ = std::move(listener); }
+
+private:
+	enum class SegmentState : uint8_t { Missing, Queued, Running, Ready, Failed };
+
+	struct Task {
+		size_t index = 0;
+		bool demanded = false;	// 有请求在等待，优先于预取
+		uint64_t sequence = 0;
+	};
+
+	// 索引文件HLS_DIR/<M3U8_FILENAME>.index，文本逐行：
+	//   identity <与转码清单相同的身份>
+	//   segment <文件名> <起始秒> <时长>
+	//   rendered <切片编号> <字节数> <crc32>	（切片生成后追加）
+	// 身份变化（输入内容或参数改变）时重建，之前生成的切片全部作废
+	bool load_index(const std::string& identity);
+	void build_index();
+	void save_index(const std::string& identity) const;
+	void write_playlist() const;
+	// 切片文件名中的编号；不是本播放列表的切片时返回-1
+	int64_t segment_number(const std::string& file_path) const;
+	// 切片按本索引生成过，且文件大小（CHECK_HLS_INTEGRITY时还有CRC32）与记录一致
+	bool rendered_intact(const SegmentCheckpoint& segment) const;
+	// 删除HLS_DIR中不是Ready状态的同名切片文件
+	void remove_stale_segments();
+	// 以下调用方持有mutex_
+	void append_rendered(size_t index) const;
+	void schedule(size_t index, bool demanded);
+	void worker_loop();
+
+	const Config& config_;
+	std::unique_ptr<Config> worker_config_;	// 工作线程的生成器使用，线程预算按工作线程数均分
+	std::string segment_prefix_;			// 播放列表文件名去掉扩展名，与hls muxer默认的切片命名一致
+	std::vector<SegmentCheckpoint> segments_;
+
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::vector<SegmentState> states_;
+	std::vector<Task> tasks_;	// 堆：被请求的在前，同类中先到的在前
+	uint64_t next_sequence_ = 0;
+	std::vector<std::thread> workers_;
+	std::atomic<bool> stopping_{ false };
+	std::function<void(const std::string&)> output_listener_;
+};
+
+#endif // !JIT_TRANSCODER_H
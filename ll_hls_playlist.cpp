@@ -0,0 +1,228 @@
+#include "ll_hls_playlist.h"
+#include "logger.h"
+#include<fstream>
+#include<sstream>
+#include<filesystem>
+#include<cmath>
+#include<cstdio>
+#include<algorithm>
+#include<cctype>
+
+LLPlaylistState parse_ll_playlist_state(const std::string& body) {
+    LLPlaylistState state;
+    std::istringstream stream(body);
+    std::string line;
+    int64_t media_sequence = 0;
+    int64_t segment_count = 0;
+    int pending_parts = 0;
+
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        if (line.rfind("#EXTM3U", 0) == 0) {
+            state.valid = true;
+        }
+        else if (line.rfind("#EXT-X-MEDIA-SEQUENCE:", 0) == 0) {
+            media_sequence = std::stoll(line.substr(22));
+        }
+        else if (line.rfind("#EXT-X-TARGETDURATION:", 0) == 0) {
+            state.target_duration = std::stod(line.substr(22));
+        }
+        else if (line.rfind("#EXT-X-PART:", 0) == 0) {
+            pending_parts++;
+        }
+        else if (line.rfind("#EXT-X-ENDLIST", 0) == 0) {
+            state.ended = true;
+        }
+        else if (line.rfind("#EXT-X-PRELOAD-HINT:", 0) == 0) {
+            size_t uri_begin = line.find("URI=\"");
+            if (uri_begin != std::string::npos) {
+                uri_begin += 5;
+                size_t uri_end = line.find('"', uri_begin);
+                state.preload_part = part_number_from_uri(line.substr(uri_begin, uri_end - uri_begin));
+            }
+        }
+        else if (line[0] != '#') {
+            // 完整切片的URI，之前的EXT-X-PART都属于该切片
+            segment_count++;
+            pending_parts = 0;
+        }
+    }
+
+    state.last_complete_msn = media_sequence + segment_count - 1;
+    state.next_part_count = pending_parts;
+    return state;
+}
+
+int64_t part_number_from_uri(const std::string& uri) {
+    size_t end = uri.rfind('.');
+    if (end == std::string::npos) end = uri.size();
+    size_t begin = end;
+    while (begin > 0 && std::isdigit(static_cast<unsigned char>(uri[begin - 1]))) {
+        begin--;
+    }
+    if (begin == end) return -1;
+    return std::stoll(uri.substr(begin, end - begin));
+}
+
+LLHLSPlaylist::LLHLSPlaylist(const Config& config)
+    : config_(config) {
+}
+
+void LLHLSPlaylist::update_from_part_playlist(const std::string& part_playlist_path) {
+    std::ifstream in(part_playlist_path);
+    if (!in.is_open()) {
+        LOG_ERROR("无法打开partial segment列表: " << part_playlist_path);
+        return;
+    }
+
+    std::string line;
+    int64_t sequence = 0;
+    double duration = 0;
+    bool have_duration = false;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        if (line.rfind("#EXT-X-MEDIA-SEQUENCE:", 0) == 0) {
+            sequence = std::stoll(line.substr(22));
+        }
+        else if (line.rfind("#EXTINF:", 0) == 0) {
+            duration = std::stod(line.substr(8));
+            have_duration = true;
+        }
+        else if (line[0] != '#' && have_duration) {
+            // muxer的列表只保留最近几项，按序号跳过已经发布过的
+            if (sequence > last_part_sequence_) {
+                add_part(Part{ line, duration });
+                last_part_sequence_ = sequence;
+            }
+            sequence++;
+            have_duration = false;
+        }
+    }
+
+    write_playlist();
+}
+
+void LLHLSPlaylist::finish() {
+    if (!current_.parts.empty()) {
+        close_current_segment();
+    }
+    ended_ = true;
+    write_playlist();
+}
+
+void LLHLSPlaylist::add_part(const Part& part) {
+    if (part.duration > config_.LL_HLS_PART_DURATION * 1.5) {
+        LOG_WARN("partial segment时长" << part.duration << "s超过PART-TARGET，关键帧间隔可能过大");
+    }
+    max_part_duration_ = std::max(max_part_duration_, part.duration);
+
+    // 再加入该part会超过目标时长时，先结束当前切片；切片总是从独立可解码的part开始
+    if (!current_.parts.empty() && current_.duration + part.duration > config_.HLS_SEGMENT_DURATION + 0.001) {
+        close_current_segment();
+    }
+    current_.parts.push_back(part);
+    current_.duration += part.duration;
+}
+
+void LLHLSPlaylist::close_current_segment() {
+    current_.uri = "seg" + std::to_string(next_segment_number_++) + ".ts";
+
+    // 各part本身是完整的TS片段，按顺序拼接即得到完整切片；先写临时文件再改名，避免被读到半个文件
+    std::string segment_path = config_.HLS_DIR + "/" + current_.uri;
+    std::string temp_path = segment_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        for (const auto& part : current_.parts) {
+            std::ifstream in(config_.HLS_DIR + "/" + part.uri, std::ios::binary);
+            if (!in.is_open()) {
+                LOG_ERROR("无法读取partial segment: " << part.uri);
+                continue;
+            }
+            out << in.rdbuf();
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, segment_path, ec);
+    if (ec) {
+        LOG_ERROR("切片改名失败: " << segment_path << " " << ec.message());
+    }
+
+    segments_.push_back(std::move(current_));
+    current_ = Segment{};
+}
+
+void LLHLSPlaylist::write_playlist() {
+    const double part_target = config_.LL_HLS_PART_DURATION;
+    double max_segment_duration = config_.HLS_SEGMENT_DURATION;
+    for (const auto& segment : segments_) {
+        max_segment_duration = std::max(max_segment_duration, segment.duration);
+    }
+    const int target_duration = static_cast<int>(std::ceil(max_segment_duration));
+
+    // 只为距离末尾3个目标时长以内的切片列出partial segment
+    size_t first_part_segment = segments_.size();
+    double tail_duration = current_.duration;
+    while (first_part_segment > 0 &&
+        tail_duration + segments_[first_part_segment - 1].duration <= 3.0 * target_duration) {
+        first_part_segment--;
+        tail_duration += segments_[first_part_segment].duration;
+    }
+
+    char number[32];
+    auto format_duration = [&number](double value) {
+        std::snprintf(number, sizeof(number), "%.5f", value);
+        return std::string(number);
+    };
+
+    std::ostringstream playlist;
+    playlist << "#EXTM3U\n"
+        << "#EXT-X-VERSION:6\n"
+        << "#EXT-X-TARGETDURATION:" << target_duration << "\n";
+    if (!ended_) {
+        playlist << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK="
+            << format_duration(3.0 * part_target) << "\n";
+    }
+    playlist << "#EXT-X-PART-INF:PART-TARGET=" << format_duration(part_target) << "\n"
+        << "#EXT-X-MEDIA-SEQUENCE:0\n";
+
+    auto write_parts = [&](const Segment& segment) {
+        for (const auto& part : segment.parts) {
+            playlist << "#EXT-X-PART:DURATION=" << format_duration(part.duration)
+                << ",URI=\"" << part.uri << "\",INDEPENDENT=YES\n";
+        }
+    };
+
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (i >= first_part_segment) {
+            write_parts(segments_[i]);
+        }
+        playlist << "#EXTINF:" << format_duration(segments_[i].duration) << ",\n"
+            << segments_[i].uri << "\n";
+    }
+
+    if (ended_) {
+        playlist << "#EXT-X-ENDLIST\n";
+    }
+    else {
+        write_parts(current_);
+        // 预告下一个part，客户端可提前发起请求，由服务器挂起到文件生成
+        playlist << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << config_.LL_HLS_PART_PREFIX
+            << (last_part_sequence_ + 1) << ".ts\"\n";
+    }
+
+    std::string playlist_path = config_.HLS_DIR + "/" + config_.M3U8_FILENAME;
+    std::string temp_path = playlist_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << playlist.str();
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, playlist_path, ec);
+    if (ec) {
+        LOG_ERROR("写入LL-HLS播放列表失败: " << ec.message());
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef LL_HLS_PLAYLIST_H
+#define LL_HLS_PLAYLIST_H
+#include"config.h"
+#include<string>
+#include<vector>
+#include<cstdint>
+
+// 播放列表中与阻塞式刷新相关的状态
+struct LLPlaylistState {
+	bool valid = false;
+	bool ended = false;
+	int64_t last_complete_msn = -1;	// 最后一个完整切片的序号，-1表示还没有
+	int next_part_count = 0;		// 下一个（未完成）切片已有的partial segment数
+	int64_t preload_part = -1;		// EXT-X-PRELOAD-HINT指向的part编号，该编号及之后的part尚未写完
+	double target_duration = 0;
+};
+
+LLPlaylistState parse_ll_playlist_state(const std::string& body);
+// 从"part12.ts"这类URI中取出编号，没有编号时返回-1
+int64_t part_number_from_uri(const std::string& uri);
+
+// 低延迟HLS播放列表生成器
+// muxer按LL_HLS_PART_DURATION切出短切片，这里把它们作为EXT-X-PART发布，
+// 并在凑满HLS_SEGMENT_DURATION后拼接成完整切片写入EXTINF条目
+class LLHLSPlaylist {
+public:
+	explicit LLHLSPlaylist(const Config& config);
+
+	// 读取muxer维护的短切片播放列表，发布其中新完成的部分
+	void update_from_part_playlist(const std::string& part_playlist_path);
+	// 输入结束：收尾当前切片并写入EXT-X-ENDLIST
+	void finish();
+
+private:
+	struct Part {
+		std::string uri;
+		double duration = 0;
+	};
+	struct Segment {
+		std::string uri;
+		double duration = 0;
+		std::vector<Part> parts;
+	};
+
+	void add_part(const Part& part);
+	void close_current_segment();
+	void write_playlist();
+
+	const Config& config_;
+	std::vector<Segment> segments_;
+	Segment current_;
+	int64_t last_part_sequence_ = -1;
+	int next_segment_number_ = 0;
+	double max_part_duration_ = 0;
+	bool ended_ = false;
+};
+
+#endif // !LL_HLS_PLAYLIST_H
@@ -0,0 +1,195 @@
+#include "logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+    const char* level_name(LogLevel level) {
+        switch (level) {
+        case LogLevel::Trace: return "TRACE";
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+        case LogLevel::Error: return "ERROR";
+        default: return "";
+        }
+    }
+
+    uint32_t current_thread_number() {
+        // 按首次写日志的顺序给线程编号，比打印std::thread::id更易读
+        static std::atomic<uint32_t> next{ 1 };
+        thread_local uint32_t number = next.fetch_add(1, std::memory_order_relaxed);
+        return number;
+    }
+}
+
+bool LogSiteLimiter::allow(uint32_t per_second, uint64_t& suppressed) {
+    if (per_second == 0) {
+        return true;
+    }
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t window = window_.load(std::memory_order_relaxed);
+    if (window != now && window_.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        count_.store(0, std::memory_order_relaxed);
+    }
+    if (count_.fetch_add(1, std::memory_order_relaxed) < per_second) {
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : slots_(new Slot[LOG_RING_SLOTS]) {
+    static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+    for (size_t i = 0; i < LOG_RING_SLOTS; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Logger::write(LogLevel level, const char* text, size_t length, uint64_t suppressed) {
+    // 有界MPMC队列（Vyukov）的入队：槽位序号等于写位置时可占用，小于写位置说明已满
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    while (true) {
+        slot = &slots_[pos & (LOG_RING_SLOTS - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    Record& record = slot->record;
+    record.time = std::chrono::system_clock::now();
+    record.level = level;
+    record.thread = current_thread_number();
+    record.suppressed = suppressed;
+    record.length = static_cast<uint16_t>(std::min(length, LOG_MESSAGE_BYTES));
+    std::memcpy(record.text, text, record.length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (consumer_waiting_.load(std::memory_order_acquire)) {
+        wake_cv_.notify_one();
+    }
+}
+
+void Logger::flush() {
+    size_t target = enqueue_pos_.load(std::memory_order_acquire);
+    while (written_.load(std::memory_order_acquire) < target) {
+        wake_cv_.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (true) {
+        lock.unlock();
+        size_t printed = drain();
+        lock.lock();
+        if (printed > 0) {
+            continue;
+        }
+        if (stopping_) {
+            break;
+        }
+        // 生产者只在消费者等待时才notify；错过的唤醒由超时兜底
+        consumer_waiting_.store(true, std::memory_order_release);
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(50), [this]() {
+            const Slot& slot = slots_[dequeue_pos_ & (LOG_RING_SLOTS - 1)];
+            return stopping_ || slot.sequence.load(std::memory_order_acquire) == dequeue_pos_ + 1;
+            });
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+    }
+    lock.unlock();
+    drain();
+}
+
+size_t Logger::drain() {
+    size_t printed = 0;
+    while (true) {
+        Slot& slot = slots_[dequeue_pos_ & (LOG_RING_SLOTS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+            break;
+        }
+        print(slot.record);
+        // 释放槽位给下一轮的生产者
+        slot.sequence.store(dequeue_pos_ + LOG_RING_SLOTS, std::memory_order_release);
+        ++dequeue_pos_;
+        ++printed;
+    }
+
+    uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        std::fprintf(stderr, "[logger] %llu messages dropped, ring buffer full\n",
+            static_cast<unsigned long long>(dropped));
+    }
+    if (printed > 0 || dropped > 0) {
+        std::fflush(stdout);
+        std::fflush(stderr);
+    }
+    written_.store(dequeue_pos_, std::memory_order_release);
+    return printed;
+}
+
+void Logger::print(const Record& record) {
+    std::time_t seconds = std::chrono::system_clock::to_time_t(record.time);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+        record.time.time_since_epoch()).count() % 1000;
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+
+    std::FILE* out = record.level >= LogLevel::Warn ? stderr : stdout;
+    std::fprintf(out, "%s.%03d [%s] [T%u] %.*s", stamp, static_cast<int>(millis), level_name(record.level),
+        record.thread, static_cast<int>(record.length), record.text);
+    if (record.suppressed > 0) {
+        std::fprintf(out, " (%llu similar messages suppressed)", static_cast<unsigned long long>(record.suppressed));
+    }
+    std::fputc('\n', out);
+}
+
+LogMessage::LogMessage(LogLevel level, uint64_t suppressed)
+    : level_(level)
+    , suppressed_(suppressed)
+    , stream_(&buffer_) {
+}
+
+LogMessage::~LogMessage() {
+    Logger::instance().write(level_, buffer_.data(), buffer_.size(), suppressed_);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+
+enum class LogLevel { Trace = 0, Debug = 1, Info = 2, Warn = 3, Error = 4, Off = 5 };
+
+// 编译期阈值：低于该级别的日志语句整个被编译掉（表达式仍做类型检查，但不生成代码）
+// Release构建默认去掉Trace/Debug，可用 -DHLS_LOG_COMPILE_LEVEL=0 保留全部
+#ifndef HLS_LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define HLS_LOG_COMPILE_LEVEL 2
+#else
+#define HLS_LOG_COMPILE_LEVEL 0
+#endif
+#endif
+
+constexpr size_t LOG_MESSAGE_BYTES = 480;      // 单条日志正文上限，超出部分截断
+constexpr size_t LOG_RING_SLOTS = 4096;        // 环形缓冲槽位数（2的幂），写满时丢弃新日志
+constexpr uint32_t LOG_DEFAULT_SITE_RATE = 20; // 每个日志语句每秒最多输出的条数，0表示不限
+
+// 单个日志语句的限流状态，由宏为每个调用点生成一个静态实例
+class LogSiteLimiter {
+public:
+    // 允许输出时返回true，并通过suppressed带出上次输出以来被丢弃的条数
+    bool allow(uint32_t per_second, uint64_t& suppressed);
+
+private:
+    std::atomic<int64_t> window_{ -1 };
+    std::atomic<uint32_t> count_{ 0 };
+    std::atomic<uint64_t> suppressed_{ 0 };
+};
+
+// 异步日志：生产者把格式化好的日志写入无锁多生产者单消费者环形缓冲，
+// 后台线程批量写到stdout（Warn及以上写stderr），热路径上不做控制台I/O也不加锁
+class Logger {
+public:
+    static Logger& instance();
+
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+    void set_level(LogLevel level) { level_.store(static_cast<int>(level), std::memory_order_relaxed); }
+    uint32_t site_rate() const { return site_rate_.load(std::memory_order_relaxed); }
+    void set_site_rate(uint32_t per_second) { site_rate_.store(per_second, std::memory_order_relaxed); }
+
+    // 写入一条日志；缓冲区已满时丢弃并计数，从不阻塞调用方
+    void write(LogLevel level, const char* text, size_t length, uint64_t suppressed = 0);
+    // 等待此前写入的日志全部输出，用于进程退出前
+    void flush();
+
+private:
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        LogLevel level = LogLevel::Info;
+        uint32_t thread = 0;
+        uint64_t suppressed = 0;
+        uint16_t length = 0;
+        char text[LOG_MESSAGE_BYTES];
+    };
+
+    struct Slot {
+        std::atomic<size_t> sequence{ 0 };
+        Record record;
+    };
+
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void run();
+    size_t drain();
+    static void print(const Record& record);
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> enqueue_pos_{ 0 };
+    alignas(64) size_t dequeue_pos_ = 0;          // 只由后台线程访问
+    std::atomic<size_t> written_{ 0 };            // 已输出到的位置，供flush等待
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<int> level_{ static_cast<int>(LogLevel::Info) };
+    std::atomic<uint32_t> site_rate_{ LOG_DEFAULT_SITE_RATE };
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::atomic<bool> consumer_waiting_{ false };
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// 在栈上的定长缓冲区里格式化一条日志，析构时提交给Logger，不分配堆内存
+class LogMessage {
+public:
+    LogMessage(LogLevel level, uint64_t suppressed);
+    ~LogMessage();
+    std::ostream& stream() { return stream_; }
+
+private:
+    class FixedBuffer : public std::streambuf {
+    public:
+        FixedBuffer() { setp(data_, data_ + sizeof(data_)); }
+        size_t size() const { return static_cast<size_t>(pptr() - pbase()); }
+        const char* data() const { return data_; }
+    protected:
+        int_type overflow(int_type c) override { return traits_type::not_eof(c); }   // 超长部分丢弃
+    private:
+        char data_[LOG_MESSAGE_BYTES];
+    };
+
+    LogLevel level_;
+    uint64_t suppressed_;
+    FixedBuffer buffer_;
+    std::ostream stream_;
+};
+
+// 用法：LOG_INFO("Request: " << method << " " << path);
+#define HLS_LOG(level, ...)                                                                  \
+    do {                                                                                     \
+        if constexpr (static_cast<int>(level) >= HLS_LOG_COMPILE_LEVEL) {                    \
+            if (Logger::instance().enabled(level)) {                                         \
+                static LogSiteLimiter hls_log_site_;                                         \
+                uint64_t hls_log_suppressed_ = 0;                                            \
+                if (hls_log_site_.allow(Logger::instance().site_rate(), hls_log_suppressed_)) { \
+                    LogMessage hls_log_message_(level, hls_log_suppressed_);                 \
+                    hls_log_message_.stream() << __VA_ARGS__;                                \
+                }                                                                            \
+            }                                                                                \
+        }                                                                                    \
+    } while (0)
+
+#define LOG_TRACE(...) HLS_LOG(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) HLS_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) HLS_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) HLS_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) HLS_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif // LOGGER_H
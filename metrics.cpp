@@ -0,0 +1,148 @@
+#include "metrics.h"
+#include "logger.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+    void atomic_add(std::atomic<double>& target, double delta) {
+        double current = target.load(std::memory_order_relaxed);
+        while (!target.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::string format_value(double value) {
+        if (std::isinf(value)) {
+            return value > 0 ? "+Inf" : "-Inf";
+        }
+        std::ostringstream stream;
+        stream.precision(10);
+        stream << value;
+        return stream.str();
+    }
+
+    // 在已有标签后追加le标签
+    std::string with_le(const std::string& labels, const std::string& le) {
+        return "{" + labels + (labels.empty() ? "" : ",") + "le=\"" + le + "\"}";
+    }
+
+    std::string wrap_labels(const std::string& labels) {
+        return labels.empty() ? "" : "{" + labels + "}";
+    }
+}
+
+void Metrics::Gauge::add(double delta) {
+    atomic_add(value_, delta);
+}
+
+Metrics::Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds))
+    , buckets_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+    std::sort(bounds_.begin(), bounds_.end());
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::Histogram::observe(double value) {
+    size_t index = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    buckets_[index].fetch_add(1, std::memory_order_relaxed);
+    atomic_add(sum_, value);
+}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Series& Metrics::find_or_add(const std::string& name, const std::string& help, Type type,
+    const std::string& labels) {
+    auto family = std::find_if(families_.begin(), families_.end(),
+        [&name](const Family& f) { return f.name == name; });
+    if (family == families_.end()) {
+        families_.push_back(Family{ name, help, type, {} });
+        family = families_.end() - 1;
+    }
+    else if (family->type != type) {
+        LOG_ERROR("Metric " << name << " registered with conflicting types");
+    }
+
+    for (auto& series : family->series) {
+        if (series.labels == labels) {
+            return series;
+        }
+    }
+    family->series.push_back(Series{ labels, nullptr, nullptr, nullptr });
+    return family->series.back();
+}
+
+Metrics::Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = find_or_add(name, help, Type::Counter, labels);
+    if (!series.counter) {
+        series.counter = std::make_unique<Counter>();
+    }
+    return *series.counter;
+}
+
+Metrics::Gauge& Metrics::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = find_or_add(name, help, Type::Gauge, labels);
+    if (!series.gauge) {
+        series.gauge = std::make_unique<Gauge>();
+    }
+    return *series.gauge;
+}
+
+Metrics::Histogram& Metrics::histogram(const std::string& name, const std::string& help,
+    const std::vector<double>& bounds, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = find_or_add(name, help, Type::Histogram, labels);
+    if (!series.histogram) {
+        series.histogram = std::make_unique<Histogram>(bounds);
+    }
+    return *series.histogram;
+}
+
+std::vector<double> Metrics::latency_buckets() {
+    return { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+}
+
+std::vector<double> Metrics::size_buckets() {
+    return { 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304 };
+}
+
+std::string Metrics::render() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+
+    for (const auto& family : families_) {
+        const char* type_name = family.type == Type::Counter ? "counter"
+            : family.type == Type::Gauge ? "gauge" : "histogram";
+        out << "# HELP " << family.name << " " << family.help << "\n"
+            << "# TYPE " << family.name << " " << type_name << "\n";
+
+        for (const auto& series : family.series) {
+            if (series.counter) {
+                out << family.name << wrap_labels(series.labels) << " " << series.counter->value() << "\n";
+            }
+            else if (series.gauge) {
+                out << family.name << wrap_labels(series.labels) << " " << format_value(series.gauge->value()) << "\n";
+            }
+            else if (series.histogram) {
+                const Histogram& histogram = *series.histogram;
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < histogram.bounds().size(); ++i) {
+                    cumulative += histogram.bucket_count(i);
+                    out << family.name << "_bucket" << with_le(series.labels, format_value(histogram.bounds()[i]))
+                        << " " << cumulative << "\n";
+                }
+                cumulative += histogram.bucket_count(histogram.bounds().size());
+                out << family.name << "_bucket" << with_le(series.labels, "+Inf") << " " << cumulative << "\n"
+                    << family.name << "_sum" << wrap_labels(series.labels) << " " << format_value(histogram.sum()) << "\n"
+                    << family.name << "_count" << wrap_labels(series.labels) << " " << cumulative << "\n";
+            }
+        }
+    }
+    return out.str();
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 进程内指标注册表，按Prometheus文本格式导出
+// 注册需要加锁，只在初始化时做一次；调用方保存返回的引用，之后的更新只有原子操作
+class Metrics {
+public:
+    class Counter {
+    public:
+        void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+    private:
+        std::atomic<uint64_t> value_{ 0 };
+    };
+
+    class Gauge {
+    public:
+        void set(double value) { value_.store(value, std::memory_order_relaxed); }
+        void add(double delta);
+        double value() const { return value_.load(std::memory_order_relaxed); }
+    private:
+        std::atomic<double> value_{ 0 };
+    };
+
+    // 固定桶直方图，桶上界在注册时确定
+    class Histogram {
+    public:
+        explicit Histogram(std::vector<double> bounds);
+        void observe(double value);
+
+        const std::vector<double>& bounds() const { return bounds_; }
+        uint64_t bucket_count(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+        double sum() const { return sum_.load(std::memory_order_relaxed); }
+    private:
+        std::vector<double> bounds_;
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets_;   // 每桶的非累计计数，最后一桶为+Inf
+        std::atomic<double> sum_{ 0 };
+    };
+
+    static Metrics& instance();
+
+    // labels为Prometheus标签串，如 code="200"；同名同标签重复注册返回同一个对象
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help,
+        const std::vector<double>& bounds, const std::string& labels = "");
+
+    // 延迟（秒）直方图的默认桶：0.5ms ~ 10s
+    static std::vector<double> latency_buckets();
+    // 字节数直方图的默认桶：256B ~ 4MB
+    static std::vector<double> size_buckets();
+
+    std::string render() const;
+
+private:
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::deque<Series> series;
+    };
+
+    Series& find_or_add(const std::string& name, const std::string& help, Type type, const std::string& labels);
+
+    mutable std::mutex mutex_;
+    std::deque<Family> families_;   // 按注册顺序输出
+};
+
+#endif // METRICS_H
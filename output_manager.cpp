@@ -1,5 +1,46 @@
 #include "output_manager.h"
-#include<iostream>
+#include "metrics.h"
+#include "logger.h"
+#include<chrono>
+
+namespace {
+    // 写出指标：output区分本地文件与RTMP推流
+    struct OutputMetrics {
+        Metrics::Counter& packets;
+        Metrics::Counter& failures;
+        Metrics::Histogram& write_seconds;
+
+        explicit OutputMetrics(const std::string& output)
+            : packets(Metrics::instance().counter("recorder_output_packets_total",
+                "Packets written to the muxer", "output=\"" + output + "\""))
+            , failures(Metrics::instance().counter("recorder_output_write_failures_total",
+                "Failed muxer writes", "output=\"" + output + "\""))
+            , write_seconds(Metrics::instance().histogram("recorder_output_write_seconds",
+                "av_interleaved_write_frame latency", Metrics::latency_buckets(), "output=\"" + output + "\"")) {
+        }
+    };
+
+    OutputMetrics& output_metrics(bool stream) {
+        static OutputMetrics file_metrics("file");
+        static OutputMetrics stream_metrics("stream");
+        return stream ? stream_metrics : file_metrics;
+    }
+
+    // 计时写入一个包并记录结果
+    int timed_write(AVFormatContext* fmt_ctx, AVPacket* pkt, bool stream) {
+        OutputMetrics& metrics = output_metrics(stream);
+        auto start = std::chrono::steady_clock::now();
+        int ret = av_interleaved_write_frame(fmt_ctx, pkt);
+        metrics.write_seconds.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        if (ret < 0) {
+            metrics.failures.inc();
+        }
+        else {
+            metrics.packets.inc();
+        }
+        return ret;
+    }
+}
 
 OutputManager::OutputManager(){
     avformat_network_init();
@@ -68,7 +109,7 @@ bool OutputManager::initializeStreamOutput(const std::string& rtmp_url,const Enc
     rtmp_url_ = rtmp_url;
     config_ = config;
 
-    std::cout << "Initializing stream output to: " << rtmp_url_ << std::endl;
+    LOG_INFO("Initializing stream output to: " << rtmp_url_);
 
     // 如果编码器已经设置，立即设置流输出
     if (encoder_) {
@@ -81,7 +122,7 @@ bool OutputManager::initializeStreamOutput(const std::string& rtmp_url,const Enc
 void OutputManager::setEncoder(std::shared_ptr<Encoder> encoder){
     
     if (encoder_ == encoder) {
-        std::cout << "Encoder already set, skipping..." << std::endl;
+        LOG_INFO("Encoder already set, skipping...");
         return;
     }
 
@@ -102,22 +143,22 @@ void OutputManager::setEncoder(std::shared_ptr<Encoder> encoder){
 }
 
 void OutputManager::setAudioEncoder(std::shared_ptr<Encoder> audio_encoder){
-    std::cout << "=== OutputManager::setAudioEncoder ===" << std::endl;
-    std::cout << "Current audio_encoder_: " << audio_encoder_.get() << std::endl;
-    std::cout << "New audio_encoder: " << audio_encoder.get() << std::endl;
+    LOG_INFO("=== OutputManager::setAudioEncoder ===");
+    LOG_INFO("Current audio_encoder_: " << audio_encoder_.get());
+    LOG_INFO("New audio_encoder: " << audio_encoder.get());
 
     if(audio_encoder_==audio_encoder){
-        std::cout<<"Audio encoder already set, skipping..."<<std::endl;
+        LOG_INFO("Audio encoder already set, skipping...");
         return;
     }
     audio_encoder_=audio_encoder;
     if(audio_encoder_){
-        std::cout<<"Setting audio encoder callback..."<<std::endl;
+        LOG_INFO("Setting audio encoder callback...");
         audio_encoder_->addAudioPacketCallback([this](AVPacket* packet){
-            std::cout<<"====AUDIO CALLBACK TRIGGERED==="<<std::endl;
+            LOG_TRACE("====AUDIO CALLBACK TRIGGERED===");
             onAudioEncodedPacket(packet);
         });
-        std::cout<<"Audio encoder callback set"<<std::endl;
+        LOG_INFO("Audio encoder callback set");
 
         if(!filename_.empty()&&!file_fmt_ctx_){
             setupFileOutput();
@@ -126,16 +167,16 @@ void OutputManager::setAudioEncoder(std::shared_ptr<Encoder> audio_encoder){
             setupStreamOutput();
         }
     }else{
-        std::cout<<"Audio encoder is null,clearing callback"<<std::endl;
+        LOG_INFO("Audio encoder is null,clearing callback");
     }
-    std::cout<<"===setAudioEncoder END==="<<std::endl;
+    LOG_INFO("===setAudioEncoder END===");
 }
 
 
 
 bool OutputManager::start() {
     if (!encoder_) {
-        std::cerr << "Encoder not set" << std::endl;
+        LOG_ERROR("Encoder not set");
         return false;
     }
     if(encoder_)
@@ -149,22 +190,22 @@ bool OutputManager::start() {
     
     bool success = true;
 
-    std::cout << "OutputManager::start() - file_fmt_ctx_: " << (file_fmt_ctx_ ? "valid" : "null")
-        << ", stream_fmt_ctx_: " << (stream_fmt_ctx_ ? "valid" : "null") << std::endl;
+    LOG_INFO("OutputManager::start() - file_fmt_ctx_: " << (file_fmt_ctx_ ? "valid" : "null")
+        << ", stream_fmt_ctx_: " << (stream_fmt_ctx_ ? "valid" : "null"));
 
     // 文件输出
     if (file_fmt_ctx_ && !recording_) {
-        std::cout << "Writing header for file output..." << std::endl;
+        LOG_INFO("Writing header for file output...");
 
         if (encoder_ && file_video_stream_) {
             auto* codec_ctx = encoder_->getCodecContext();
             if (codec_ctx) {
                 int ret = avcodec_parameters_from_context(file_video_stream_->codecpar, codec_ctx);
                 if (ret < 0) {
-                    std::cerr << "Failed to copy video codec parameters to file stream in start()" << std::endl;
+                    LOG_ERROR("Failed to copy video codec parameters to file stream in start()");
                 }
                 else {
-                    std::cout << "Successfully copied video codec parameters to file stream" << std::endl;
+                    LOG_INFO("Successfully copied video codec parameters to file stream");
                 }
                 file_video_stream_->time_base = codec_ctx->time_base;
             }
@@ -175,10 +216,10 @@ bool OutputManager::start() {
             if (audio_codec_ctx) {
                 int ret = avcodec_parameters_from_context(file_audio_stream_->codecpar, audio_codec_ctx);
                 if (ret < 0) {
-                    std::cerr << "Failed to copy codec parameters to file stream" << std::endl;
+                    LOG_ERROR("Failed to copy codec parameters to file stream");
                 }
                 else {
-                    std::cout << "Successfully copied audio codec parameters to file stream" << std::endl;
+                    LOG_INFO("Successfully copied audio codec parameters to file stream");
                 }
                 file_audio_stream_->time_base = audio_codec_ctx->time_base;
             }
@@ -188,20 +229,20 @@ bool OutputManager::start() {
         if (ret < 0) {
             char error[AV_ERROR_MAX_STRING_SIZE];
             av_make_error_string(error, sizeof(error), ret);
-            std::cerr << "Failed to write header for file output: " << error << std::endl;
+            LOG_ERROR("Failed to write header for file output: " << error);
             success = false;
         }
         else {
             recording_ = true;
-            std::cout << "✓ Start recording to file: " << filename_ << std::endl;
+            LOG_INFO("✓ Start recording to file: " << filename_);
             if (file_video_stream_) {
-                std::cout << "Video stream time_base: " << file_video_stream_->time_base.num
-                    << "/" << file_video_stream_->time_base.den << std::endl;
+                LOG_INFO("Video stream time_base: " << file_video_stream_->time_base.num
+                    << "/" << file_video_stream_->time_base.den);
             }
             /*
             if (file_audio_stream_) {
-                std::cout << "Audio stream time_base: " << file_audio_stream_->time_base.num
-                    << "/" << file_audio_stream_->time_base.den << std::endl;
+                LOG_INFO("Audio stream time_base: " << file_audio_stream_->time_base.num
+                    << "/" << file_audio_stream_->time_base.den);
             }
             */
         }
@@ -209,7 +250,7 @@ bool OutputManager::start() {
 
     // 流输出
     if (stream_fmt_ctx_ && !streaming_) {
-        std::cout << "Writing header for stream output..." << std::endl;
+        LOG_INFO("Writing header for stream output...");
 
         // 设置视频流参数
         if (encoder_ && stream_video_stream_) {
@@ -217,10 +258,10 @@ bool OutputManager::start() {
             if (codec_ctx) {
                 int ret = avcodec_parameters_from_context(stream_video_stream_->codecpar, codec_ctx);
                 if (ret < 0) {
-                    std::cerr << "Failed to copy video codec parameters to stream in start()" << std::endl;
+                    LOG_ERROR("Failed to copy video codec parameters to stream in start()");
                 }
                 else {
-                    std::cout << "Successfully copied video codec parameters to stream" << std::endl;
+                    LOG_INFO("Successfully copied video codec parameters to stream");
                 }
                 stream_video_stream_->time_base = codec_ctx->time_base;
             }
@@ -232,10 +273,10 @@ bool OutputManager::start() {
             if (audio_codec_ctx) {
                 int ret = avcodec_parameters_from_context(stream_audio_stream_->codecpar, audio_codec_ctx);
                 if (ret < 0) {
-                    std::cerr << "Failed to copy audio codec parameters to stream in start()" << std::endl;
+                    LOG_ERROR("Failed to copy audio codec parameters to stream in start()");
                 }
                 else {
-                    std::cout << "Successfully copied audio codec parameters to stream" << std::endl;
+                    LOG_INFO("Successfully copied audio codec parameters to stream");
                 }
                 stream_audio_stream_->time_base = {1, audio_codec_ctx->sample_rate};
             }
@@ -245,20 +286,20 @@ bool OutputManager::start() {
         if (ret < 0) {
             char error[AV_ERROR_MAX_STRING_SIZE];
             av_make_error_string(error, sizeof(error), ret);
-            std::cerr << "Failed to write header for stream output: " << error << std::endl;
+            LOG_ERROR("Failed to write header for stream output: " << error);
             success = false;
         }
         else {
             streaming_ = true;
-            std::cout << "✓ Start streaming to: " << rtmp_url_ << std::endl;
+            LOG_INFO("✓ Start streaming to: " << rtmp_url_);
             if (stream_video_stream_) {
-                std::cout << "Video stream time_base after header: " << stream_video_stream_->time_base.num
-                    << "/" << stream_video_stream_->time_base.den << std::endl;
+                LOG_INFO("Video stream time_base after header: " << stream_video_stream_->time_base.num
+                    << "/" << stream_video_stream_->time_base.den);
             }
             /*
             if (stream_audio_stream_) {
-                std::cout << "Audio stream time_base after header: " << stream_audio_stream_->time_base.num
-                    << "/" << stream_audio_stream_->time_base.den << std::endl;
+                LOG_INFO("Audio stream time_base after header: " << stream_audio_stream_->time_base.num
+                    << "/" << stream_audio_stream_->time_base.den);
             }
             */
         }
@@ -271,7 +312,7 @@ void OutputManager::stop(){
     
 
     if (recording_ && file_fmt_ctx_) {
-        std::cout << "Writing trailer for file output..." << std::endl;
+        LOG_INFO("Writing trailer for file output...");
         av_write_trailer(file_fmt_ctx_);
         if (file_fmt_ctx_->pb) {
             avio_closep(&file_fmt_ctx_->pb);
@@ -281,11 +322,11 @@ void OutputManager::stop(){
         file_video_stream_ = nullptr;
         file_audio_stream_ = nullptr;
         recording_ = false;
-        std::cout << "Stop recording" << std::endl;
+        LOG_INFO("Stop recording");
     }
 
     if (streaming_ && stream_fmt_ctx_) {
-        std::cout << "Writing trailer for stream output..." << std::endl;
+        LOG_INFO("Writing trailer for stream output...");
         av_write_trailer(stream_fmt_ctx_);
         if (stream_fmt_ctx_->pb) {
             avio_closep(&stream_fmt_ctx_->pb);
@@ -295,31 +336,31 @@ void OutputManager::stop(){
         stream_video_stream_ = nullptr;
         stream_audio_stream_ = nullptr;
         streaming_ = false;
-        std::cout << "Stop streaming" << std::endl;
+        LOG_INFO("Stop streaming");
     }
 }
 
 
 bool OutputManager::setupFileOutput(){
 
-    std::cout << "Setting up file output: " << filename_ << std::endl;
+    LOG_INFO("Setting up file output: " << filename_);
 
     if (file_fmt_ctx_) {
-        std::cout << "Warning: file_fmt_ctx_ already exists, cleaning up" << std::endl;
+        LOG_WARN("Warning: file_fmt_ctx_ already exists, cleaning up");
         avformat_free_context(file_fmt_ctx_);
         file_fmt_ctx_ = nullptr;
     }
 
     int ret=avformat_alloc_output_context2(&file_fmt_ctx_,nullptr,"mp4",filename_.c_str());
     if(ret<0||!file_fmt_ctx_){
-        std::cerr<<"Failed to allocate output context for file output"<<std::endl;
+        LOG_ERROR("Failed to allocate output context for file output");
         return false;
     }
 
     if(encoder_){
         file_video_stream_ = avformat_new_stream(file_fmt_ctx_,nullptr);
         if(!file_video_stream_){
-            std::cerr<<"Failed to create file stream"<<std::endl;
+            LOG_ERROR("Failed to create file stream");
             return false;
         }
         file_video_stream_->id = file_fmt_ctx_->nb_streams-1;
@@ -330,7 +371,7 @@ bool OutputManager::setupFileOutput(){
         if (codec_ctx) {
             ret = avcodec_parameters_from_context(file_video_stream_->codecpar, codec_ctx);
             if (ret < 0) {
-                std::cerr << "Failed to copy codec parameters to file stream" << std::endl;
+                LOG_ERROR("Failed to copy codec parameters to file stream");
                 return false;
             }
         }
@@ -339,7 +380,7 @@ bool OutputManager::setupFileOutput(){
     if(audio_encoder_){
         file_audio_stream_ = avformat_new_stream(file_fmt_ctx_,nullptr);
         if(!file_audio_stream_){
-            std::cerr<<"Failed to create file stream"<<std::endl;
+            LOG_ERROR("Failed to create file stream");
             return false;
         }
         file_audio_stream_->id = file_fmt_ctx_->nb_streams-1;
@@ -348,7 +389,7 @@ bool OutputManager::setupFileOutput(){
         if(audio_codec_ctx){
             ret=avcodec_parameters_from_context(file_audio_stream_->codecpar,audio_codec_ctx);
             if(ret<0){
-                std::cerr<<"Failed to copy codec parameters to file stream"<<std::endl; 
+                LOG_ERROR("Failed to copy codec parameters to file stream"); 
                 return false;
             }
             file_audio_stream_->time_base=audio_codec_ctx->time_base;
@@ -359,21 +400,21 @@ bool OutputManager::setupFileOutput(){
     if(!(file_fmt_ctx_->oformat->flags&AVFMT_NOFILE)){
         ret=avio_open(&file_fmt_ctx_->pb,filename_.c_str(),AVIO_FLAG_WRITE);
         if(ret<0){
-            std::cerr<<"Failed to open file for writing"<<std::endl;
+            LOG_ERROR("Failed to open file for writing");
             return false;
         }
     }
 
-    std::cout<<"File output initialized:"<<filename_<<std::endl;
+    LOG_INFO("File output initialized:"<<filename_);
 
     if (file_video_stream_) {
-        std::cout << "  Video stream: " << file_video_stream_->codecpar->width << "x" 
-                  << file_video_stream_->codecpar->height << std::endl;
+        LOG_INFO("  Video stream: " << file_video_stream_->codecpar->width << "x" 
+                  << file_video_stream_->codecpar->height);
     }
     /*
     if (file_audio_stream_) {
-        std::cout << "  Audio stream: " << file_audio_stream_->codecpar->sample_rate << "Hz, "
-                  << file_audio_stream_->codecpar->ch_layout.nb_channels << " channels" << std::endl;
+        LOG_INFO("  Audio stream: " << file_audio_stream_->codecpar->sample_rate << "Hz, "
+                  << file_audio_stream_->codecpar->ch_layout.nb_channels << " channels");
     }
     */
    
@@ -381,12 +422,12 @@ bool OutputManager::setupFileOutput(){
 }
 
 bool OutputManager::setupStreamOutput() {
-    std::cout << "=== SETUP STREAM OUTPUT DEBUG ===" << std::endl;
-    std::cout << "RTMP URL: " << rtmp_url_ << std::endl;
-    std::cout << "Encoder available: " << (encoder_ ? "YES" : "NO") << std::endl;
+    LOG_INFO("=== SETUP STREAM OUTPUT DEBUG ===");
+    LOG_INFO("RTMP URL: " << rtmp_url_);
+    LOG_INFO("Encoder available: " << (encoder_ ? "YES" : "NO"));
     
     if (!encoder_) {
-        std::cerr << "ERROR: Encoder is not set before setupStreamOutput" << std::endl;
+        LOG_ERROR("ERROR: Encoder is not set before setupStreamOutput");
         return false;
     }
     
@@ -395,7 +436,7 @@ bool OutputManager::setupStreamOutput() {
     if (ret < 0 || !stream_fmt_ctx_) {
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error, sizeof(error), ret);
-        std::cerr << "Failed to create stream output context: " << error << std::endl;
+        LOG_ERROR("Failed to create stream output context: " << error);
         return false;
     }
 
@@ -403,7 +444,7 @@ bool OutputManager::setupStreamOutput() {
     if(encoder_){
         stream_video_stream_ = avformat_new_stream(stream_fmt_ctx_, nullptr);
         if (!stream_video_stream_) {
-            std::cerr << "Failed to create stream stream" << std::endl;
+            LOG_ERROR("Failed to create stream stream");
             return false;
         }
 
@@ -414,7 +455,7 @@ bool OutputManager::setupStreamOutput() {
             // 复制编码器参数
             ret = avcodec_parameters_from_context(stream_video_stream_->codecpar, codec_ctx);
             if (ret < 0) {
-                std::cerr << "Failed to copy codec parameters to stream" << std::endl;
+                LOG_ERROR("Failed to copy codec parameters to stream");
                 return false;
             }
             stream_video_stream_->time_base = {1,1000};
@@ -425,7 +466,7 @@ bool OutputManager::setupStreamOutput() {
     if(audio_encoder_){
         stream_audio_stream_=avformat_new_stream(stream_fmt_ctx_,nullptr);
         if(!stream_audio_stream_){
-            std::cerr<<"Failed to create stream stream"<<std::endl;
+            LOG_ERROR("Failed to create stream stream");
             return false;
         }
         stream_audio_stream_->id = stream_fmt_ctx_->nb_streams-1;
@@ -434,7 +475,7 @@ bool OutputManager::setupStreamOutput() {
         if(audio_codec_ctx){
             ret=avcodec_parameters_from_context(stream_audio_stream_->codecpar,audio_codec_ctx);
             if(ret<0){
-                std::cerr<<"Failed to copy codec parameters to stream"<<std::endl;
+                LOG_ERROR("Failed to copy codec parameters to stream");
                 return false;
             }
             stream_audio_stream_->time_base = {1,audio_codec_ctx->sample_rate};
@@ -442,19 +483,19 @@ bool OutputManager::setupStreamOutput() {
     }
     */
     // 显示流信息
-    std::cout << "Stream parameters:" << std::endl;
+    LOG_INFO("Stream parameters:");
     if (stream_video_stream_) {
-        std::cout << "  Video: " << stream_video_stream_->codecpar->width << "x" 
+        LOG_INFO("  Video: " << stream_video_stream_->codecpar->width << "x" 
                   << stream_video_stream_->codecpar->height 
                   << ", time_base: " << stream_video_stream_->time_base.num 
-                  << "/" << stream_video_stream_->time_base.den << std::endl;
+                  << "/" << stream_video_stream_->time_base.den);
     }
     /*
     if (stream_audio_stream_) {
-        std::cout << "  Audio: " << stream_audio_stream_->codecpar->sample_rate << "Hz, "
+        LOG_INFO("  Audio: " << stream_audio_stream_->codecpar->sample_rate << "Hz, "
                   << stream_audio_stream_->codecpar->ch_layout.nb_channels << " channels"
                   << ", time_base: " << stream_audio_stream_->time_base.num 
-                  << "/" << stream_audio_stream_->time_base.den << std::endl;
+                  << "/" << stream_audio_stream_->time_base.den);
     }
     */
     // 网络选项
@@ -464,7 +505,7 @@ bool OutputManager::setupStreamOutput() {
     av_dict_set(&options, "buffer_size", "65536", 0);
 
     // 打开输出
-    std::cout << "Opening stream output to: " << rtmp_url_ << std::endl;
+    LOG_INFO("Opening stream output to: " << rtmp_url_);
 
     if (!(stream_fmt_ctx_->oformat->flags & AVFMT_NOFILE)) {
         ret = avio_open2(&stream_fmt_ctx_->pb, rtmp_url_.c_str(), AVIO_FLAG_WRITE, nullptr, &options);
@@ -473,7 +514,7 @@ bool OutputManager::setupStreamOutput() {
         if (ret < 0) {
             char error[AV_ERROR_MAX_STRING_SIZE];
             av_make_error_string(error, sizeof(error), ret);
-            std::cerr << "Failed to open stream for writing: " << error << std::endl;
+            LOG_ERROR("Failed to open stream for writing: " << error);
 
             // 清理资源
             avformat_free_context(stream_fmt_ctx_);
@@ -484,7 +525,7 @@ bool OutputManager::setupStreamOutput() {
         }
     }
 
-    std::cout << "✓ Stream output initialized successfully: " << rtmp_url_ << std::endl;
+    LOG_INFO("✓ Stream output initialized successfully: " << rtmp_url_);
     return true;
 }
 
@@ -495,78 +536,63 @@ void OutputManager::onEncodedPacket(AVPacket* packet) {
     }
 
      // 添加包信息调试
-    std::cout << "=== PACKET INFO ===" << std::endl;
-    std::cout << "Packet size: " << packet->size << ", PTS: " << packet->pts 
+    LOG_DEBUG("=== PACKET INFO ===");
+    LOG_DEBUG("Packet size: " << packet->size << ", PTS: " << packet->pts 
               << ", DTS: " << packet->dts << ", Duration: " << packet->duration 
-              << ", Keyframe: " << (packet->flags & AV_PKT_FLAG_KEY ? "YES" : "NO") << std::endl;
+              << ", Keyframe: " << (packet->flags & AV_PKT_FLAG_KEY ? "YES" : "NO"));
 
     // 为文件输出写入包
+    // writePacket内部为每个输出引用一次数据，这里不再克隆
     if (recording_ && file_fmt_ctx_ && file_video_stream_) {
-        AVPacket* file_packet = av_packet_clone(packet);
-        if (file_packet) {
-            if (writePacket(file_packet, file_fmt_ctx_, file_video_stream_)) {
-                std::cout << "✓ Successfully wrote packet to file" << std::endl;
-            }
-            av_packet_free(&file_packet);
+        if (writePacket(packet, file_fmt_ctx_, file_video_stream_)) {
+            LOG_DEBUG("✓ Successfully wrote packet to file");
         }
     }
 
     // 为流输出写入包
     if (streaming_ && stream_fmt_ctx_ && stream_video_stream_) {
-        AVPacket* stream_packet = av_packet_clone(packet);
-        if (stream_packet) {
-            if (writePacket(stream_packet, stream_fmt_ctx_, stream_video_stream_)) {
-                std::cout << "✓ Successfully wrote packet to stream" << std::endl;
-            }
-            else {
-                std::cerr << "✗ Failed to write packet to stream" << std::endl;
-                std::cerr << "Streaming status: " << streaming_ << std::endl;
-                std::cerr << "Stream format context: " << (stream_fmt_ctx_ ? "valid" : "null") << std::endl;
-                std::cerr << "Video stream: " << (stream_video_stream_ ? "valid" : "null") << std::endl;
-                std::cerr << "Stream write failed, but keeping streaming enabled for retry" << std::endl;
-                //streaming_ = false;
-            }
-            av_packet_free(&stream_packet);
+        if (writePacket(packet, stream_fmt_ctx_, stream_video_stream_)) {
+            LOG_DEBUG("✓ Successfully wrote packet to stream");
+        }
+        else {
+            LOG_ERROR("✗ Failed to write packet to stream");
+            LOG_ERROR("Streaming status: " << streaming_);
+            LOG_ERROR("Stream format context: " << (stream_fmt_ctx_ ? "valid" : "null"));
+            LOG_ERROR("Video stream: " << (stream_video_stream_ ? "valid" : "null"));
+            LOG_ERROR("Stream write failed, but keeping streaming enabled for retry");
+            //streaming_ = false;
         }
     }
 }
 
 void OutputManager::onAudioEncodedPacket(AVPacket* packet) {
     if(!packet || packet->size <= 0){
-        std::cout << "OutputManager: received empty audio packet, ignoring" << std::endl;
+        LOG_DEBUG("OutputManager: received empty audio packet, ignoring");
         return;
     }
 
     // 详细的调试信息
-    std::cout << "=== AUDIO PACKET RECEIVED ===" << std::endl;
-    std::cout << "Size: " << packet->size << ", PTS: " << packet->pts 
-              << ", DTS: " << packet->dts << ", Duration: " << packet->duration << std::endl;
-    std::cout << "Recording: " << recording_ << ", FileCtx: " << (file_fmt_ctx_ ? "valid" : "null")
-              << ", AudioStream: " << (file_audio_stream_ ? "valid" : "null") << std::endl;
+    LOG_DEBUG("=== AUDIO PACKET RECEIVED ===");
+    LOG_DEBUG("Size: " << packet->size << ", PTS: " << packet->pts 
+              << ", DTS: " << packet->dts << ", Duration: " << packet->duration);
+    LOG_DEBUG("Recording: " << recording_ << ", FileCtx: " << (file_fmt_ctx_ ? "valid" : "null")
+              << ", AudioStream: " << (file_audio_stream_ ? "valid" : "null"));
 
     if(recording_&&file_fmt_ctx_&&file_audio_stream_){
-        AVPacket* file_packet = av_packet_clone(packet);
-        if(file_packet){
-            if(writeAudioPacket(file_packet,file_fmt_ctx_,file_audio_stream_)){
-                std::cout<<"✓ Successfully wrote audio packet to file"<<std::endl;
-            }
-            av_packet_free(&file_packet);
+        if(writeAudioPacket(packet,file_fmt_ctx_,file_audio_stream_)){
+            LOG_DEBUG("✓ Successfully wrote audio packet to file");
         }
-        if (!recording_) std::cout << "OutputManager: not recording" << std::endl;
-        if (!file_fmt_ctx_) std::cout << "OutputManager: file_fmt_ctx_ is null" << std::endl;
-        if (!file_audio_stream_) std::cout << "OutputManager: file_audio_stream_ is null" << std::endl;
+        if (!recording_) LOG_DEBUG("OutputManager: not recording");
+        if (!file_fmt_ctx_) LOG_DEBUG("OutputManager: file_fmt_ctx_ is null");
+        if (!file_audio_stream_) LOG_DEBUG("OutputManager: file_audio_stream_ is null");
     }
 
     if(streaming_&&stream_fmt_ctx_&&stream_audio_stream_){
-        AVPacket* stream_packet = av_packet_clone(packet);
-        if(stream_packet){
-            if(writeAudioPacket(stream_packet,stream_fmt_ctx_,stream_audio_stream_)){
-                std::cout<<"✓ Successfully wrote audio packet to stream"<<std::endl;
-            }
-            else{
-                std::cerr<<"Stream write failed, disabling streaming"<<std::endl;
-            }
-            av_packet_free(&stream_packet);
+        if(writeAudioPacket(packet,stream_fmt_ctx_,stream_audio_stream_)){
+            LOG_DEBUG("✓ Successfully wrote audio packet to stream");
+        }
+        else{
+            LOG_ERROR("Stream write failed, disabling streaming");
         }
     }
 }
@@ -578,8 +604,9 @@ bool OutputManager::writePacket(AVPacket* packet, AVFormatContext* fmt_ctx, AVSt
         return false;
     }
 
-    AVPacket* pkt = av_packet_clone(packet);
-    if (!pkt) {
+    // 从池中借一个包引用编码输出的数据：只增加引用计数，muxer写入时取走这份引用
+    Packet pkt = packet_pool_.acquire();
+    if (av_packet_ref(pkt, packet) < 0) {
         return false;
     }
 
@@ -591,34 +618,34 @@ bool OutputManager::writePacket(AVPacket* packet, AVFormatContext* fmt_ctx, AVSt
         AVRational src_time_base = codec_ctx->time_base;
         AVRational dst_time_base = stream->time_base;
 
-         std::cout << "Timebase conversion - SRC: " << src_time_base.num << "/" << src_time_base.den
-                  << " -> DST: " << dst_time_base.num << "/" << dst_time_base.den << std::endl;
-        std::cout << "Original PTS: " << pkt->pts << ", DTS: " << pkt->dts << std::endl;
+         LOG_DEBUG("Timebase conversion - SRC: " << src_time_base.num << "/" << src_time_base.den
+                  << " -> DST: " << dst_time_base.num << "/" << dst_time_base.den);
+        LOG_DEBUG("Original PTS: " << pkt->pts << ", DTS: " << pkt->dts);
 
         pkt->pts = av_rescale_q(pkt->pts, src_time_base, dst_time_base);
         pkt->dts = av_rescale_q(pkt->dts, src_time_base, dst_time_base);
         if (pkt->duration > 0) {
             pkt->duration = av_rescale_q(pkt->duration, src_time_base, dst_time_base);
         }
-        std::cout << "Converted PTS: " << pkt->pts << ", DTS: " << pkt->dts << std::endl;
+        LOG_DEBUG("Converted PTS: " << pkt->pts << ", DTS: " << pkt->dts);
     }
 
     // 写入包
-    int ret = av_interleaved_write_frame(fmt_ctx, pkt);
-    av_packet_free(&pkt);
+    int ret = timed_write(fmt_ctx, pkt, fmt_ctx == stream_fmt_ctx_);
+    pkt.reset();
 
     if (ret < 0) {
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error, sizeof(error), ret);
-        std::cerr << "Failed to write packet: Error number " << ret << " occurred" << std::endl;
-        std::cerr << "Error details: " << error << std::endl;
+        LOG_ERROR("Failed to write packet: Error number " << ret << " occurred");
+        LOG_ERROR("Error details: " << error);
         
         // 添加详细的错误分析
         if (ret == -10053) {
-            std::cerr << "ERROR -10053: Connection reset by peer. This usually means:" << std::endl;
-            std::cerr << "1. The RTMP server rejected the stream format" << std::endl;
-            std::cerr << "2. There are incompatible codec parameters" << std::endl;
-            std::cerr << "3. The server closed the connection due to invalid data" << std::endl;
+            LOG_ERROR("ERROR -10053: Connection reset by peer. This usually means:");
+            LOG_ERROR("1. The RTMP server rejected the stream format");
+            LOG_ERROR("2. There are incompatible codec parameters");
+            LOG_ERROR("3. The server closed the connection due to invalid data");
         }
         return false;
     }
@@ -628,20 +655,20 @@ bool OutputManager::writePacket(AVPacket* packet, AVFormatContext* fmt_ctx, AVSt
 
 bool OutputManager::writeAudioPacket(AVPacket* packet,AVFormatContext* fmt_ctx,AVStream* stream) {
     if(!fmt_ctx || !stream || !packet || packet->size <= 0) {
-        std::cerr << "writeAudioPacket: invalid parameters" << std::endl;
+        LOG_ERROR("writeAudioPacket: invalid parameters");
         return false;
     }
     
-    AVPacket* pkt = av_packet_clone(packet);
-    if (!pkt) {
-        std::cerr << "writeAudioPacket: failed to clone packet" << std::endl;
+    Packet pkt = packet_pool_.acquire();
+    if (av_packet_ref(pkt, packet) < 0) {
+        LOG_ERROR("writeAudioPacket: failed to reference packet");
         return false;
     }
 
     pkt->stream_index = stream->index;
 
-    std::cout << "writeAudioPacket: stream_index=" << pkt->stream_index 
-              << ", original PTS=" << pkt->pts << std::endl;
+    LOG_DEBUG("writeAudioPacket: stream_index=" << pkt->stream_index 
+              << ", original PTS=" << pkt->pts);
 
     // 时间戳处理 - 从编码器时间基转换到输出流时间基
     auto* audio_codec_ctx = audio_encoder_->getAudioCodecContext();
@@ -649,14 +676,13 @@ bool OutputManager::writeAudioPacket(AVPacket* packet,AVFormatContext* fmt_ctx,A
         AVRational src_time_base = audio_codec_ctx->time_base;
         AVRational dst_time_base = stream->time_base;
 
-        std::cout << "Timebase - SRC: " << src_time_base.num << "/" << src_time_base.den
-                  << ", DST: " << dst_time_base.num << "/" << dst_time_base.den << std::endl;
+        LOG_DEBUG("Timebase - SRC: " << src_time_base.num << "/" << src_time_base.den
+                  << ", DST: " << dst_time_base.num << "/" << dst_time_base.den);
 
         if (pkt->pts != AV_NOPTS_VALUE && pkt->pts >= 0) {
             pkt->pts = av_rescale_q(pkt->pts, src_time_base, dst_time_base);
         } else {
-            std::cerr << "Invalid audio PTS in packet" << std::endl;
-            av_packet_free(&pkt);
+            LOG_ERROR("Invalid audio PTS in packet");
             return false;
         }
 
@@ -675,28 +701,27 @@ bool OutputManager::writeAudioPacket(AVPacket* packet,AVFormatContext* fmt_ctx,A
             pkt->duration = av_rescale_q(pkt->duration, src_time_base, dst_time_base);
         }
         
-        std::cout << "Audio packet - PTS: " << pkt->pts 
+        LOG_DEBUG("Audio packet - PTS: " << pkt->pts 
                   << ", DTS: " << pkt->dts
-                  << ", Duration: " << pkt->duration << std::endl;
+                  << ", Duration: " << pkt->duration);
     } else {
-        std::cerr << "writeAudioPacket: audio codec context is null" << std::endl;
-        av_packet_free(&pkt);
+        LOG_ERROR("writeAudioPacket: audio codec context is null");
         return false;
     }
 
     // 写入包
-    std::cout << "Calling av_interleaved_write_frame..." << std::endl;
-    int ret = av_interleaved_write_frame(fmt_ctx, pkt);
-    av_packet_free(&pkt);
+    LOG_DEBUG("Calling av_interleaved_write_frame...");
+    int ret = timed_write(fmt_ctx, pkt, fmt_ctx == stream_fmt_ctx_);
+    pkt.reset();
 
     if(ret < 0) {
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error, sizeof(error), ret);
-        std::cerr << "Failed to write audio packet: " << error << std::endl;
+        LOG_ERROR("Failed to write audio packet: " << error);
         return false;
     }
 
-    std::cout << "✓ Successfully wrote audio packet" << std::endl;
+    LOG_DEBUG("✓ Successfully wrote audio packet");
     return true;
 }
 
@@ -716,13 +741,13 @@ void OutputManager::reset() {
     stream_video_stream_ = nullptr;
     stream_audio_stream_ = nullptr;
 
-    std::cout << "OutputManager reset completed" << std::endl;
+    LOG_INFO("OutputManager reset completed");
 }
 
 
 
 bool OutputManager::testRTMPConnection(const std::string& url) {
-    std::cout << "Testing RTMP connection to: " << url << std::endl;
+    LOG_INFO("Testing RTMP connection to: " << url);
 
     AVFormatContext* fmt_ctx = nullptr;
     AVDictionary* options = nullptr;
@@ -736,14 +761,14 @@ bool OutputManager::testRTMPConnection(const std::string& url) {
     av_dict_free(&options);
 
     if (ret >= 0) {
-        std::cout << "✓ RTMP connection test successful" << std::endl;
+        LOG_INFO("✓ RTMP connection test successful");
         avformat_close_input(&fmt_ctx);
         return true;
     }
     else {
         char error[AV_ERROR_MAX_STRING_SIZE];
         av_make_error_string(error, sizeof(error), ret);
-        std::cerr << "✗ RTMP connection test failed: " << error << std::endl;
+        LOG_ERROR("✗ RTMP connection test failed: " << error);
         return false;
     }
 }
\ No newline at end of file
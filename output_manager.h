@@ -53,4 +53,5 @@ class OutputManager {
     std::atomic<bool> streaming_{false};
     
     EncoderConfig config_;
+    PacketPool packet_pool_;    // 写入各输出时引用编码包用，音视频两个编码线程共用
 };
\ No newline at end of file
@@ -1,10 +1,27 @@
 #include "screen_recorder.h"
-#include<iostream>
+#include "metrics.h"
+#include "logger.h"
 #include<chrono>
 #include<filesystem>
 #include<iomanip>
 #include<sstream>
 
+namespace {
+    struct RecorderMetrics {
+        Metrics::Counter& captured = Metrics::instance().counter("recorder_captured_frames_total",
+            "Frames delivered by the capture callback");
+        Metrics::Counter& dropped = Metrics::instance().counter("recorder_dropped_frames_total",
+            "Frames dropped because the encode queue was full");
+        Metrics::Gauge& queue_depth = Metrics::instance().gauge("recorder_frame_queue_depth",
+            "Frames waiting in the encode queue");
+    };
+
+    RecorderMetrics& recorder_metrics() {
+        static RecorderMetrics metrics;
+        return metrics;
+    }
+}
+
 ScreenRecorder::ScreenRecorder()=default;
 ScreenRecorder::~ScreenRecorder(){
     stop();
@@ -25,7 +42,7 @@ bool ScreenRecorder::initialize(const RecordConfig& config) {
         // 初始化视频编码器
         encoder_ = std::make_shared<Encoder>();
         if (!encoder_->initialize(config.encoder_config)) {
-            std::cerr << "Failed to initialize encoder" << std::endl;
+            LOG_ERROR("Failed to initialize encoder");
             return false;
         }
 
@@ -61,21 +78,21 @@ bool ScreenRecorder::initialize(const RecordConfig& config) {
                     int ret = av_frame_get_buffer(audio_frame_, 0);
                     if(ret >= 0){
                         audio_initialized = true;
-                        std::cout << "Audio system initialized successfully" << std::endl;
-                        std::cout << "  Frame size: " << audio_frame_->nb_samples << " samples" << std::endl;
-                        std::cout << "  Sample rate: " << audio_frame_->sample_rate << "Hz" << std::endl;
+                        LOG_INFO("Audio system initialized successfully");
+                        LOG_INFO("  Frame size: " << audio_frame_->nb_samples << " samples");
+                        LOG_INFO("  Sample rate: " << audio_frame_->sample_rate << "Hz");
                     } else {
-                        std::cerr << "Failed to allocate audio frame buffer" << std::endl;
+                        LOG_ERROR("Failed to allocate audio frame buffer");
                     }
                 }
             } else {
-                std::cerr << "Failed to initialize audio capture - continuing without audio" << std::endl;
+                LOG_WARN("Failed to initialize audio capture - continuing without audio");
             }
             
             // 设置音频编码器到输出管理器
             output_manager_.setAudioEncoder(audio_encoder_);
         } else {
-            std::cerr << "Failed to initialize audio encoder - continuing without audio" << std::endl;
+            LOG_WARN("Failed to initialize audio encoder - continuing without audio");
         }
 
         if (!audio_initialized) {
@@ -90,7 +107,7 @@ bool ScreenRecorder::initialize(const RecordConfig& config) {
         // 初始化输出
         if (config.stream_to_rtmp) {
             if (!output_manager_.initializeStreamOutput(config.rtmp_url, config.encoder_config)) {
-                std::cerr << "Failed to initialize stream output" << std::endl;
+                LOG_ERROR("Failed to initialize stream output");
                 return false;
             }
         }
@@ -100,23 +117,27 @@ bool ScreenRecorder::initialize(const RecordConfig& config) {
         // 初始化视频捕获
         capture_ = std::make_unique<DXGICapture>(config.capture_config);
         capture_->set_frame_callback([this](const VideoFrame& frame) {
-            std::cout << "Capture callback: received frame " << frame.width << "x" << frame.height
-                << ", data size: " << frame.data.size() << std::endl;
+            LOG_TRACE("Capture callback: received frame " << frame.width << "x" << frame.height
+                << ", data size: " << frame.data.size());
 
             std::unique_lock<std::mutex> lock(frame_mutex_);
 
             if (!running_) {
-                std::cout << "Capture callback: recorder not running, ignoring frame" << std::endl;
+                LOG_DEBUG("Capture callback: recorder not running, ignoring frame");
                 return;
             }
 
+            RecorderMetrics& metrics = recorder_metrics();
+            metrics.captured.inc();
             if (frame_queue_.size() >= MAX_QUEUE_SIZE) {
-                std::cout << "Capture callback: queue full, dropping oldest frame" << std::endl;
+                LOG_WARN("Capture callback: queue full, dropping oldest frame");
                 frame_queue_.pop();
+                metrics.dropped.inc();
             }
 
             frame_queue_.push(frame);
-            std::cout << "Capture callback: queued frame, queue size: " << frame_queue_.size() << std::endl;
+            metrics.queue_depth.set(static_cast<double>(frame_queue_.size()));
+            LOG_TRACE("Capture callback: queued frame, queue size: " << frame_queue_.size());
             frame_cv_.notify_one();
         });
 
@@ -129,16 +150,16 @@ bool ScreenRecorder::initialize(const RecordConfig& config) {
 
         int ret = av_frame_get_buffer(av_frame_, 0);
         if (ret < 0) {
-            std::cerr << "Failed to allocate frame buffer" << std::endl;
+            LOG_ERROR("Failed to allocate frame buffer");
             return false;
         }
 
-        std::cout << "Screen recorder initialized successfully" << std::endl;
+        LOG_INFO("Screen recorder initialized successfully");
         return true;
 
     }
     catch (const std::exception& e) {
-        std::cerr << "Failed to initialize screen recorder: " << e.what() << std::endl;
+        LOG_ERROR("Failed to initialize screen recorder: " << e.what());
         return false;
     }
 }
@@ -148,7 +169,7 @@ bool ScreenRecorder::start(){
         return true;
     }
     
-    std::cout<<"Starting screen recorder..."<<std::endl;
+    LOG_INFO("Starting screen recorder...");
 
     // 启动TimeManager
     TimeManager::instance().startRecording();
@@ -167,7 +188,7 @@ bool ScreenRecorder::start(){
 
     // 重新初始化音频捕获
     if (audio_capture_ && !audio_capture_->reinitialize()) {
-        std::cerr << "Failed to reinitialize audio capture - continuing without audio" << std::endl;
+        LOG_WARN("Failed to reinitialize audio capture - continuing without audio");
         audio_capture_.reset();
         audio_encoder_.reset();
     }
@@ -177,10 +198,10 @@ bool ScreenRecorder::start(){
     // 重新初始化编码器
     if (encoder_) {
         if (!encoder_->reinitialize()) {
-            std::cerr << "Failed to reinitialize encoder" << std::endl;
+            LOG_ERROR("Failed to reinitialize encoder");
             return false;
         }
-        std::cout << "Encoder reinitialized successfully" << std::endl;
+        LOG_INFO("Encoder reinitialized successfully");
     }
 
     /*
@@ -200,7 +221,7 @@ bool ScreenRecorder::start(){
         }
 
         if (!output_manager_.initializeFileOutput(new_output_path_, config_.encoder_config)) {
-            std::cerr << "Failed to initialize file output in start()" << std::endl;
+            LOG_ERROR("Failed to initialize file output in start()");
             return false;
         }
     }
@@ -208,7 +229,7 @@ bool ScreenRecorder::start(){
     // 设置流输出
     if (config_.stream_to_rtmp) {
         if (!output_manager_.initializeStreamOutput(config_.rtmp_url, config_.encoder_config)) {
-            std::cerr << "Failed to re-initialize stream output" << std::endl;
+            LOG_ERROR("Failed to re-initialize stream output");
             return false;
         }
     }
@@ -218,7 +239,7 @@ bool ScreenRecorder::start(){
     //output_manager_.setAudioEncoder(audio_encoder_);
 
     if (!output_manager_.start()) {
-        std::cerr << "Failed to start output manager" << std::endl;
+        LOG_ERROR("Failed to start output manager");
         return false;
     }
 
@@ -238,7 +259,7 @@ bool ScreenRecorder::start(){
         audio_encode_thread_ = std::thread(&ScreenRecorder::audio_encode_loop, this);
     }
     */
-    std::cout << "Screen recorder started successfully" << std::endl;
+    LOG_INFO("Screen recorder started successfully");
     return true;
 }
 
@@ -246,7 +267,7 @@ void ScreenRecorder::stop(){
     if(!running_){
         return;
     }
-    std::cout<<"Stopping screen recorder..."<<std::endl;
+    LOG_INFO("Stopping screen recorder...");
 
     running_ = false;
     frame_cv_.notify_all();
@@ -278,7 +299,7 @@ void ScreenRecorder::stop(){
     /*
     // 处理剩余的音频数据
     if (audio_encoder_ && audio_frame_ && !audio_buffer_.empty()) {
-        std::cout << "Encoding remaining audio data: " << audio_buffer_.size() << " bytes" << std::endl;
+        LOG_INFO("Encoding remaining audio data: " << audio_buffer_.size() << " bytes");
         
         auto* audio_codec_ctx = audio_encoder_->getAudioCodecContext();
         int bytes_per_frame = audio_frame_->nb_samples * 2 * sizeof(float);
@@ -287,7 +308,7 @@ void ScreenRecorder::stop(){
         if (audio_buffer_.size() < bytes_per_frame) {
             size_t silence_needed = bytes_per_frame - audio_buffer_.size();
             audio_buffer_.insert(audio_buffer_.end(), silence_needed, 0);
-            std::cout << "Added " << silence_needed << " bytes of silence to complete frame" << std::endl;
+            LOG_INFO("Added " << silence_needed << " bytes of silence to complete frame");
         }
         
         // 编码最后一帧
@@ -324,37 +345,37 @@ void ScreenRecorder::stop(){
     }
     */
     
-    std::cout<<"Screen recorder stopped successfully"<<std::endl;
+    LOG_INFO("Screen recorder stopped successfully");
 }
 
 void ScreenRecorder::capture_loop(){
-    std::cout<<"Capture thread started"<<std::endl;
+    LOG_INFO("Capture thread started");
     if(!capture_->start()){
-        std::cerr<<"Failed to start capture"<<std::endl;
+        LOG_ERROR("Failed to start capture");
         return;
     }
     while(running_){
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     capture_->stop();
-    std::cout<<"Capture thread stopped"<<std::endl;
+    LOG_INFO("Capture thread stopped");
 }
 /*
 void ScreenRecorder::audio_capture_loop(){
-    std::cout<<"Audio capture thread started"<<std::endl;
+    LOG_INFO("Audio capture thread started");
     if(!audio_capture_->start()){
-        std::cerr<<"Failed to start audio capture"<<std::endl;
+        LOG_ERROR("Failed to start audio capture");
         return ;
     }
     while(running_){
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     audio_capture_->stop();
-    std::cout<<"Audio capture thread stopped"<<std::endl;
+    LOG_INFO("Audio capture thread stopped");
 }*/
 
 void ScreenRecorder::encode_loop(){
-    std::cout<<"Encode thread started"<<std::endl;
+    LOG_INFO("Encode thread started");
     const auto frame_interval=std::chrono::milliseconds(1000/config_.encoder_config.frame_rate);
 
     while(running_){
@@ -370,6 +391,7 @@ void ScreenRecorder::encode_loop(){
                 }
                 frame=frame_queue_.front();
                 frame_queue_.pop();
+                recorder_metrics().queue_depth.set(static_cast<double>(frame_queue_.size()));
             }
             else{
                 continue;
@@ -379,15 +401,15 @@ void ScreenRecorder::encode_loop(){
             encoder_->encodeFrame(av_frame_);
         }
     }
-    std::cout<<"Encode thread stopped"<<std::endl;
+    LOG_INFO("Encode thread stopped");
 }
 
 /*
 void ScreenRecorder::audio_encode_loop(){
-    std::cout<<"Audio encode thread started"<<std::endl;
+    LOG_INFO("Audio encode thread started");
 
     if (!audio_encoder_ || !audio_frame_) {
-        std::cerr << "Audio encoder or frame not initialized" << std::endl;
+        LOG_ERROR("Audio encoder or frame not initialized");
         return;
     }
 
@@ -439,12 +461,12 @@ void ScreenRecorder::audio_encode_loop(){
                 audio_frame_->pts = audio_pts;
                 cumulative_samples_encoded+=samples_per_frame;
                 if(audio_encoder_->encodeAudioFrame(audio_frame_)){
-                    std::cout<<"Successfully encoded audio frame, pts: "<<audio_pts<<std::endl;
+                    LOG_DEBUG("Successfully encoded audio frame, pts: "<<audio_pts);
                 }else{
-                    std::cerr << "Failed to encode audio frame" << std::endl;
+                    LOG_ERROR("Failed to encode audio frame");
                 }
             }else{
-                std::cerr << "Failed to convert audio data to frame" << std::endl;
+                LOG_ERROR("Failed to convert audio data to frame");
             }
 
             // 移除已处理的数据
@@ -452,34 +474,34 @@ void ScreenRecorder::audio_encode_loop(){
         }
     }
 
-    std::cout << "Audio encode thread stopped" << std::endl;
+    LOG_INFO("Audio encode thread stopped");
 }
 */
 bool ScreenRecorder::convertToAVFrame(const VideoFrame& src, AVFrame* dst) {
     if (!dst) {
-        std::cerr << "AVFrame is null in convertToAVFrame" << std::endl;
+        LOG_ERROR("AVFrame is null in convertToAVFrame");
         return false;
     }
 
     if (src.width != dst->width || src.height != dst->height) {
-        std::cerr << "Frame size mismatch in convertToAVFrame: "
+        LOG_ERROR("Frame size mismatch in convertToAVFrame: "
             << src.width << "x" << src.height << " vs "
-            << dst->width << "x" << dst->height << std::endl;
+            << dst->width << "x" << dst->height);
         return false;
     }
 
     if (src.data.empty()) {
-        std::cerr << "Source frame data is empty" << std::endl;
+        LOG_ERROR("Source frame data is empty");
         return false;
     }
 
-    std::cout << "Converting frame #" << frame_count_ << ", size: " << src.width << "x" << src.height << std::endl;
+    LOG_TRACE("Converting frame #" << frame_count_ << ", size: " << src.width << "x" << src.height);
 
     size_t y_size = src.width * src.height;
     size_t uv_size = y_size / 4;
 
     if (src.data.size() < y_size * 3 / 2) {
-        std::cerr << "Source data too small: " << src.data.size() << " < " << (y_size * 3 / 2) << std::endl;
+        LOG_ERROR("Source data too small: " << src.data.size() << " < " << (y_size * 3 / 2));
         return false;
     }
 
@@ -505,20 +527,20 @@ bool ScreenRecorder::convertToAVFrame(const VideoFrame& src, AVFrame* dst) {
     }
 
     dst->pts = TimeManager::instance().convertTimebase(src.timestamp,encoder_->getCodecContext()->time_base);
-    std::cout << "Frame converted successfully, pts: " << dst->pts << std::endl;
+    LOG_TRACE("Frame converted successfully, pts: " << dst->pts);
     return true;
 }
 
 /*
 bool ScreenRecorder::convertToAudioFrame(const float* audio_data,size_t data_size,AVFrame* frame){
     if (!frame || !audio_data || data_size == 0) {
-        std::cerr << "convertToAudioFrame: invalid parameters" << std::endl;
+        LOG_ERROR("convertToAudioFrame: invalid parameters");
         return false;
     }
 
     auto* audio_codec_ctx = audio_encoder_->getAudioCodecContext();
     if (!audio_codec_ctx) {
-        std::cerr << "convertToAudioFrame: audio codec context is null" << std::endl;
+        LOG_ERROR("convertToAudioFrame: audio codec context is null");
         return false;
     }
 
@@ -526,13 +548,13 @@ bool ScreenRecorder::convertToAudioFrame(const float* audio_data,size_t data_siz
     int samples = data_size / (2 * sizeof(float));
     
     if (samples <= 0) {
-        std::cerr << "convertToAudioFrame: insufficient data, samples: " << samples << std::endl;
+        LOG_ERROR("convertToAudioFrame: insufficient data, samples: " << samples);
         return false;
     }
 
     // 检查帧大小是否匹配
     if (frame->nb_samples != samples) {
-        std::cout << "Adjusting audio frame size from " << frame->nb_samples << " to " << samples << std::endl;
+        LOG_DEBUG("Adjusting audio frame size from " << frame->nb_samples << " to " << samples);
 
         av_frame_unref(frame);
         frame->nb_samples = samples;
@@ -543,7 +565,7 @@ bool ScreenRecorder::convertToAudioFrame(const float* audio_data,size_t data_siz
         // 重新分配缓冲区
         int ret = av_frame_get_buffer(frame, 0);
         if (ret < 0) {
-            std::cerr << "Failed to reallocate audio frame buffer" << std::endl;
+            LOG_ERROR("Failed to reallocate audio frame buffer");
             return false;
         }
     }
@@ -559,16 +581,16 @@ bool ScreenRecorder::convertToAudioFrame(const float* audio_data,size_t data_siz
             planar_right[i] = interleaved_data[i * 2 + 1];   // 右声道
         }
         
-        std::cout << "convertToAudioFrame: converted " << samples << " samples (interleaved to planar)" << std::endl;
+        LOG_TRACE("convertToAudioFrame: converted " << samples << " samples (interleaved to planar)");
     } else {
         // 直接复制
         memcpy(frame->data[0], audio_data, data_size);
-        std::cout << "convertToAudioFrame: copied " << data_size << " bytes directly" << std::endl;
+        LOG_TRACE("convertToAudioFrame: copied " << data_size << " bytes directly");
     }
     
     frame->pts = AV_NOPTS_VALUE;
 
-    std::cout << "Audio frame converted successfully" << std::endl;
+    LOG_TRACE("Audio frame converted successfully");
     
     return true;
 }
@@ -0,0 +1,159 @@
+#include "segment_cache.h"
+#include "metrics.h"
+#include <iostream>
+
+namespace {
+    // 单调递增的累计值导出为计数器，可直接对其求rate()
+    struct CacheMetrics {
+        Metrics& registry = Metrics::instance();
+        Metrics::Counter& hits = registry.counter("hls_segment_cache_hits_total", "Segment cache hits");
+        Metrics::Counter& misses = registry.counter("hls_segment_cache_misses_total",
+            "Segment cache misses that started a disk read");
+        Metrics::Counter& evictions = registry.counter("hls_segment_cache_evictions_total",
+            "Segment cache entries evicted to stay within the byte budget");
+    };
+
+    CacheMetrics& cache_metrics() {
+        static CacheMetrics metrics;
+        return metrics;
+    }
+}
+
+SegmentCache::SegmentCache(FileReader& reader, size_t capacity_bytes, size_t max_entry_bytes,
+    std::chrono::milliseconds playlist_ttl)
+    : reader_(reader)
+    , capacity_bytes_(capacity_bytes)
+    , max_entry_bytes_(max_entry_bytes < capacity_bytes ? max_entry_bytes : capacity_bytes)
+    , playlist_ttl_(playlist_ttl) {
+}
+
+void SegmentCache::fetch(const std::string& path, Callback callback) {
+    std::shared_ptr<const CachedFile> hit;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it != entries_.end()) {
+            if (it->second.file->expires_at > std::chrono::steady_clock::now()) {
+                // 命中：移动到LRU头部
+                lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+                hit = it->second.file;
+                hits_++;
+                cache_metrics().hits.inc();
+            }
+            else {
+                // 播放列表已过期
+                erase_locked(it);
+            }
+        }
+
+        if (!hit) {
+            auto pending = pending_.find(path);
+            if (pending != pending_.end()) {
+                // 已有请求在加载同一文件，等待其结果
+                pending->second.push_back(std::move(callback));
+                collapsed_++;
+                return;
+            }
+            pending_[path].push_back(std::move(callback));
+            misses_++;
+            cache_metrics().misses.inc();
+        }
+    }
+
+    // 回调可能耗时，在锁外执行
+    if (hit) {
+        callback(std::move(hit), {});
+        return;
+    }
+
+    reader_.read(path, max_entry_bytes_, [this, path](FileReadResult result) {
+        complete_load(path, std::move(result));
+        });
+}
+
+void SegmentCache::complete_load(const std::string& path, FileReadResult result) {
+    std::shared_ptr<CachedFile> file;
+    std::error_code error = result.error;
+    if (result.too_large) {
+        bypassed_++;
+    }
+    else if (!error) {
+        file = std::make_shared<CachedFile>();
+        file->body = std::move(result.data);
+        file->validators = result.validators;
+
+        // 直播播放列表会持续更新，只短暂缓存；切片只会被整体替换，替换它的生成器或按需转码会调用invalidate
+        if (path.ends_with(".m3u8")) {
+            file->expires_at = std::chrono::steady_clock::now() + playlist_ttl_;
+        }
+        else {
+            file->expires_at = std::chrono::steady_clock::time_point::max();
+        }
+    }
+
+    std::vector<Callback> waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 读取期间文件被替换：读到的可能是旧内容，只交给已在等待的请求，不进缓存
+        bool replaced = invalidated_loads_.erase(path) > 0;
+        if (file && !replaced) {
+            insert_locked(path, file);
+        }
+        auto pending = pending_.find(path);
+        waiters = std::move(pending->second);
+        pending_.erase(pending);
+    }
+
+    for (auto& waiter : waiters) {
+        waiter(file, error);
+    }
+}
+
+void SegmentCache::invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+        erase_locked(it);
+    }
+    if (pending_.count(path)) {
+        invalidated_loads_.insert(path);
+    }
+}
+
+SegmentCache::Stats SegmentCache::stats() const {
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.collapsed = collapsed_;
+    stats.bypassed = bypassed_;
+    stats.evictions = evictions_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.bytes = bytes_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void SegmentCache::insert_locked(const std::string& path, std::shared_ptr<const CachedFile> file) {
+    auto existing = entries_.find(path);
+    if (existing != entries_.end()) {
+        erase_locked(existing);
+    }
+
+    lru_.push_front(path);
+    bytes_ += file->body.size();
+    entries_.emplace(path, Entry{ std::move(file), lru_.begin() });
+
+    // 超出预算时从LRU尾部淘汰；正在发送的内容由shared_ptr保持有效
+    while (bytes_ > capacity_bytes_ && !lru_.empty()) {
+        auto victim = entries_.find(lru_.back());
+        erase_locked(victim);
+        evictions_++;
+        cache_metrics().evictions.inc();
+    }
+}
+
+void SegmentCache::erase_locked(std::unordered_map<std::string, Entry>::iterator it) {
+    bytes_ -= it->second.file->body.size();
+    lru_.erase(it->second.lru_it);
+    entries_.erase(it);
+}
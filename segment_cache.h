@@ -0,0 +1,81 @@
+#pragma once
+#ifndef SEGMENT_CACHE_H
+#define SEGMENT_CACHE_H
+
+#include "http_utils.h"
+#include "file_reader.h"
+#include <string>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+
+// 缓存中的文件内容，加载后不再修改，多个连接通过shared_ptr共享
+struct CachedFile {
+    std::string body;
+    FileValidators validators;
+    std::chrono::steady_clock::time_point expires_at;
+};
+
+// 按字节预算淘汰的LRU缓存，用于HLS切片与播放列表
+// 同一路径的并发未命中合并为一次磁盘读取（single-flight）
+class SegmentCache {
+public:
+    // body为空且error为空：文件超过单项上限，调用方应直接从磁盘发送
+    using Callback = std::function<void(std::shared_ptr<const CachedFile> body, std::error_code error)>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t collapsed = 0;   // 等待其他请求加载结果的未命中
+        uint64_t bypassed = 0;    // 超过单项上限未缓存的文件
+        uint64_t evictions = 0;
+        size_t bytes = 0;
+        size_t entries = 0;
+    };
+
+    SegmentCache(FileReader& reader, size_t capacity_bytes, size_t max_entry_bytes,
+        std::chrono::milliseconds playlist_ttl);
+
+    // 命中时同步回调；未命中时经FileReader异步读取，完成后在读取完成的线程上回调所有等待者
+    void fetch(const std::string& path, Callback callback);
+    // 文件被写完或替换后移除缓存项；正在加载的同一路径的结果不再进缓存
+    void invalidate(const std::string& path);
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const CachedFile> file;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    void complete_load(const std::string& path, FileReadResult result);
+    void insert_locked(const std::string& path, std::shared_ptr<const CachedFile> file);
+    void erase_locked(std::unordered_map<std::string, Entry>::iterator it);
+
+    FileReader& reader_;
+    const size_t capacity_bytes_;
+    const size_t max_entry_bytes_;
+    const std::chrono::milliseconds playlist_ttl_;
+
+    mutable std::mutex mutex_;
+    std::list<std::string> lru_;   // 头部为最近使用
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, std::vector<Callback>> pending_;
+    std::unordered_set<std::string> invalidated_loads_;   // 加载期间被invalidate的路径
+    size_t bytes_ = 0;
+
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };
+    std::atomic<uint64_t> collapsed_{ 0 };
+    std::atomic<uint64_t> bypassed_{ 0 };
+    std::atomic<uint64_t> evictions_{ 0 };
+};
+
+#endif // SEGMENT_CACHE_H
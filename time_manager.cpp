@@ -1,5 +1,5 @@
 #include "time_manager.h"
-#include <iostream>
+#include "logger.h"
 
 // 初始化静态常量
 const AVRational TimeManager::MICROSECOND_TIMEBASE = {1, 1000000};
@@ -19,19 +19,19 @@ void TimeManager::startRecording() {
         
         start_time_=std::chrono::steady_clock::now();
         is_recording_=true;
-        std::cout<<"Start recording at"<<start_time_.time_since_epoch().count()<<std::endl;
+        LOG_INFO("Start recording at"<<start_time_.time_since_epoch().count());
     }
 }
 
 void TimeManager::stopRecording() {
     std::lock_guard<std::mutex> lock(mutex_);
     is_recording_=false;
-    std::cout<<"Stop recording at"<<std::chrono::steady_clock::now().time_since_epoch().count()<<std::endl;
+    LOG_INFO("Stop recording at"<<std::chrono::steady_clock::now().time_since_epoch().count());
 }
 
 int64_t TimeManager::getCurrentPts()const{
     if(!is_recording_){
-        std::cerr<<"Not recording"<<std::endl;
+        LOG_ERROR("Not recording");
         return 0;
     }
     auto now=std::chrono::steady_clock::now();
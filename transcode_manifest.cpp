@@ -0,0 +1,218 @@
+#include "transcode_manifest.h"
+#include "logger.h"
+#include<algorithm>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<sstream>
+#include<vector>
+
+namespace {
+    constexpr uint64_t PRIME1 = 11400714785074694791ULL;
+    constexpr uint64_t PRIME2 = 14029467366897019727ULL;
+    constexpr uint64_t PRIME3 = 1609587929392839161ULL;
+    constexpr uint64_t PRIME4 = 9650029242287828579ULL;
+    constexpr uint64_t PRIME5 = 2870177450012600261ULL;
+
+    // 输出格式或参数含义变化时递增，让旧清单全部失效
+    constexpr const char* MANIFEST_VERSION = "hls-manifest 1";
+    // 抽样：块数与每块大小；不超过SAMPLE_COUNT*SAMPLE_BYTES的文件整体读取
+    constexpr int SAMPLE_COUNT = 16;
+    constexpr size_t SAMPLE_BYTES = 256 * 1024;
+    constexpr size_t FULL_HASH_CHUNK = 4 * 1024 * 1024;
+
+    uint64_t rotl(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    uint64_t read64(const unsigned char* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;   // 按小端读取，与xxHash的参考实现在x86/ARM上一致
+    }
+
+    uint32_t read32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    uint64_t merge_round(uint64_t acc, uint64_t value) {
+        acc ^= round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    std::string hex(uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    template <typename Set>
+    std::vector<int> sorted(const Set& values) {
+        std::vector<int> result(values.begin(), values.end());
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // 会改变输出内容的参数；线程数、HTTP与缓存等只影响速度的配置不计入
+    std::string transcode_params(const Config& config) {
+        std::ostringstream params;
+        params << MANIFEST_VERSION << "\n"
+            << "playlist " << config.M3U8_FILENAME << "\n"
+            << "segment " << config.HLS_SEGMENT_DURATION << "\n"
+            << "video_bitrate " << config.VIDEO_BITRATE << "\n"
+            << "audio_bitrate " << config.AUDIO_BITRATE << "\n"
+            << "event " << config.HLS_SERVE_WHILE_GENERATING << "\n"
+            << "ll " << config.LL_HLS_ENABLED << " " << config.LL_HLS_PART_DURATION << " "
+            << config.LL_HLS_PART_PLAYLIST << " " << config.LL_HLS_PART_PREFIX << "\n";
+        params << "video_codecs";
+        for (int codec : sorted(config.TRANSCODE_VIDEO_CODECS)) params << " " << codec;
+        params << "\naudio_codecs";
+        for (int codec : sorted(config.TRANSCODE_AUDIO_CODECS)) params << " " << codec;
+        params << "\nladder";
+        for (const auto& rendition : config.HLS_ABR_LADDER) {
+            params << " " << rendition.name << ":" << rendition.height << ":" << rendition.video_bitrate;
+        }
+        params << "\n";
+        return params.str();
+    }
+}
+
+uint64_t xxhash64(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    uint64_t h;
+    if (length >= 32) {
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    }
+    else {
+        h = seed + PRIME5;
+    }
+    h += length;
+    while (p + 8 <= end) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+        h = rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME5;
+        h = rotl(h, 11) * PRIME1;
+        p++;
+    }
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string TranscodeIdentity::to_string() const {
+    std::ostringstream text;
+    text << hex(input_hash) << " " << input_size << " " << hex(params_hash);
+    return text.str();
+}
+
+TranscodeIdentity compute_transcode_identity(const Config& config, bool full) {
+    TranscodeIdentity identity;
+    std::string params = transcode_params(config);
+    identity.params_hash = xxhash64(params.data(), params.size());
+
+    std::ifstream input(config.VIDEO_PATH, std::ios::binary);
+    std::error_code ec;
+    identity.input_size = std::filesystem::file_size(config.VIDEO_PATH, ec);
+    if (!input.is_open() || ec) {
+        LOG_WARN("无法读取输入文件计算指纹：" << config.VIDEO_PATH);
+        return identity;
+    }
+
+    // 每块的哈希作为下一块的种子串联起来，种子从文件大小开始
+    uint64_t hash = identity.input_size;
+    std::vector<char> buffer;
+    auto hash_block = [&](uint64_t offset, size_t length) {
+        buffer.resize(length);
+        input.seekg(static_cast<std::streamoff>(offset));
+        input.read(buffer.data(), static_cast<std::streamsize>(length));
+        hash = xxhash64(buffer.data(), static_cast<size_t>(input.gcount()), hash);
+        input.clear();
+    };
+    if (full || identity.input_size <= SAMPLE_COUNT * SAMPLE_BYTES) {
+        for (uint64_t offset = 0; offset < identity.input_size; offset += FULL_HASH_CHUNK) {
+            hash_block(offset, static_cast<size_t>(std::min<uint64_t>(FULL_HASH_CHUNK, identity.input_size - offset)));
+        }
+    }
+    else {
+        // 第一块与最后一块对齐文件首尾（容器头与尾部索引），其余等距分布
+        uint64_t span = identity.input_size - SAMPLE_BYTES;
+        for (int i = 0; i < SAMPLE_COUNT; ++i) {
+            hash_block(span * i / (SAMPLE_COUNT - 1), SAMPLE_BYTES);
+        }
+    }
+    identity.input_hash = hash;
+    return identity;
+}
+
+bool manifest_matches(const std::string& manifest_path, const TranscodeIdentity& identity, const std::string& playlist_path) {
+    std::ifstream manifest(manifest_path);
+    if (!manifest.is_open()) {
+        return false;
+    }
+    std::string identity_line;
+    std::string playlist_line;
+    std::getline(manifest, identity_line);
+    std::getline(manifest, playlist_line);
+    if (identity_line != "identity " + identity.to_string()) {
+        return false;
+    }
+    // 播放列表被删除或改写过时清单作废
+    std::error_code ec;
+    auto size = std::filesystem::file_size(playlist_path, ec);
+    return !ec && playlist_line == "playlist " + std::to_string(size);
+}
+
+void write_manifest(const std::string& manifest_path, const TranscodeIdentity& identity, const std::string& playlist_path) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(playlist_path, ec);
+    if (ec) {
+        LOG_ERROR("播放列表不存在，不写入转码清单：" << playlist_path);
+        return;
+    }
+    std::string temp_path = manifest_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << "identity " << identity.to_string() << "\n"
+            << "playlist " << size << "\n";
+    }
+    std::filesystem::rename(temp_path, manifest_path, ec);
+    if (ec) {
+        LOG_ERROR("写入转码清单失败: " << ec.message());
+    }
+}
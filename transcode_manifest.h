@@ -0,0 +1,28 @@
+#pragma once
+#ifndef TRANSCODE_MANIFEST_H
+#define TRANSCODE_MANIFEST_H
+#include"config.h"
+#include<cstdint>
+#include<string>
+
+// xxHash64
+uint64_t xxhash64(const void* data, size_t length, uint64_t seed = 0);
+
+// 一次转换的身份：输入文件内容的指纹加上影响输出的转码参数。
+// 两者都相同时已有的输出可以直接使用，与文件修改时间无关
+struct TranscodeIdentity {
+	uint64_t input_hash = 0;
+	uint64_t input_size = 0;
+	uint64_t params_hash = 0;
+
+	std::string to_string() const;
+};
+
+// full为false时只抽样读取输入文件的若干块（开头、结尾与等距的中间位置），大文件也只读几MB
+TranscodeIdentity compute_transcode_identity(const Config& config, bool full);
+
+// 转换完成后写在HLS_DIR中的清单，记录身份与播放列表的大小；启动时只读清单和stat一次播放列表
+bool manifest_matches(const std::string& manifest_path, const TranscodeIdentity& identity, const std::string& playlist_path);
+void write_manifest(const std::string& manifest_path, const TranscodeIdentity& identity, const std::string& playlist_path);
+
+#endif // !TRANSCODE_MANIFEST_H
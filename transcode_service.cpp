@@ -0,0 +1,388 @@
+#include "transcode_service.h"
+#include "codec_threading.h"
+#include "logger.h"
+#include "metrics.h"
+#include "transcode_manifest.h"
+#include<algorithm>
+#include<cctype>
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<filesystem>
+#ifdef __linux__
+#include<poll.h>
+#include<sys/inotify.h>
+#include<unistd.h>
+#endif
+
+namespace {
+    struct ServiceMetrics {
+        Metrics& registry = Metrics::instance();
+        Metrics::Gauge& queued = registry.gauge("hls_service_jobs",
+            "Watch-folder transcode jobs by state", "state=\"queued\"");
+        Metrics::Gauge& running = registry.gauge("hls_service_jobs",
+            "Watch-folder transcode jobs by state", "state=\"running\"");
+        Metrics::Counter& done = registry.counter("hls_service_jobs_finished_total",
+            "Watch-folder transcode jobs that finished", "result=\"done\"");
+        Metrics::Counter& failed = registry.counter("hls_service_jobs_finished_total",
+            "Watch-folder transcode jobs that finished", "result=\"failed\"");
+    };
+
+    ServiceMetrics& service_metrics() {
+        static ServiceMetrics metrics;
+        return metrics;
+    }
+
+    // 堆顶是优先级最高、同优先级中最早提交的任务
+    template <typename JobPtr>
+    bool lower_priority(const JobPtr& a, const JobPtr& b) {
+        if (a->status.priority != b->status.priority) {
+            return a->status.priority < b->status.priority;
+        }
+        return a->status.id > b->status.id;
+    }
+}
+
+TranscodeService::TranscodeService(const Config& config)
+    : config_(config) {
+    int total = config_.WATCH_MAX_THREADS > 0 ? config_.WATCH_MAX_THREADS : available_threads(config_);
+    thread_budget_ = std::max(1, total / std::max(1, config_.WATCH_WORKERS));
+}
+
+TranscodeService::~TranscodeService() {
+    stop();
+}
+
+const char* TranscodeService::state_name(JobState state) {
+    switch (state) {
+    case JobState::Queued: return "queued";
+    case JobState::Running: return "running";
+    case JobState::Done: return "done";
+    case JobState::Failed: return "failed";
+    case JobState::Cancelled: return "cancelled";
+    default: return "";
+    }
+}
+
+int TranscodeService::parse_priority(const std::string& filename, std::string& name) {
+    std::string stem = std::filesystem::path(filename).stem().string();
+    name = std::filesystem::path(filename).filename().string();
+    if (stem.size() < 3 || stem[0] != '[') {
+        return 0;
+    }
+    size_t close = stem.find(']');
+    if (close == std::string::npos || close == 1 || close + 1 >= stem.size()) {
+        return 0;
+    }
+    size_t digits = stem[1] == '-' ? 2 : 1;
+    for (size_t i = digits; i < close; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(stem[i]))) {
+            return 0;
+        }
+    }
+    name = name.substr(close + 1);
+    return std::atoi(stem.c_str() + 1);
+}
+
+std::string TranscodeService::output_dir_for_locked(const std::string& input_path, const std::string& name) const {
+    // 同一输入沿用之前的输出目录（下次转换命中转码清单）
+    for (const auto& job : jobs_) {
+        if (job->status.input == input_path) {
+            return job->status.output_dir;
+        }
+    }
+    // 不同输入去掉优先级前缀后同名（如"[5]movie.mp4"与"movie.mp4"）时，后到的加上由输入文件名算出的后缀
+    std::string dir = config_.HLS_DIR + "/" + name;
+    auto taken = [this](const std::string& candidate) {
+        return std::any_of(jobs_.begin(), jobs_.end(),
+            [&](const std::shared_ptr<Job>& job) { return job->status.output_dir == candidate; });
+    };
+    if (!taken(dir)) {
+        return dir;
+    }
+    std::string filename = std::filesystem::path(input_path).filename().string();
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), "-%08llx",
+        static_cast<unsigned long long>(xxhash64(filename.data(), filename.size()) & 0xffffffffULL));
+    dir += suffix;
+    for (int n = 2; taken(dir); ++n) {
+        dir = config_.HLS_DIR + "/" + name + suffix + "-" + std::to_string(n);
+    }
+    return dir;
+}
+
+void TranscodeService::start() {
+    std::filesystem::create_directories(config_.WATCH_DIR);
+    std::filesystem::create_directories(config_.HLS_DIR);
+    LOG_INFO("监视目录 " << config_.WATCH_DIR << "：" << config_.WATCH_WORKERS << "个转码任务并发，每个任务最多"
+        << thread_budget_ << "个编解码线程");
+
+#ifdef __linux__
+    // 只关心写完关闭与移入的文件，复制过程中的写入不会触发
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ >= 0 && inotify_add_watch(inotify_fd_, config_.WATCH_DIR.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    if (inotify_fd_ < 0) {
+        LOG_WARN("inotify不可用，改为每" << config_.WATCH_POLL_MS << "毫秒轮询目录");
+    }
+#endif
+    // 启动前就在目录里的文件：inotify模式下直接入队，轮询模式下等下一次扫描确认大小不再变化
+    scan_directory(inotify_fd_ < 0);
+
+    for (int i = 0; i < std::max(1, config_.WATCH_WORKERS); ++i) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+    watcher_ = std::thread([this]() { watch_loop(); });
+}
+
+void TranscodeService::stop() {
+    if (stopping_.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& job : jobs_) {
+            if (job->generator) {
+                job->generator->stop();
+            }
+        }
+    }
+    cv_.notify_all();
+    if (watcher_.joinable()) {
+        watcher_.join();
+    }
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+#ifdef __linux__
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+#endif
+}
+
+uint64_t TranscodeService::submit(const std::string& input_path, int priority) {
+    std::filesystem::path path(input_path);
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (config_.SUPPORTED_FORMAT.find(extension) == config_.SUPPORTED_FORMAT.end()) {
+        return 0;
+    }
+    std::string name;
+    parse_priority(path.filename().string(), name);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& job : jobs_) {
+        if (job->status.input == input_path &&
+            (job->status.state == JobState::Queued || job->status.state == JobState::Running)) {
+            return job->status.id;
+        }
+    }
+    auto job = std::make_shared<Job>();
+    job->status.id = next_id_++;
+    job->status.input = input_path;
+    job->status.output_dir = output_dir_for_locked(input_path, name);
+    job->status.priority = priority;
+    job->config = std::make_unique<Config>(input_path, job->status.output_dir, thread_budget_,
+        config_.HLS_CHECKPOINT);
+    jobs_.push_back(job);
+    queue_.push_back(job);
+    std::push_heap(queue_.begin(), queue_.end(), lower_priority<std::shared_ptr<Job>>);
+    LOG_INFO("转码任务#" << job->status.id << "入队：" << input_path << "（优先级" << priority << "，输出到"
+        << job->status.output_dir << "）");
+    update_metrics();
+    cv_.notify_one();
+    return job->status.id;
+}
+
+std::vector<TranscodeService::JobStatus> TranscodeService::jobs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<JobStatus> result;
+    result.reserve(jobs_.size());
+    for (const auto& job : jobs_) {
+        result.push_back(job->status);
+        if (job->generator) {
+            result.back().progress = job->generator->progress();
+        }
+    }
+    return result;
+}
+
+void TranscodeService::scan_directory(bool stable_only) {
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(config_.WATCH_DIR, ec)) {
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+        std::string path = entry.path().string();
+        uintmax_t size = entry.file_size(ec);
+        if (ec || size == 0) {
+            continue;
+        }
+        SeenFile& seen = seen_files_[path];
+        if (seen.size != size) {
+            seen.size = size;
+            seen.submitted = false;
+            if (stable_only) {
+                continue;   // 还在写入，下次扫描再看
+            }
+        }
+        if (!seen.submitted) {
+            seen.submitted = true;
+            std::string name;
+            submit(path, parse_priority(entry.path().filename().string(), name));
+        }
+    }
+}
+
+void TranscodeService::watch_loop() {
+#ifdef __linux__
+    if (inotify_fd_ >= 0) {
+        alignas(inotify_event) char buffer[16 * 1024];
+        while (!stopping_) {
+            pollfd fd{ inotify_fd_, POLLIN, 0 };
+            if (poll(&fd, 1, 200) <= 0) {
+                continue;
+            }
+            ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < length;) {
+                auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                    std::string name;
+                    int priority = parse_priority(event->name, name);
+                    submit(config_.WATCH_DIR + "/" + event->name, priority);
+                }
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+        return;
+    }
+#endif
+    while (!stopping_) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::milliseconds(config_.WATCH_POLL_MS), [this]() { return stopping_.load(); });
+        lock.unlock();
+        if (!stopping_) {
+            scan_directory(true);
+        }
+    }
+}
+
+void TranscodeService::worker_loop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, &job]() { return stopping_ || (job = take_runnable_locked()) != nullptr; });
+            if (stopping_) {
+                if (job) {
+                    queue_.push_back(std::move(job));
+                    std::push_heap(queue_.begin(), queue_.end(), lower_priority<std::shared_ptr<Job>>);
+                }
+                return;
+            }
+            job->status.state = JobState::Running;
+            busy_outputs_.insert(job->status.output_dir);
+            update_metrics();
+        }
+
+        JobState state = JobState::Done;
+        std::string error;
+        double progress = 0;
+        try {
+            std::filesystem::create_directories(job->status.output_dir);
+            HLSGenerator generator(*job->config);
+            generator.set_output_listener(output_listener_);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                job->generator = &generator;
+            }
+            LOG_INFO("开始转码任务#" << job->status.id << "：" << job->status.input);
+            generator.start_async();
+            int reported = 0;
+            while (!generator.is_finished()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                if (stopping_) {
+                    generator.stop();
+                }
+                // 每前进10%打印一次
+                int percent = static_cast<int>(generator.progress() * 100);
+                if (percent / 10 > reported / 10) {
+                    reported = percent;
+                    LOG_INFO("转码任务#" << job->status.id << "进度 " << percent << "%");
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                job->generator = nullptr;
+            }
+            progress = generator.progress();
+            generator.wait();
+            if (stopping_ && progress < 1) {
+                state = JobState::Cancelled;
+            }
+        }
+        catch (const std::exception& e) {
+            state = JobState::Failed;
+            error = e.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job->generator = nullptr;
+            job->status.state = state;
+            job->status.progress = progress;
+            job->status.error = error;
+            busy_outputs_.erase(job->status.output_dir);
+            update_metrics();
+        }
+        // 可能有同一输出目录的任务在等待
+        cv_.notify_all();
+        if (state == JobState::Done) {
+            service_metrics().done.inc();
+            LOG_INFO("转码任务#" << job->status.id << "完成：" << job->status.output_dir);
+        }
+        else if (state == JobState::Failed) {
+            service_metrics().failed.inc();
+            LOG_ERROR("转码任务#" << job->status.id << "失败：" << error);
+        }
+        else {
+            LOG_WARN("转码任务#" << job->status.id << (config_.HLS_CHECKPOINT
+                ? "被中止，下次启动时从检查点续转" : "被中止，下次启动时重新转码"));
+        }
+    }
+}
+
+std::shared_ptr<TranscodeService::Job> TranscodeService::take_runnable_locked() {
+    // 按优先级依次取出，跳过输出目录正被其他任务写入的，跳过的放回堆中
+    std::vector<std::shared_ptr<Job>> skipped;
+    std::shared_ptr<Job> job;
+    while (!queue_.empty()) {
+        std::pop_heap(queue_.begin(), queue_.end(), lower_priority<std::shared_ptr<Job>>);
+        std::shared_ptr<Job> candidate = std::move(queue_.back());
+        queue_.pop_back();
+        if (busy_outputs_.count(candidate->status.output_dir) == 0) {
+            job = std::move(candidate);
+            break;
+        }
+        skipped.push_back(std::move(candidate));
+    }
+    for (auto& other : skipped) {
+        queue_.push_back(std::move(other));
+        std::push_heap(queue_.begin(), queue_.end(), lower_priority<std::shared_ptr<Job>>);
+    }
+    return job;
+}
+
+void TranscodeService::update_metrics() {
+    // 调用方持有mutex_
+    size_t running = std::count_if(jobs_.begin(), jobs_.end(),
+        [](const std::shared_ptr<Job>& job) { return job->status.state == JobState::Running; });
+    service_metrics().queued.set(static_cast<double>(queue_.size()));
+    service_metrics().running.set(static_cast<double>(running));
+}
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef TRANSCODE_SERVICE_H
+#define TRANSCODE_SERVICE_H
+#include"config.h"
+#include"hls_generator.h"
+#include<atomic>
+#include<condition_variable>
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<unordered_map>
+#include<unordered_set>
+#include<vector>
+
+// 监视目录的批量转码服务：WATCH_DIR中新写完（或移入）的视频按优先级排队，
+// 由WATCH_WORKERS个工作线程各自用一个HLSGenerator转码到HLS_DIR/<文件名>/（保留扩展名，去掉优先级前缀）。
+// 所有任务合计的编解码线程数不超过WATCH_MAX_THREADS。
+// 文件名以"[数字]"开头时该数字为优先级（越大越先转码，默认0），同优先级按到达顺序
+class TranscodeService {
+public:
+	enum class JobState { Queued, Running, Done, Failed, Cancelled };
+
+	struct JobStatus {
+		uint64_t id = 0;
+		std::string input;
+		std::string output_dir;
+		int priority = 0;
+		JobState state = JobState::Queued;
+		double progress = 0;	// 0~1
+		std::string error;
+	};
+
+	explicit TranscodeService(const Config& config);
+	~TranscodeService();
+
+	// 扫描目录中已有的文件，启动监视线程与工作线程
+	void start();
+	// 停止监视并让正在转码的任务在下一个数据包处停止（启用HLS_CHECKPOINT时下次启动从检查点续转），等待线程退出
+	void stop();
+	// 加入队列；同一输入已在排队或转码中时返回已有任务的编号。扩展名不在SUPPORTED_FORMAT中时返回0
+	uint64_t submit(const std::string& input_path, int priority = 0);
+	// 所有任务的状态快照，按提交顺序
+	std::vector<JobStatus> jobs() const;
+	// 在start()之前设置，交给每个任务的生成器：切片写完或被替换后以其路径调用
+	void set_output_listener(std::function<void(const std::string&)> listener) { output_listener_ = std::move(listener); }
+
+	// 从"[5]movie.mp4"中取出优先级5与输出名"movie.mp4"
+	static int parse_priority(const std::string& filename, std::string& name);
+	static const char* state_name(JobState state);
+
+private:
+	struct Job {
+		JobStatus status;
+		std::unique_ptr<Config> config;		// 生成器持有其引用，随任务保留
+		HLSGenerator* generator = nullptr;	// 转码期间有效，受mutex_保护
+	};
+
+	void watch_loop();
+	void worker_loop();
+	// 扫描一遍目录；stable_only为true时只提交大小与上次扫描相同的文件
+	void scan_directory(bool stable_only);
+	// 以下调用方持有mutex_
+	// 输入对应的输出目录：同一输入总是同一目录，不同输入不会共用目录
+	std::string output_dir_for_locked(const std::string& input_path, const std::string& name) const;
+	// 取出优先级最高、输出目录没有任务在写的排队任务，没有时返回空
+	std::shared_ptr<Job> take_runnable_locked();
+	void update_metrics();
+
+	const Config& config_;
+	int thread_budget_ = 1;		// 每个任务可用的线程数
+
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::vector<std::shared_ptr<Job>> jobs_;
+	std::vector<std::shared_ptr<Job>> queue_;	// 按(优先级, 编号)排列的堆
+	std::unordered_set<std::string> busy_outputs_;	// 正在转码的任务的输出目录，同一目录的任务串行执行
+	uint64_t next_id_ = 1;
+
+	// 轮询模式下每个文件上次扫描时的大小，以及这个大小是否已经提交过
+	struct SeenFile {
+		uintmax_t size = 0;
+		bool submitted = false;
+	};
+	std::unordered_map<std::string, SeenFile> seen_files_;
+	std::vector<std::thread> workers_;
+	std::thread watcher_;
+	std::atomic<bool> stopping_{ false };
+	int inotify_fd_ = -1;
+	std::function<void(const std::string&)> output_listener_;
+};
+
+#endif // !TRANSCODE_SERVICE_H
@@ -1,15 +1,59 @@
 #pragma once
 #include "utils.h"
-#include<iostream>
+#include "logger.h"
+#include<algorithm>
+#include<cstdarg>
+#include<stdexcept>
 extern "C" {
 	#include<libavutil/error.h>
+	#include<libavutil/log.h>
 }
-int check_ffmpeg_error(int ret, const std::string& context){
+int check_ffmpeg_error(int ret, std::string_view context){
 	if (ret < 0) {
 		char errbuf[1024];
 		av_strerror(ret, errbuf, sizeof(errbuf));
-		std::cerr << "[" << context << "] FFmpeg:" <<errbuf<<"(" <<ret<<")"<<std::endl;
-		std::exit(EXIT_FAILURE);
+		throw std::runtime_error("[" + std::string(context) + "] FFmpeg:" + errbuf + "(" + std::to_string(ret) + ")");
 	}
 	return ret;
-}
\ No newline at end of file
+}
+
+namespace {
+	void ffmpeg_log_callback(void* avcl, int level, const char* fmt, va_list args) {
+		if (level > av_log_get_level()) {
+			return;
+		}
+		LogLevel mapped = level <= AV_LOG_ERROR ? LogLevel::Error
+			: level <= AV_LOG_WARNING ? LogLevel::Warn
+			: level <= AV_LOG_INFO ? LogLevel::Info
+			: level <= AV_LOG_VERBOSE ? LogLevel::Debug : LogLevel::Trace;
+		if (!Logger::instance().enabled(mapped)) {
+			return;
+		}
+
+		// FFmpeg的所有输出共用一个限流点，避免逐帧警告刷屏
+		static LogSiteLimiter site;
+		uint64_t suppressed = 0;
+		if (!site.allow(Logger::instance().site_rate(), suppressed)) {
+			return;
+		}
+
+		// av_log_format_line2会加上"[h264 @ 0x...]"之类的上下文前缀；print_prefix记录上一段是否以换行结尾
+		thread_local int print_prefix = 1;
+		char line[LOG_MESSAGE_BYTES];
+		int length = av_log_format_line2(avcl, level, fmt, args, line, sizeof(line), &print_prefix);
+		if (length <= 0) {
+			return;
+		}
+		size_t size = std::min(static_cast<size_t>(length), sizeof(line) - 1);
+		while (size > 0 && (line[size - 1] == '\n' || line[size - 1] == '\r')) {
+			--size;
+		}
+		if (size > 0) {
+			Logger::instance().write(mapped, line, size, suppressed);
+		}
+	}
+}
+
+void route_ffmpeg_logs() {
+	av_log_set_callback(ffmpeg_log_callback);
+}
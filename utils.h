@@ -2,7 +2,12 @@
 #ifndef UTILS_H
 #define UTILS_H
 #include<string>
+#include<string_view>
 #include<cstdlib>
-int check_ffmpeg_error(int ret, const std::string& context);
+// ret<0时抛出std::runtime_error，由任务或请求所在的一层捕获，一个坏文件不会结束整个进程；
+// context用string_view，热路径上传字面量时不构造std::string
+int check_ffmpeg_error(int ret, std::string_view context);
+// 把FFmpeg的av_log输出转到异步日志，级别按Logger的设置过滤
+void route_ffmpeg_logs();
 #endif
 
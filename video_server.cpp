@@ -1,7 +1,10 @@
 ﻿/*
 #include "config.h"
 #include "hls_generator.h"
+#include "transcode_service.h"
+#include "jit_transcoder.h"
 #include "HttpServer.h"
+#include "utils.h"
 #include <iostream>
 #include <csignal>
 #include <atomic>
@@ -15,6 +18,8 @@ void signal_handler(int signal) {
 }
 
 int main() {
+    // FFmpeg的输出经异步日志统一限流，转码线程不直接写stderr
+    route_ffmpeg_logs();
     try {
         // 设置信号处理
         std::signal(SIGINT, signal_handler);
@@ -22,6 +27,25 @@ int main() {
 
         Config config;
 
+        // 服务模式：监视WATCH_DIR，新到的视频排队转码到HLS_DIR/<文件名>/，HTTP服务器提供整个HLS_DIR
+        if (config.WATCH_ENABLED) {
+            // 服务器先于转码线程构造、后于其析构，回调中的引用始终有效
+            HttpServer server(config);
+            TranscodeService service(config);
+            service.set_output_listener([&server](const std::string& path) { server.notify_file_written(path); });
+            service.start();
+            server.start();
+            std::cout << "Watching " << config.WATCH_DIR << ", streams at http://localhost:" << config.HTTP_PORT
+                << "/<file name>/" << config.M3U8_FILENAME << std::endl;
+            while (!stop_signal && server.is_running()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            std::cout << "Shutting down..." << std::endl;
+            service.stop();
+            server.stop();
+            return 0;
+        }
+
         // 检查输入文件
         if (!std::filesystem::exists(config.VIDEO_PATH)) {
             std::cerr << "Error: Input video file not found: " << config.VIDEO_PATH << std::endl;
@@ -40,15 +64,46 @@ int main() {
         std::cout << "HTTP port: " << config.HTTP_PORT << std::endl;
         std::cout << "=============================" << std::endl;
 
-        // 生成HLS流
-        std::cout << "\nGenerating HLS stream..." << std::endl;
+        // 按需转码：播放列表由关键帧索引直接写出，切片在被请求时才生成
+        if (config.JIT_ENABLED) {
+            HttpServer server(config);
+            JitTranscoder transcoder(config);
+            transcoder.set_output_listener([&server](const std::string& path) { server.notify_file_written(path); });
+            transcoder.start();
+            server.set_segment_hooks(
+                [&transcoder](const std::string& file_path) { return transcoder.on_segment_request(file_path); },
+                [&transcoder](const std::string& file_path) { return transcoder.segment_state(file_path); });
+            server.start();
+            std::cout << "Serving " << transcoder.segment_count() << " on-demand segments at http://localhost:"
+                << config.HTTP_PORT << "/" << config.M3U8_FILENAME << std::endl;
+            while (!stop_signal && server.is_running()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            std::cout << "Shutting down..." << std::endl;
+            server.stop();
+            transcoder.stop();
+            return 0;
+        }
+
+        // 生成HLS流：后台模式下转码与HTTP服务同时进行，第一个切片写完即可开始观看
+        HttpServer server(config);
         HLSGenerator generator(config);
-        generator.start();
-        std::cout << "HLS generation completed!" << std::endl;
+        // 续转与修复会用同名文件替换切片，写完后通知服务器丢弃缓存的旧内容
+        generator.set_output_listener([&server](const std::string& path) { server.notify_file_written(path); });
+        bool generating = config.HLS_SERVE_WHILE_GENERATING;
+        if (generating) {
+            std::cout << "\nGenerating HLS stream in background..." << std::endl;
+            server.set_playlist_pending(true);
+            generator.start_async();
+        }
+        else {
+            std::cout << "\nGenerating HLS stream..." << std::endl;
+            generator.start();
+            std::cout << "HLS generation completed!" << std::endl;
+        }
 
         // 启动HTTP服务器
         std::cout << "\nStarting HTTP server..." << std::endl;
-        HttpServer server(config);
         server.start();
 
         std::cout << "\nServer is running!" << std::endl;
@@ -58,11 +113,19 @@ int main() {
 
         // 等待停止信号
         while (!stop_signal && server.is_running()) {
+            if (generating && generator.is_finished()) {
+                generating = false;
+                server.set_playlist_pending(false);
+                generator.wait();   // 转码失败时在这里抛出
+                std::cout << "HLS generation completed!" << std::endl;
+            }
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
 
         std::cout << "Shutting down server..." << std::endl;
+        generator.stop();
         server.stop();
+        generator.wait();
 
     }
     catch (const std::exception& e) {
@@ -77,6 +140,7 @@ int main() {
 
 // main.cpp
 #include "screen_recorder.h"
+#include "utils.h"
 #include <iostream>
 #include <conio.h>
 #include <signal.h>
@@ -173,6 +237,7 @@ void signalHandler(int signal) {
 }
 
 int64_t main_test(){
+    route_ffmpeg_logs();
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
     